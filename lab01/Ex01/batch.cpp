@@ -0,0 +1,326 @@
+#include "batch.h"
+#include "vectormath.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QtDebug>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const qint64 CHUNK_BYTES = 4 << 20;
+
+// Everything one worker needs for a chunk, reused from wave to wave
+struct BatchChunk
+{
+    const char *begin = nullptr;
+    const char *end = nullptr;
+
+    Vec3Array a, b, cross;
+    std::vector<char> kind; // LineKind per input line
+    std::vector<float> dot, angle, area;
+    std::string output;
+    size_t invalid = 0;
+    size_t blank = 0;
+};
+
+// Every input line gets an output line, so line N of the output is line N of the input
+enum LineKind : char
+{
+    ValidLine,
+    InvalidLine,
+    BlankLine
+};
+
+static bool isNumberStart(char c)
+{
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.';
+}
+
+// Parses a decimal float in place, no allocation and no locale
+static const char *parseFloat(const char *p, const char *end, float &value)
+{
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+
+    unsigned long long mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+
+    for (; p < end && *p >= '0' && *p <= '9'; ++p, ++digits)
+    {
+        if (mantissa < 100000000000000000ULL)
+            mantissa = mantissa * 10 + (*p - '0');
+        else
+            exponent++;
+    }
+    if (p < end && *p == '.')
+    {
+        for (++p; p < end && *p >= '0' && *p <= '9'; ++p, ++digits)
+        {
+            if (mantissa < 100000000000000000ULL)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                exponent--;
+            }
+        }
+    }
+    if (!digits)
+        return nullptr;
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char *q = p + 1;
+        bool negativeExponent = false;
+        if (q < end && (*q == '-' || *q == '+'))
+            negativeExponent = *q++ == '-';
+        if (q < end && *q >= '0' && *q <= '9')
+        {
+            int e = 0;
+            for (; q < end && *q >= '0' && *q <= '9'; ++q)
+                e = std::min(e * 10 + (*q - '0'), 1000);
+            exponent += negativeExponent ? -e : e;
+            p = q;
+        }
+    }
+
+    // Nothing to scale, and the exponent may be far outside the table
+    if (mantissa == 0)
+    {
+        value = negative ? -0.0f : 0.0f;
+        return p;
+    }
+
+    static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+                                    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    double result = static_cast<double>(mantissa);
+    // Runs until the exponent is in the table even once result is inf or 0
+    while (exponent > 22)
+    {
+        result *= 1e22;
+        exponent -= 22;
+    }
+    while (exponent < -22)
+    {
+        result /= 1e22;
+        exponent += 22;
+    }
+    if (exponent > 0)
+        result *= powers[exponent];
+    else if (exponent < 0)
+        result /= powers[-exponent];
+
+    value = static_cast<float>(negative ? -result : result);
+    return p;
+}
+
+// Reads the six numbers of a line, any other characters are separators
+static bool parseLine(const char *p, const char *end, float values[6])
+{
+    int count = 0;
+    while (p < end)
+    {
+        if (!isNumberStart(*p))
+        {
+            ++p;
+            continue;
+        }
+        if (count == 6)
+            return false;
+        p = parseFloat(p, end, values[count++]);
+        if (!p)
+            return false;
+    }
+    return count == 6;
+}
+
+static void processChunk(BatchChunk &chunk)
+{
+    chunk.a.resize(0);
+    chunk.b.resize(0);
+    chunk.kind.clear();
+    chunk.output.clear();
+    chunk.invalid = 0;
+    chunk.blank = 0;
+
+    for (const char *line = chunk.begin; line < chunk.end;)
+    {
+        const char *lineEnd = static_cast<const char *>(memchr(line, '\n', chunk.end - line));
+        if (!lineEnd)
+            lineEnd = chunk.end;
+
+        // Blank lines come out as empty lines; their zero vectors are computed but not written
+        const char *p = line;
+        while (p < lineEnd && (*p == ' ' || *p == '\t' || *p == '\r'))
+            ++p;
+
+        float v[6] = {0, 0, 0, 0, 0, 0};
+        LineKind kind = BlankLine;
+        if (p < lineEnd)
+            kind = parseLine(p, lineEnd, v) ? ValidLine : InvalidLine;
+        chunk.a.x.push_back(v[0]);
+        chunk.a.y.push_back(v[1]);
+        chunk.a.z.push_back(v[2]);
+        chunk.b.x.push_back(v[3]);
+        chunk.b.y.push_back(v[4]);
+        chunk.b.z.push_back(v[5]);
+        chunk.kind.push_back(kind);
+        if (kind == InvalidLine)
+            chunk.invalid++;
+        else if (kind == BlankLine)
+            chunk.blank++;
+        line = lineEnd + 1;
+    }
+
+    size_t n = chunk.a.size();
+    chunk.dot.resize(n);
+    chunk.angle.resize(n);
+    chunk.area.resize(n);
+
+    VectorMath::dot(chunk.a, chunk.b, chunk.dot.data());
+    VectorMath::angle(chunk.a, chunk.b, chunk.angle.data());
+    VectorMath::cross(chunk.a, chunk.b, chunk.cross);
+    VectorMath::triangleArea(chunk.a, chunk.b, chunk.area.data());
+
+    char line[192];
+    for (size_t i = 0; i < n; ++i)
+    {
+        int length;
+        if (chunk.kind[i] == ValidLine)
+            length = snprintf(line, sizeof(line), "%.7g %.7g %.7g %.7g %.7g %.7g\n", chunk.dot[i], chunk.angle[i],
+                              chunk.cross.x[i], chunk.cross.y[i], chunk.cross.z[i], chunk.area[i]);
+        else if (chunk.kind[i] == InvalidLine)
+            length = snprintf(line, sizeof(line), "invalid\n");
+        else
+            length = snprintf(line, sizeof(line), "\n");
+        chunk.output.append(line, length);
+    }
+}
+
+bool checkBatchParser()
+{
+    // Zero mantissas and far exponents must stay inside the power table
+    static const char *inputs[] = {
+        "0", "-0", "1.5", "-2.25e3", ".5", "3.4028235e38", "123456789012345678901234567890",
+        "0e30", "-0e-30", "0.000000000000000000000000", "0.0000000000000000000000001",
+        "1e-1000", "1e1000", "-7.5E-3",
+    };
+
+    bool ok = true;
+    for (const char *input : inputs)
+    {
+        const char *end = input + strlen(input);
+        float parsed = 0;
+        float expected = strtof(input, nullptr);
+        const char *stop = parseFloat(input, end, parsed);
+        bool same = parsed == expected && std::signbit(parsed) == std::signbit(expected);
+        if (!same && std::isfinite(expected))
+            same = std::fabs(parsed - expected) <= std::fabs(expected) * 1e-6f;
+        if (stop != end || !same)
+        {
+            qWarning("Parser: \"%s\" read as %g, expected %g", input, parsed, expected);
+            ok = false;
+        }
+    }
+
+    // Blank, invalid and valid lines each keep their place in the output
+    static const char lines[] = "1 0 0 0 1 0\n\n1 2 3\n \t\r\n(0,0,2) (0,3,0)\n";
+    static const char expected[] = "0 1.570796 0 0 1 0.5\n\ninvalid\n\n0 1.570796 -6 0 0 3\n";
+    BatchChunk chunk;
+    chunk.begin = lines;
+    chunk.end = lines + strlen(lines);
+    processChunk(chunk);
+    if (chunk.output != expected || chunk.invalid != 1 || chunk.blank != 2)
+    {
+        qWarning("Parser: lines read as \"%s\"", chunk.output.c_str());
+        ok = false;
+    }
+    return ok;
+}
+
+int runBatch(const QString &inputFile, const QString &outputFile)
+{
+    QFile input(inputFile);
+    if (!input.open(QFile::ReadOnly))
+    {
+        qWarning("Could not open %s", qPrintable(inputFile));
+        return 1;
+    }
+    QFile output(outputFile);
+    if (!output.open(QFile::WriteOnly | QFile::Truncate))
+    {
+        qWarning("Could not create %s", qPrintable(outputFile));
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    qint64 size = input.size();
+    const char *data = size ? reinterpret_cast<const char *>(input.map(0, size)) : nullptr;
+    if (size && !data)
+    {
+        qWarning("Could not map %s", qPrintable(inputFile));
+        return 1;
+    }
+    const char *end = data + size;
+
+    unsigned int numThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<BatchChunk> chunks(numThreads);
+    std::vector<std::thread> workers;
+
+    size_t pairs = 0, invalid = 0;
+    const char *next = data;
+    while (next < end)
+    {
+        // Cut the next wave at line boundaries
+        unsigned int numChunks = 0;
+        for (; numChunks < numThreads && next < end; ++numChunks)
+        {
+            const char *chunkEnd = end - next > CHUNK_BYTES ? next + CHUNK_BYTES : end;
+            if (chunkEnd < end)
+            {
+                const char *newline = static_cast<const char *>(memchr(chunkEnd, '\n', end - chunkEnd));
+                chunkEnd = newline ? newline + 1 : end;
+            }
+            chunks[numChunks].begin = next;
+            chunks[numChunks].end = chunkEnd;
+            next = chunkEnd;
+        }
+
+        workers.clear();
+        for (unsigned int i = 1; i < numChunks; ++i)
+            workers.emplace_back(processChunk, std::ref(chunks[i]));
+        processChunk(chunks[0]);
+        for (std::thread &worker : workers)
+            worker.join();
+
+        // Written in input order
+        for (unsigned int i = 0; i < numChunks; ++i)
+        {
+            if (output.write(chunks[i].output.data(), chunks[i].output.size()) < 0)
+            {
+                qWarning("Could not write %s", qPrintable(outputFile));
+                return 1;
+            }
+            pairs += chunks[i].a.size() - chunks[i].blank;
+            invalid += chunks[i].invalid;
+        }
+    }
+
+    output.close();
+    input.close();
+
+    double seconds = timer.nsecsElapsed() / 1e9;
+    qDebug("%zu pairs (%zu invalid) in %.3f s, %.2f M pairs/s on %u threads", pairs, invalid, seconds,
+           pairs / seconds / 1e6, numThreads);
+    return invalid ? 2 : 0;
+}
@@ -0,0 +1,18 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <QString>
+
+// Batch mode: reads one "(x,y,z) (x,y,z)" pair per line from a memory mapped
+// input file and writes "dot angle cross.x cross.y cross.z area" per line,
+// "invalid" for a line that does not parse and an empty line for a blank one.
+// The file is cut into chunks at line boundaries; a wave of chunks is parsed
+// and computed in parallel, then written out in order before the next wave
+// starts, so memory use stays bounded by the wave size and not the file size.
+int runBatch(const QString &inputFile, const QString &outputFile);
+
+// Compares the batch number parser with strtof on edge cases and checks that
+// output lines stay aligned with input lines, reporting mismatches
+bool checkBatchParser();
+
+#endif // BATCH_H
@@ -0,0 +1,130 @@
+#include "benchmark.h"
+#include "vectormath.h"
+
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QtDebug>
+
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+// The previous MainWindow implementation, kept only as the baseline
+static float legacyDotProduct( QStringList vector1, QStringList vector2 )
+{
+    float result = 0;
+    for ( int i = 0; i < 3; i++ )
+        result += vector1[i].toFloat() * vector2[i].toFloat();
+    return result;
+}
+
+static float legacySmallerAngle( QStringList vector1, QStringList vector2, float dot_product )
+{
+    float norm1 = 0, norm2 = 0;
+    for ( int i = 0; i < 3; i++ )
+    {
+        norm1 += pow(vector1[i].toFloat(), 2);
+        norm2 += pow(vector2[i].toFloat(), 2);
+    }
+    norm1 = pow(norm1, 0.5);
+    norm2 = pow(norm2, 0.5);
+
+    return acos(dot_product / (norm1 * norm2));
+}
+
+static float legacyAreaOfTriangle( QStringList vector1, QStringList vector2 )
+{
+    float area = 0, vect[3];
+
+    vect[0] = (vector1[1].toFloat() * vector2[2].toFloat()) - (vector1[2].toFloat() * vector2[1].toFloat());
+    vect[1] = (vector1[0].toFloat() * vector2[2].toFloat()) - (vector1[2].toFloat() * vector2[0].toFloat());
+    vect[2] = (vector1[0].toFloat() * vector2[1].toFloat()) - (vector1[1].toFloat() * vector2[0].toFloat());
+
+    for ( int i = 0; i < 3; i++ )
+        area += pow(vect[i], 2);
+
+    return pow(area, 0.5) / 2;
+}
+
+static void report(const char *name, size_t count, qint64 nanoseconds, float checksum)
+{
+    double seconds = nanoseconds / 1e9;
+    qDebug("%-28s %10.2f ns/element %10.2f M elements/s (checksum %g)", name,
+           nanoseconds / double(count), count / seconds / 1e6, checksum);
+}
+
+static float checksum(const float *values, size_t count)
+{
+    double sum = 0;
+    for (size_t i = 0; i < count; ++i)
+        sum += values[i];
+    return static_cast<float>(sum);
+}
+
+int runBenchmark(size_t count)
+{
+    Vec3Array a, b;
+    a.resize(count);
+    b.resize(count);
+
+    srand(1);
+    for (size_t i = 0; i < count; ++i)
+    {
+        a.set(i, Vec3{rand() / float(RAND_MAX) - 0.5f, rand() / float(RAND_MAX) - 0.5f, rand() / float(RAND_MAX) - 0.5f});
+        b.set(i, Vec3{rand() / float(RAND_MAX) - 0.5f, rand() / float(RAND_MAX) - 0.5f, rand() / float(RAND_MAX) - 0.5f});
+    }
+
+    // The old code is far slower, a slice is enough to measure it
+    size_t legacyCount = count < 100000 ? count : 100000;
+    std::vector<QStringList> legacyA(legacyCount), legacyB(legacyCount);
+    for (size_t i = 0; i < legacyCount; ++i)
+    {
+        legacyA[i] << QString::number(a.x[i]) << QString::number(a.y[i]) << QString::number(a.z[i]);
+        legacyB[i] << QString::number(b.x[i]) << QString::number(b.y[i]) << QString::number(b.z[i]);
+    }
+
+    std::vector<float> out(count);
+    Vec3Array crossOut;
+    QElapsedTimer timer;
+
+    qDebug("%zu vector pairs, best kernel: %s", count, VectorMath::kernelName(VectorMath::bestKernel()));
+
+    // Dot product, angle and area per element, as the UI computes them
+    timer.start();
+    for (size_t i = 0; i < legacyCount; ++i)
+    {
+        float dot = legacyDotProduct(legacyA[i], legacyB[i]);
+        out[i] = dot + legacySmallerAngle(legacyA[i], legacyB[i], dot) + legacyAreaOfTriangle(legacyA[i], legacyB[i]);
+    }
+    report("QStringList", legacyCount, timer.nsecsElapsed(), checksum(out.data(), legacyCount));
+
+    const VectorMath::Kernel kernels[] = {VectorMath::Scalar, VectorMath::Sse, VectorMath::Avx};
+    for (VectorMath::Kernel kernel : kernels)
+    {
+        if (kernel > VectorMath::bestKernel())
+            break;
+
+        std::vector<float> angles(count), areas(count);
+
+        timer.start();
+        VectorMath::dot(a, b, out.data(), kernel);
+        VectorMath::angle(a, b, angles.data(), kernel);
+        VectorMath::triangleArea(a, b, areas.data(), kernel);
+        qint64 elapsed = timer.nsecsElapsed();
+        for (size_t i = 0; i < count; ++i)
+            out[i] += angles[i] + areas[i];
+        report(QString("VectorMath %1").arg(VectorMath::kernelName(kernel)).toLatin1().constData(),
+               count, elapsed, checksum(out.data(), legacyCount));
+
+        // Single operations, to see which ones are bound by memory
+        timer.start();
+        VectorMath::dot(a, b, out.data(), kernel);
+        report("  dot", count, timer.nsecsElapsed(), checksum(out.data(), legacyCount));
+
+        timer.start();
+        VectorMath::cross(a, b, crossOut, kernel);
+        report("  cross", count, timer.nsecsElapsed(), checksum(crossOut.z.data(), legacyCount));
+    }
+
+    return 0;
+}
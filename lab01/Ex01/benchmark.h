@@ -0,0 +1,10 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <cstddef>
+
+// Compares the per-element throughput of the old QStringList based vector
+// operations with the scalar and SIMD batch kernels of VectorMath.
+int runBenchmark(size_t count);
+
+#endif // BENCHMARK_H
@@ -1,8 +1,21 @@
 #include "mainwindow.h"
+#include "benchmark.h"
+#include "batch.h"
 #include <QApplication>
 
+#include <stdlib.h>
+#include <string.h>
+
 int main(int argc, char *argv[])
 {
+    // Ex01 --benchmark [count]: check the batch parser, compare the vector math kernels and exit
+    if (argc > 1 && strcmp(argv[1], "--benchmark") == 0)
+        return !checkBatchParser() ? 1 : runBenchmark(argc > 2 ? strtoul(argv[2], nullptr, 10) : 1 << 22);
+
+    // Ex01 --batch input output: evaluate every vector pair of a file and exit
+    if (argc > 3 && strcmp(argv[1], "--batch") == 0)
+        return runBatch(QString::fromLocal8Bit(argv[2]), QString::fromLocal8Bit(argv[3]));
+
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
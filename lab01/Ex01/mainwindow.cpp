@@ -1,6 +1,5 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
-#include "math.h"
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
@@ -18,106 +17,53 @@ MainWindow::~MainWindow()
 
 void MainWindow::opVectors( void )
 {
-    QString input = ui->lineEditVectors->text();
-    QStringList list = input.remove("(").remove(")").split(" ");
+    Vec3 vector1, vector2;
 
-    QStringList vector1, vector2;
-
-    vector1 = list[0].split(",");
-    vector2 = list[1].split(",");
-
-    float dot_product = dotProduct(vector1, vector2);
-    float smaller_angle = smallerAngle(vector1, vector2, dot_product);
-    //QString orthogonal_angle = orthogonalVector(vector1, vector2, dot_product);
-    float area_of_triangle = areaOfTriangle(vector1, vector2);
+    if ( !parseVectors(ui->lineEditVectors->text(), vector1, vector2) )
+    {
+        ui->statusBar->showMessage("Expected two vectors, e.g. (1,0,0) (0,1,0)");
+        return;
+    }
+    ui->statusBar->clearMessage();
 
+    // Parsed once above, the math works on plain floats from here on
+    float dot_product = VectorMath::dot(vector1, vector2);
+    float smaller_angle = VectorMath::angle(vector1, vector2);
+    Vec3 orthogonal_vector = VectorMath::cross(vector1, vector2);
+    float area_of_triangle = VectorMath::triangleArea(vector1, vector2);
 
     ui->labelDotProduct->setText(QString("Dot product between v1 and v2:\t\t %1").arg(dot_product));
     ui->labelSmallerAngle->setText(QString("Smaller angle between v1 and v2:\t\t %1°").arg(smaller_angle));
-    ui->labelOrthogonalVector->setText(QString("Orthogonal vector of v1 and v2:\t\t %1").arg(" - "));
+    ui->labelOrthogonalVector->setText(QString("Orthogonal vector of v1 and v2:\t\t (%1,%2,%3)")
+                                       .arg(orthogonal_vector.x).arg(orthogonal_vector.y).arg(orthogonal_vector.z));
     ui->labelAreaOfTriangle->setText(QString("Area of triangle defined by v1 and v2:\t %1").arg(area_of_triangle));
 }
 
-
-float MainWindow::dotProduct( QStringList vector1, QStringList vector2 )
-{
-    float result, i;
-
-    result = 0;
-    for ( i = 0; i < 3; i++ )
-    {
-        result += vector1[i].toFloat() * vector2[i].toFloat();
-    }
-    return result;
-}
-
-float MainWindow::smallerAngle( QStringList vector1, QStringList vector2, float dot_product)
-{
-    int i;
-    float norm1, norm2, angle;
-
-    norm1 = 0;
-    norm2 = 0;
-    for ( i = 0; i < 3; i++ )
-    {
-        norm1 += pow(vector1[i].toFloat(), 2);
-        norm2 += pow(vector2[i].toFloat(), 2);
-    }
-    norm1 = pow(norm1, 0.5);
-    norm2 = pow(norm2, 0.5);
-
-    angle = acos(dot_product / (norm1 * norm2));
-
-    return angle;
-}
-
-/*
-QString MainWindow::orthogonalVector( QStringList vector1, QStringList vector2, float dot_product)
-{
-    QString orth_vector;
-
-    if ( dot_product != 0 )
-    {
-        orth_result = "-";
-        return orth_result;
-    }
-
-
-    QStringList refVector;
-    if ( vector1 != new QStringList(0,0,0) )
-    {
-        refVector = vector1;
-    }
-    else
-    {
-        refVector = vector2;
-    }
-
-    // TODO: Search in vector an element multiple of another, then find de multiplier and
-    //       resolve orthogonal vector elements
-
-    orth_vector = "";
-
-    return refVector;
-}
-*/
-
-float MainWindow::areaOfTriangle( QStringList vector1, QStringList vector2)
+// Input format: "(x1,y1,z1) (x2,y2,z2)"
+bool MainWindow::parseVectors( const QString &input, Vec3 &vector1, Vec3 &vector2 )
 {
-    int i;
-    float area, vect[3];
+    QString text = input;
+    QStringList list = text.remove("(").remove(")").split(" ", QString::SkipEmptyParts);
+    if ( list.size() < 2 )
+        return false;
 
-    vect[0] = (vector1[1].toFloat() * vector2[2].toFloat()) - (vector1[2].toFloat() * vector2[1].toFloat());
-    vect[1] = (vector1[0].toFloat() * vector2[2].toFloat()) - (vector1[2].toFloat() * vector2[0].toFloat());
-    vect[2] = (vector1[0].toFloat() * vector2[1].toFloat()) - (vector1[1].toFloat() * vector2[0].toFloat());
-
-    area = 0;
-    for (i = 0; i < 3; i++)
+    float values[6];
+    for ( int v = 0; v < 2; v++ )
     {
-        area += pow(vect[i], 2);
+        QStringList components = list[v].split(",");
+        if ( components.size() != 3 )
+            return false;
+
+        for ( int i = 0; i < 3; i++ )
+        {
+            bool ok;
+            values[v * 3 + i] = components[i].toFloat(&ok);
+            if ( !ok )
+                return false;
+        }
     }
 
-    area = pow(area, 0.5) / 2;
-
-    return area;
+    vector1 = Vec3{values[0], values[1], values[2]};
+    vector2 = Vec3{values[3], values[4], values[5]};
+    return true;
 }
@@ -3,6 +3,8 @@
 
 #include <QMainWindow>
 
+#include "vectormath.h"
+
 namespace Ui {
 class MainWindow;
 }
@@ -15,15 +17,13 @@ public:
     explicit MainWindow(QWidget *parent = 0);
     ~MainWindow();
 
+    static bool parseVectors(const QString &input, Vec3 &vector1, Vec3 &vector2);
+
 private:
     Ui::MainWindow *ui;
 
 public slots:
     void opVectors ( void );
-    float dotProduct ( QStringList, QStringList );
-    float smallerAngle( QStringList, QStringList, float );
-    //QString MainWindow::orthogonalVector( QStringList, QStringList, float );
-    float areaOfTriangle(QStringList, QStringList );
 };
 
 #endif // MAINWINDOW_H
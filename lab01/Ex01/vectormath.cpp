@@ -0,0 +1,264 @@
+#include "vectormath.h"
+
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VECTORMATH_SSE
+#endif
+#if defined(__AVX__)
+#include <immintrin.h>
+#define VECTORMATH_AVX
+#endif
+
+void Vec3Array::resize(size_t n)
+{
+    x.resize(n);
+    y.resize(n);
+    z.resize(n);
+}
+
+void Vec3Array::set(size_t i, const Vec3 &v)
+{
+    x[i] = v.x;
+    y[i] = v.y;
+    z[i] = v.z;
+}
+
+Vec3 Vec3Array::get(size_t i) const
+{
+    return Vec3{x[i], y[i], z[i]};
+}
+
+namespace VectorMath
+{
+
+Kernel bestKernel()
+{
+#if defined(VECTORMATH_AVX)
+    return Avx;
+#elif defined(VECTORMATH_SSE)
+    return Sse;
+#else
+    return Scalar;
+#endif
+}
+
+const char *kernelName(Kernel kernel)
+{
+    switch (kernel)
+    {
+    case Avx:
+        return "AVX";
+    case Sse:
+        return "SSE";
+    default:
+        return "scalar";
+    }
+}
+
+// A kernel the build does not have falls back to the next narrower one
+static Kernel available(Kernel kernel)
+{
+    return kernel > bestKernel() ? bestKernel() : kernel;
+}
+
+// Keeps NaN (zero length vectors) but stops rounding from leaving acos' domain
+static float clampCosine(float c)
+{
+    return c > 1.0f ? 1.0f : (c < -1.0f ? -1.0f : c);
+}
+
+float dot(const Vec3 &a, const Vec3 &b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+float angle(const Vec3 &a, const Vec3 &b)
+{
+    float norms = sqrtf(dot(a, a) * dot(b, b));
+    return acosf(clampCosine(dot(a, b) / norms));
+}
+
+Vec3 cross(const Vec3 &a, const Vec3 &b)
+{
+    return Vec3{a.y * b.z - a.z * b.y,
+                a.z * b.x - a.x * b.z,
+                a.x * b.y - a.y * b.x};
+}
+
+float triangleArea(const Vec3 &a, const Vec3 &b)
+{
+    Vec3 c = cross(a, b);
+    return sqrtf(dot(c, c)) * 0.5f;
+}
+
+void dot(const Vec3Array &a, const Vec3Array &b, float *out, Kernel kernel)
+{
+    const float *ax = a.x.data(), *ay = a.y.data(), *az = a.z.data();
+    const float *bx = b.x.data(), *by = b.y.data(), *bz = b.z.data();
+    size_t n = a.size();
+    size_t i = 0;
+    kernel = available(kernel);
+
+#ifdef VECTORMATH_AVX
+    if (kernel == Avx)
+    {
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256 r = _mm256_mul_ps(_mm256_loadu_ps(ax + i), _mm256_loadu_ps(bx + i));
+            r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_loadu_ps(ay + i), _mm256_loadu_ps(by + i)));
+            r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_loadu_ps(az + i), _mm256_loadu_ps(bz + i)));
+            _mm256_storeu_ps(out + i, r);
+        }
+    }
+#endif
+#ifdef VECTORMATH_SSE
+    if (kernel >= Sse)
+    {
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128 r = _mm_mul_ps(_mm_loadu_ps(ax + i), _mm_loadu_ps(bx + i));
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(ay + i), _mm_loadu_ps(by + i)));
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(az + i), _mm_loadu_ps(bz + i)));
+            _mm_storeu_ps(out + i, r);
+        }
+    }
+#endif
+
+    for (; i < n; ++i)
+        out[i] = ax[i] * bx[i] + ay[i] * by[i] + az[i] * bz[i];
+}
+
+void angle(const Vec3Array &a, const Vec3Array &b, float *out, Kernel kernel)
+{
+    const float *ax = a.x.data(), *ay = a.y.data(), *az = a.z.data();
+    const float *bx = b.x.data(), *by = b.y.data(), *bz = b.z.data();
+    size_t n = a.size();
+    size_t i = 0;
+    kernel = available(kernel);
+
+    // The cosines are vectorised, acos itself has no SIMD instruction
+#ifdef VECTORMATH_AVX
+    if (kernel == Avx)
+    {
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256 x1 = _mm256_loadu_ps(ax + i), y1 = _mm256_loadu_ps(ay + i), z1 = _mm256_loadu_ps(az + i);
+            __m256 x2 = _mm256_loadu_ps(bx + i), y2 = _mm256_loadu_ps(by + i), z2 = _mm256_loadu_ps(bz + i);
+            __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x1, x2), _mm256_mul_ps(y1, y2)), _mm256_mul_ps(z1, z2));
+            __m256 n1 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x1, x1), _mm256_mul_ps(y1, y1)), _mm256_mul_ps(z1, z1));
+            __m256 n2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x2, x2), _mm256_mul_ps(y2, y2)), _mm256_mul_ps(z2, z2));
+            _mm256_storeu_ps(out + i, _mm256_div_ps(d, _mm256_sqrt_ps(_mm256_mul_ps(n1, n2))));
+        }
+    }
+#endif
+#ifdef VECTORMATH_SSE
+    if (kernel >= Sse)
+    {
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128 x1 = _mm_loadu_ps(ax + i), y1 = _mm_loadu_ps(ay + i), z1 = _mm_loadu_ps(az + i);
+            __m128 x2 = _mm_loadu_ps(bx + i), y2 = _mm_loadu_ps(by + i), z2 = _mm_loadu_ps(bz + i);
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x1, x2), _mm_mul_ps(y1, y2)), _mm_mul_ps(z1, z2));
+            __m128 n1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x1, x1), _mm_mul_ps(y1, y1)), _mm_mul_ps(z1, z1));
+            __m128 n2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x2, x2), _mm_mul_ps(y2, y2)), _mm_mul_ps(z2, z2));
+            _mm_storeu_ps(out + i, _mm_div_ps(d, _mm_sqrt_ps(_mm_mul_ps(n1, n2))));
+        }
+    }
+#endif
+
+    for (size_t j = 0; j < i; ++j)
+        out[j] = acosf(clampCosine(out[j]));
+    for (; i < n; ++i)
+        out[i] = angle(Vec3{ax[i], ay[i], az[i]}, Vec3{bx[i], by[i], bz[i]});
+}
+
+void cross(const Vec3Array &a, const Vec3Array &b, Vec3Array &out, Kernel kernel)
+{
+    const float *ax = a.x.data(), *ay = a.y.data(), *az = a.z.data();
+    const float *bx = b.x.data(), *by = b.y.data(), *bz = b.z.data();
+    size_t n = a.size();
+    size_t i = 0;
+    kernel = available(kernel);
+
+    out.resize(n);
+    float *cx = out.x.data(), *cy = out.y.data(), *cz = out.z.data();
+
+#ifdef VECTORMATH_AVX
+    if (kernel == Avx)
+    {
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256 x1 = _mm256_loadu_ps(ax + i), y1 = _mm256_loadu_ps(ay + i), z1 = _mm256_loadu_ps(az + i);
+            __m256 x2 = _mm256_loadu_ps(bx + i), y2 = _mm256_loadu_ps(by + i), z2 = _mm256_loadu_ps(bz + i);
+            _mm256_storeu_ps(cx + i, _mm256_sub_ps(_mm256_mul_ps(y1, z2), _mm256_mul_ps(z1, y2)));
+            _mm256_storeu_ps(cy + i, _mm256_sub_ps(_mm256_mul_ps(z1, x2), _mm256_mul_ps(x1, z2)));
+            _mm256_storeu_ps(cz + i, _mm256_sub_ps(_mm256_mul_ps(x1, y2), _mm256_mul_ps(y1, x2)));
+        }
+    }
+#endif
+#ifdef VECTORMATH_SSE
+    if (kernel >= Sse)
+    {
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128 x1 = _mm_loadu_ps(ax + i), y1 = _mm_loadu_ps(ay + i), z1 = _mm_loadu_ps(az + i);
+            __m128 x2 = _mm_loadu_ps(bx + i), y2 = _mm_loadu_ps(by + i), z2 = _mm_loadu_ps(bz + i);
+            _mm_storeu_ps(cx + i, _mm_sub_ps(_mm_mul_ps(y1, z2), _mm_mul_ps(z1, y2)));
+            _mm_storeu_ps(cy + i, _mm_sub_ps(_mm_mul_ps(z1, x2), _mm_mul_ps(x1, z2)));
+            _mm_storeu_ps(cz + i, _mm_sub_ps(_mm_mul_ps(x1, y2), _mm_mul_ps(y1, x2)));
+        }
+    }
+#endif
+
+    for (; i < n; ++i)
+        out.set(i, cross(a.get(i), b.get(i)));
+}
+
+void triangleArea(const Vec3Array &a, const Vec3Array &b, float *out, Kernel kernel)
+{
+    const float *ax = a.x.data(), *ay = a.y.data(), *az = a.z.data();
+    const float *bx = b.x.data(), *by = b.y.data(), *bz = b.z.data();
+    size_t n = a.size();
+    size_t i = 0;
+    kernel = available(kernel);
+
+#ifdef VECTORMATH_AVX
+    if (kernel == Avx)
+    {
+        const __m256 half = _mm256_set1_ps(0.5f);
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256 x1 = _mm256_loadu_ps(ax + i), y1 = _mm256_loadu_ps(ay + i), z1 = _mm256_loadu_ps(az + i);
+            __m256 x2 = _mm256_loadu_ps(bx + i), y2 = _mm256_loadu_ps(by + i), z2 = _mm256_loadu_ps(bz + i);
+            __m256 cx = _mm256_sub_ps(_mm256_mul_ps(y1, z2), _mm256_mul_ps(z1, y2));
+            __m256 cy = _mm256_sub_ps(_mm256_mul_ps(z1, x2), _mm256_mul_ps(x1, z2));
+            __m256 cz = _mm256_sub_ps(_mm256_mul_ps(x1, y2), _mm256_mul_ps(y1, x2));
+            __m256 len2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, cx), _mm256_mul_ps(cy, cy)), _mm256_mul_ps(cz, cz));
+            _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_sqrt_ps(len2), half));
+        }
+    }
+#endif
+#ifdef VECTORMATH_SSE
+    if (kernel >= Sse)
+    {
+        const __m128 half = _mm_set1_ps(0.5f);
+        for (; i + 4 <= n; i += 4)
+        {
+            __m128 x1 = _mm_loadu_ps(ax + i), y1 = _mm_loadu_ps(ay + i), z1 = _mm_loadu_ps(az + i);
+            __m128 x2 = _mm_loadu_ps(bx + i), y2 = _mm_loadu_ps(by + i), z2 = _mm_loadu_ps(bz + i);
+            __m128 cx = _mm_sub_ps(_mm_mul_ps(y1, z2), _mm_mul_ps(z1, y2));
+            __m128 cy = _mm_sub_ps(_mm_mul_ps(z1, x2), _mm_mul_ps(x1, z2));
+            __m128 cz = _mm_sub_ps(_mm_mul_ps(x1, y2), _mm_mul_ps(y1, x2));
+            __m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, cx), _mm_mul_ps(cy, cy)), _mm_mul_ps(cz, cz));
+            _mm_storeu_ps(out + i, _mm_mul_ps(_mm_sqrt_ps(len2), half));
+        }
+    }
+#endif
+
+    for (; i < n; ++i)
+        out[i] = triangleArea(a.get(i), b.get(i));
+}
+
+}
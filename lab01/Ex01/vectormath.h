@@ -0,0 +1,45 @@
+#ifndef VECTORMATH_H
+#define VECTORMATH_H
+
+#include <cstddef>
+#include <vector>
+
+struct Vec3
+{
+    float x, y, z;
+};
+
+// Structure of arrays: a batch of 3-vectors with one contiguous array per
+// component, so the kernels can load 4 (SSE) or 8 (AVX) vectors at a time.
+struct Vec3Array
+{
+    std::vector<float> x, y, z;
+
+    size_t size() const { return x.size(); }
+    void resize(size_t n);
+    void set(size_t i, const Vec3 &v);
+    Vec3 get(size_t i) const;
+};
+
+// Typed vector math. The batch entry points run the widest kernel the build
+// supports and finish the remainder with the scalar code.
+namespace VectorMath
+{
+    enum Kernel { Scalar, Sse, Avx };
+
+    Kernel bestKernel();
+    const char *kernelName(Kernel kernel);
+
+    float dot(const Vec3 &a, const Vec3 &b);
+    float angle(const Vec3 &a, const Vec3 &b); // Radians
+    Vec3 cross(const Vec3 &a, const Vec3 &b);
+    float triangleArea(const Vec3 &a, const Vec3 &b); // Triangle spanned by a and b
+
+    // Batches: a and b must have the same size, out holds a.size() results
+    void dot(const Vec3Array &a, const Vec3Array &b, float *out, Kernel kernel = bestKernel());
+    void angle(const Vec3Array &a, const Vec3Array &b, float *out, Kernel kernel = bestKernel());
+    void cross(const Vec3Array &a, const Vec3Array &b, Vec3Array &out, Kernel kernel = bestKernel());
+    void triangleArea(const Vec3Array &a, const Vec3Array &b, float *out, Kernel kernel = bestKernel());
+}
+
+#endif // VECTORMATH_H
@@ -17,6 +17,12 @@ TEMPLATE = app
 # deprecated API in order to know how to port your code away from it.
 DEFINES += QT_DEPRECATED_WARNINGS
 
+CONFIG += c++14
+
+# Let the compiler enable the widest SIMD kernels this machine supports
+unix: QMAKE_CXXFLAGS += -march=native
+unix: LIBS += -lpthread
+
 # You can also make your code fail to compile if you use deprecated APIs.
 # In order to do so, uncomment the following line.
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
@@ -25,10 +31,16 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 SOURCES += \
         main.cpp \
-        mainwindow.cpp
+        mainwindow.cpp \
+        matrix4.cpp \
+        benchmark.cpp \
+        densematrix.cpp
 
 HEADERS += \
-        mainwindow.h
+        mainwindow.h \
+        matrix4.h \
+        benchmark.h \
+        densematrix.h
 
 FORMS += \
         mainwindow.ui
@@ -0,0 +1,149 @@
+#include "benchmark.h"
+#include "matrix4.h"
+
+#include <QElapsedTimer>
+#include <QMatrix3x3>
+#include <QMatrix4x4>
+#include <QQuaternion>
+#include <QVector3D>
+#include <QtDebug>
+
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+static float randomFloat()
+{
+    return rand() / float(RAND_MAX) * 2.0f - 1.0f;
+}
+
+static void report(const char *name, int iterations, qint64 qtNanoseconds, qint64 nanoseconds, float checksum)
+{
+    qDebug("%-20s QMatrix4x4 %8.2f ns  Matrix4 %8.2f ns  speedup %5.2fx (checksum %g)", name,
+           qtNanoseconds / double(iterations), nanoseconds / double(iterations),
+           qtNanoseconds / double(nanoseconds ? nanoseconds : 1), checksum);
+}
+
+int runBenchmark(int iterations)
+{
+    const int NUM_MATRICES = 256;
+    const int NUM_POINTS = 4096;
+
+    std::vector<QMatrix4x4> qtMatrices(NUM_MATRICES);
+    std::vector<Matrix4> matrices(NUM_MATRICES);
+    srand(1);
+    for (int i = 0; i < NUM_MATRICES; ++i)
+    {
+        float values[16];
+        for (int j = 0; j < 16; ++j)
+            values[j] = randomFloat();
+        qtMatrices[i] = QMatrix4x4(values);
+        matrices[i] = Matrix4(values);
+    }
+
+    std::vector<QVector3D> qtPoints(NUM_POINTS), qtOut(NUM_POINTS);
+    std::vector<float> points(NUM_POINTS * 3), out(NUM_POINTS * 3);
+    for (int i = 0; i < NUM_POINTS; ++i)
+    {
+        qtPoints[i] = QVector3D(randomFloat(), randomFloat(), randomFloat());
+        points[i * 3] = qtPoints[i].x();
+        points[i * 3 + 1] = qtPoints[i].y();
+        points[i * 3 + 2] = qtPoints[i].z();
+    }
+
+    QElapsedTimer timer;
+    qint64 qtTime, time;
+    float qtSum = 0, sum = 0;
+
+    // Multiply
+    timer.start();
+    for (int i = 0; i < iterations; ++i)
+    {
+        QMatrix4x4 m = qtMatrices[i % NUM_MATRICES] * qtMatrices[(i + 1) % NUM_MATRICES];
+        qtSum += m(i & 3, (i >> 2) & 3);
+    }
+    qtTime = timer.nsecsElapsed();
+    timer.start();
+    for (int i = 0; i < iterations; ++i)
+    {
+        Matrix4 m = matrices[i % NUM_MATRICES] * matrices[(i + 1) % NUM_MATRICES];
+        sum += m(i & 3, (i >> 2) & 3);
+    }
+    time = timer.nsecsElapsed();
+    report("multiply", iterations, qtTime, time, sum - qtSum);
+
+    // Transpose
+    qtSum = sum = 0;
+    timer.start();
+    for (int i = 0; i < iterations; ++i)
+        qtSum += qtMatrices[i % NUM_MATRICES].transposed()(i & 3, (i >> 2) & 3);
+    qtTime = timer.nsecsElapsed();
+    timer.start();
+    for (int i = 0; i < iterations; ++i)
+        sum += matrices[i % NUM_MATRICES].transposed()(i & 3, (i >> 2) & 3);
+    time = timer.nsecsElapsed();
+    report("transpose", iterations, qtTime, time, sum - qtSum);
+
+    // Inverse, the random matrices use QMatrix4x4's general path
+    qtSum = sum = 0;
+    timer.start();
+    for (int i = 0; i < iterations; ++i)
+        qtSum += qtMatrices[i % NUM_MATRICES].inverted()(i & 3, (i >> 2) & 3);
+    qtTime = timer.nsecsElapsed();
+    timer.start();
+    for (int i = 0; i < iterations; ++i)
+        sum += matrices[i % NUM_MATRICES].inverted()(i & 3, (i >> 2) & 3);
+    time = timer.nsecsElapsed();
+    report("inverse", iterations, qtTime, time, sum - qtSum);
+
+    // Point batches, timed per point
+    int batches = iterations / NUM_POINTS > 0 ? iterations / NUM_POINTS : 1;
+    qtSum = sum = 0;
+    timer.start();
+    for (int b = 0; b < batches; ++b)
+    {
+        const QMatrix4x4 &m = qtMatrices[b % NUM_MATRICES];
+        for (int i = 0; i < NUM_POINTS; ++i)
+            qtOut[i] = m.map(qtPoints[i]);
+        qtSum += qtOut[b % NUM_POINTS].x();
+    }
+    qtTime = timer.nsecsElapsed();
+    timer.start();
+    for (int b = 0; b < batches; ++b)
+    {
+        matrices[b % NUM_MATRICES].transformPoints(points.data(), out.data(), NUM_POINTS);
+        sum += out[(b % NUM_POINTS) * 3];
+    }
+    time = timer.nsecsElapsed();
+    report("transform point", batches * NUM_POINTS, qtTime, time, sum - qtSum);
+
+    // Model::drawModel: rotation, translation, scale and the normal matrix
+    qtSum = sum = 0;
+    timer.start();
+    for (int i = 0; i < iterations; ++i)
+    {
+        QMatrix4x4 model;
+        model.setToIdentity();
+        model.rotate(QQuaternion(0.9f, 0.1f * (i & 7), 0.2f, 0.3f).normalized());
+        model.translate(i * 0.001f, 1.0f, -2.0f);
+        model.scale(0.5f + (i & 3));
+        QMatrix3x3 normal = model.normalMatrix();
+        qtSum += model(0, 3) + normal(1, 1);
+    }
+    qtTime = timer.nsecsElapsed();
+    timer.start();
+    for (int i = 0; i < iterations; ++i)
+    {
+        QQuaternion q = QQuaternion(0.9f, 0.1f * (i & 7), 0.2f, 0.3f).normalized();
+        float s = 0.5f + (i & 3);
+        Matrix4 model = Matrix4::rotation(q.x(), q.y(), q.z(), q.scalar()) *
+                        Matrix4::translation(i * 0.001f, 1.0f, -2.0f) * Matrix4::scaling(s, s, s);
+        float normal[9];
+        model.normalMatrix(normal);
+        sum += model(0, 3) + normal[4];
+    }
+    time = timer.nsecsElapsed();
+    report("drawModel matrices", iterations, qtTime, time, sum - qtSum);
+
+    return 0;
+}
@@ -0,0 +1,8 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+// Times Matrix4 against QMatrix4x4 for the basic operations, point batches
+// and the per model matrix work roadblock's Model::drawModel does every frame.
+int runBenchmark(int iterations);
+
+#endif // BENCHMARK_H
@@ -0,0 +1,384 @@
+#include "densematrix.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <QtDebug>
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define DENSEMATRIX_AVX
+#elif defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define DENSEMATRIX_SSE
+#endif
+
+DenseMatrix::DenseMatrix(int _rows, int _columns)
+{
+    resize(_rows, _columns);
+}
+
+void DenseMatrix::resize(int _rows, int _columns)
+{
+    rows = _rows;
+    columns = _columns;
+    values.assign(size_t(rows) * columns, 0.0f);
+}
+
+void DenseMatrix::randomize()
+{
+    for (float &value : values)
+        value = rand() / float(RAND_MAX) * 2.0f - 1.0f;
+}
+
+bool DenseMatrix::load(const QString &fileName, QString *error)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly))
+    {
+        if (error)
+            *error = QString("Could not open %1").arg(fileName);
+        return false;
+    }
+
+    if (fileName.endsWith(".bin"))
+    {
+        int32_t header[2];
+        if (file.read(reinterpret_cast<char *>(header), sizeof(header)) != sizeof(header) ||
+            header[0] < 0 || header[1] < 0)
+        {
+            if (error)
+                *error = QString("%1: bad header").arg(fileName);
+            return false;
+        }
+        resize(header[0], header[1]);
+        qint64 bytes = qint64(values.size()) * sizeof(float);
+        if (file.read(reinterpret_cast<char *>(values.data()), bytes) != bytes)
+        {
+            if (error)
+                *error = QString("%1: expected %2 x %3 values").arg(fileName).arg(rows).arg(columns);
+            return false;
+        }
+        return true;
+    }
+
+    std::vector<float> data;
+    int numRows = 0, numColumns = -1;
+    QTextStream stream(&file);
+    while (!stream.atEnd())
+    {
+        QString line = stream.readLine().trimmed();
+        if (line.isEmpty())
+            continue;
+
+        QStringList fields = line.split(',');
+        if (numColumns < 0)
+            numColumns = fields.size();
+        if (fields.size() != numColumns)
+        {
+            if (error)
+                *error = QString("%1: row %2 has %3 values instead of %4").arg(fileName).arg(numRows + 1)
+                         .arg(fields.size()).arg(numColumns);
+            return false;
+        }
+        for (const QString &field : fields)
+        {
+            bool ok;
+            data.push_back(field.trimmed().toFloat(&ok));
+            if (!ok)
+            {
+                if (error)
+                    *error = QString("%1: bad value '%2' in row %3").arg(fileName).arg(field).arg(numRows + 1);
+                return false;
+            }
+        }
+        numRows++;
+    }
+
+    rows = numRows;
+    columns = std::max(numColumns, 0);
+    values.swap(data);
+    return true;
+}
+
+bool DenseMatrix::save(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate))
+        return false;
+
+    if (fileName.endsWith(".bin"))
+    {
+        int32_t header[2] = {rows, columns};
+        file.write(reinterpret_cast<const char *>(header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(values.data()), qint64(values.size()) * sizeof(float));
+        return true;
+    }
+
+    QTextStream stream(&file);
+    for (int i = 0; i < rows; ++i)
+    {
+        for (int j = 0; j < columns; ++j)
+        {
+            if (j)
+                stream << ',';
+            stream << (*this)(i, j);
+        }
+        stream << '\n';
+    }
+    return true;
+}
+
+void DenseMatrix::multiplyNaive(const DenseMatrix &a, const DenseMatrix &b, DenseMatrix &c)
+{
+    c.resize(a.rows, b.columns);
+    for (int i = 0; i < a.rows; ++i)
+        for (int p = 0; p < a.columns; ++p)
+        {
+            float value = a(i, p);
+            for (int j = 0; j < b.columns; ++j)
+                c(i, j) += value * b(p, j);
+        }
+}
+
+// MR rows of A, interleaved so one k step reads MR consecutive floats
+static void packA(const float *a, int lda, int mc, int kc, float *packed)
+{
+    const int MR = DenseMatrix::MR;
+    for (int i = 0; i < mc; i += MR)
+    {
+        int rows = std::min(MR, mc - i);
+        for (int p = 0; p < kc; ++p)
+        {
+            for (int r = 0; r < rows; ++r)
+                packed[r] = a[size_t(i + r) * lda + p];
+            for (int r = rows; r < MR; ++r)
+                packed[r] = 0.0f;
+            packed += MR;
+        }
+    }
+}
+
+// NR columns of B per sliver, one k step is NR consecutive floats
+static void packB(const float *b, int ldb, int kc, int nc, float *packed)
+{
+    const int NR = DenseMatrix::NR;
+    for (int j = 0; j < nc; j += NR)
+    {
+        int cols = std::min(NR, nc - j);
+        for (int p = 0; p < kc; ++p)
+        {
+            const float *row = b + size_t(p) * ldb + j;
+            for (int c = 0; c < cols; ++c)
+                packed[c] = row[c];
+            for (int c = cols; c < NR; ++c)
+                packed[c] = 0.0f;
+            packed += NR;
+        }
+    }
+}
+
+// c[MR x NR] += a sliver * b sliver, the whole tile stays in registers
+static void microKernel(int kc, const float *a, const float *b, float *c)
+{
+    const int MR = DenseMatrix::MR;
+    const int NR = DenseMatrix::NR;
+
+#if defined(DENSEMATRIX_AVX)
+    __m256 acc[MR];
+    for (int i = 0; i < MR; ++i)
+        acc[i] = _mm256_setzero_ps();
+    for (int p = 0; p < kc; ++p, a += MR, b += NR)
+    {
+        __m256 bv = _mm256_loadu_ps(b);
+        for (int i = 0; i < MR; ++i)
+#ifdef __FMA__
+            acc[i] = _mm256_fmadd_ps(_mm256_set1_ps(a[i]), bv, acc[i]);
+#else
+            acc[i] = _mm256_add_ps(acc[i], _mm256_mul_ps(_mm256_set1_ps(a[i]), bv));
+#endif
+    }
+    for (int i = 0; i < MR; ++i)
+        _mm256_storeu_ps(c + i * NR, acc[i]);
+#elif defined(DENSEMATRIX_SSE)
+    __m128 acc[MR][2];
+    for (int i = 0; i < MR; ++i)
+        acc[i][0] = acc[i][1] = _mm_setzero_ps();
+    for (int p = 0; p < kc; ++p, a += MR, b += NR)
+    {
+        __m128 b0 = _mm_loadu_ps(b);
+        __m128 b1 = _mm_loadu_ps(b + 4);
+        for (int i = 0; i < MR; ++i)
+        {
+            __m128 av = _mm_set1_ps(a[i]);
+            acc[i][0] = _mm_add_ps(acc[i][0], _mm_mul_ps(av, b0));
+            acc[i][1] = _mm_add_ps(acc[i][1], _mm_mul_ps(av, b1));
+        }
+    }
+    for (int i = 0; i < MR; ++i)
+    {
+        _mm_storeu_ps(c + i * NR, acc[i][0]);
+        _mm_storeu_ps(c + i * NR + 4, acc[i][1]);
+    }
+#else
+    float acc[MR * NR] = {};
+    for (int p = 0; p < kc; ++p, a += MR, b += NR)
+        for (int i = 0; i < MR; ++i)
+            for (int j = 0; j < NR; ++j)
+                acc[i * NR + j] += a[i] * b[j];
+    memcpy(c, acc, sizeof(acc));
+#endif
+}
+
+void DenseMatrix::multiply(const DenseMatrix &a, const DenseMatrix &b, DenseMatrix &c, int numThreads)
+{
+    const int m = a.rows, n = b.columns, k = a.columns;
+    c.resize(m, n);
+    if (!m || !n || !k || b.rows != k)
+        return;
+
+    // Small products are over before threads would even start
+    if (numThreads <= 0)
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    if (2.0 * m * n * k < 4e6)
+        numThreads = 1;
+
+    std::vector<float> packedB(size_t(KC) * ((std::min(NC, n) + NR - 1) / NR * NR));
+    std::vector<std::vector<float>> packedA(numThreads, std::vector<float>(size_t(MC) * KC));
+
+    for (int jc = 0; jc < n; jc += NC)
+    {
+        int nc = std::min(NC, n - jc);
+        for (int pc = 0; pc < k; pc += KC)
+        {
+            int kc = std::min(KC, k - pc);
+            packB(&b.values[size_t(pc) * n + jc], n, kc, nc, packedB.data());
+
+            // Work units are MC rows by NC_SPLIT columns of C, handed out in order
+            int rowBlocks = (m + MC - 1) / MC;
+            int columnBlocks = (nc + NC_SPLIT - 1) / NC_SPLIT;
+            std::atomic<int> nextUnit(0);
+
+            auto worker = [&](int thread)
+            {
+                float *blockA = packedA[thread].data();
+                float tile[MR * NR];
+                int packedRowBlock = -1;
+
+                for (int unit = nextUnit++; unit < rowBlocks * columnBlocks; unit = nextUnit++)
+                {
+                    int ic = (unit / columnBlocks) * MC;
+                    int jStart = (unit % columnBlocks) * NC_SPLIT;
+                    int mc = std::min(MC, m - ic);
+                    int jEnd = std::min(nc, jStart + NC_SPLIT);
+
+                    if (packedRowBlock != ic)
+                    {
+                        packA(&a.values[size_t(ic) * k + pc], k, mc, kc, blockA);
+                        packedRowBlock = ic;
+                    }
+
+                    for (int jr = jStart; jr < jEnd; jr += NR)
+                    {
+                        const float *sliverB = packedB.data() + size_t(jr) * kc;
+                        int cols = std::min(NR, jEnd - jr);
+                        for (int ir = 0; ir < mc; ir += MR)
+                        {
+                            int rowsInTile = std::min(MR, mc - ir);
+                            microKernel(kc, blockA + size_t(ir) * kc, sliverB, tile);
+
+                            float *out = &c.values[size_t(ic + ir) * n + jc + jr];
+                            for (int i = 0; i < rowsInTile; ++i)
+                                for (int j = 0; j < cols; ++j)
+                                    out[size_t(i) * n + j] += tile[i * NR + j];
+                        }
+                    }
+                }
+            };
+
+            std::vector<std::thread> threads;
+            for (int t = 1; t < numThreads; ++t)
+                threads.emplace_back(worker, t);
+            worker(0);
+            for (std::thread &thread : threads)
+                thread.join();
+        }
+    }
+}
+
+int runGemmBenchmark(int maxSize)
+{
+    srand(1);
+    qDebug("%6s %10s %10s %s", "size", "ms", "GFLOP/s", "max error");
+    for (int size = 64; size <= maxSize; size *= 2)
+    {
+        DenseMatrix a(size, size), b(size, size), c;
+        a.randomize();
+        b.randomize();
+
+        // Repeat small sizes so every measurement lasts a while
+        QElapsedTimer timer;
+        int repeats = 0;
+        timer.start();
+        do
+        {
+            DenseMatrix::multiply(a, b, c);
+            repeats++;
+        } while (timer.elapsed() < 200);
+        double seconds = timer.nsecsElapsed() / 1e9 / repeats;
+        double gflops = 2.0 * size * size * size / seconds / 1e9;
+
+        // Check against the textbook loop while it is still cheap
+        QString error("-");
+        if (size <= 512)
+        {
+            DenseMatrix reference;
+            DenseMatrix::multiplyNaive(a, b, reference);
+            float maxError = 0;
+            for (size_t i = 0; i < c.values.size(); ++i)
+                maxError = std::max(maxError, fabsf(c.values[i] - reference.values[i]));
+            error = QString::number(maxError);
+        }
+
+        qDebug("%6d %10.3f %10.2f %s", size, seconds * 1e3, gflops, qPrintable(error));
+    }
+    return 0;
+}
+
+int runGemm(const QString &fileA, const QString &fileB, const QString &fileC)
+{
+    DenseMatrix a, b, c;
+    QString error;
+    if (!a.load(fileA, &error) || !b.load(fileB, &error))
+    {
+        qWarning("%s", qPrintable(error));
+        return 1;
+    }
+    if (a.columns != b.rows)
+    {
+        qWarning("Can not multiply %dx%d by %dx%d", a.rows, a.columns, b.rows, b.columns);
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    DenseMatrix::multiply(a, b, c);
+    double seconds = timer.nsecsElapsed() / 1e9;
+    qDebug("%dx%d * %dx%d in %.3f ms, %.2f GFLOP/s", a.rows, a.columns, b.rows, b.columns, seconds * 1e3,
+           2.0 * a.rows * a.columns * b.columns / seconds / 1e9);
+
+    if (!fileC.isEmpty() && !c.save(fileC))
+    {
+        qWarning("Could not write %s", qPrintable(fileC));
+        return 1;
+    }
+    return 0;
+}
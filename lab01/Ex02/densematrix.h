@@ -0,0 +1,49 @@
+#ifndef DENSEMATRIX_H
+#define DENSEMATRIX_H
+
+#include <QString>
+
+#include <vector>
+
+// Row-major rows x columns float matrix of any size.
+class DenseMatrix
+{
+public:
+    DenseMatrix(int _rows = 0, int _columns = 0);
+
+    int rows;
+    int columns;
+    std::vector<float> values;
+
+    float operator()(int row, int column) const { return values[size_t(row) * columns + column]; }
+    float &operator()(int row, int column) { return values[size_t(row) * columns + column]; }
+
+    void resize(int _rows, int _columns);
+    void randomize();
+
+    // ".bin" files hold two int32 (rows, columns) followed by the float32 values
+    // row by row; anything else is read as CSV, one row per line
+    bool load(const QString &fileName, QString *error = nullptr);
+    bool save(const QString &fileName) const;
+
+    // c = a * b. Cache blocked and packed: B is packed in KC x NC panels, A in
+    // MC x KC blocks, and a MR x NR register tile accumulates in the micro
+    // kernel. Blocks of C are spread over numThreads (0 = all cores).
+    static void multiply(const DenseMatrix &a, const DenseMatrix &b, DenseMatrix &c, int numThreads = 0);
+    static void multiplyNaive(const DenseMatrix &a, const DenseMatrix &b, DenseMatrix &c);
+
+    static const int MR = 6;
+    static const int NR = 8;
+    static const int MC = 96;
+    static const int KC = 256;
+    static const int NC = 4096;
+    static const int NC_SPLIT = 256; // Columns of a panel one thread works on
+};
+
+// Ex02 --gemm-benchmark: GFLOP/s of square products from 64 up to maxSize
+int runGemmBenchmark(int maxSize);
+
+// Ex02 --gemm a b [c]: multiplies two matrix files, optionally saving the product
+int runGemm(const QString &fileA, const QString &fileB, const QString &fileC);
+
+#endif // DENSEMATRIX_H
@@ -1,8 +1,26 @@
 #include "mainwindow.h"
+#include "benchmark.h"
+#include "densematrix.h"
 #include <QApplication>
 
+#include <stdlib.h>
+#include <string.h>
+
 int main(int argc, char *argv[])
 {
+    // Ex02 --benchmark [iterations]: compare Matrix4 with QMatrix4x4 and exit
+    if (argc > 1 && strcmp(argv[1], "--benchmark") == 0)
+        return runBenchmark(argc > 2 ? atoi(argv[2]) : 10000000);
+
+    // Ex02 --gemm-benchmark [max size]: GFLOP/s of square products, 64 and up
+    if (argc > 1 && strcmp(argv[1], "--gemm-benchmark") == 0)
+        return runGemmBenchmark(argc > 2 ? atoi(argv[2]) : 4096);
+
+    // Ex02 --gemm a b [c]: multiply matrix files (CSV or .bin)
+    if (argc > 3 && strcmp(argv[1], "--gemm") == 0)
+        return runGemm(QString::fromLocal8Bit(argv[2]), QString::fromLocal8Bit(argv[3]),
+                       argc > 4 ? QString::fromLocal8Bit(argv[4]) : QString());
+
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
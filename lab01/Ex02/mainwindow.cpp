@@ -1,6 +1,8 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 
+#include <QRegularExpression>
+
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
     ui(new Ui::MainWindow)
@@ -16,39 +18,51 @@ MainWindow::~MainWindow()
 
 void MainWindow::calculate()
 {
-    QString inputA = ui->lineEditMatrixA->text();
-    QString inputB = ui->lineEditMatrixB->text();
-
-    QStringList matrixA = convert_to_matrix(inputA);
-    QStringList matrixB = convert_to_matrix(inputB);
+    Matrix4 matrixA, matrixB;
 
-    QString sum = sum_matrices(matrixA, matrixB);
+    if ( !convert_to_matrix(ui->lineEditMatrixA->text(), matrixA) ||
+         !convert_to_matrix(ui->lineEditMatrixB->text(), matrixB) )
+    {
+        ui->statusBar->showMessage("Each matrix needs 16 values, e.g. [(1,0,0,0);(0,1,0,0);(0,0,1,0);(0,0,0,1)]");
+        return;
+    }
+    ui->statusBar->clearMessage();
 
+    ui->label->setText("A + B: " + matrix_to_text(matrixA + matrixB));
+    ui->label_2->setText("A . B: " + matrix_to_text(matrixA * matrixB));
+    ui->label_3->setText("B . A: " + matrix_to_text(matrixB * matrixA));
+    ui->label_4->setText("A . A^t: " + matrix_to_text(matrixA * matrixA.transposed()));
 }
 
-QStringList MainWindow::convert_to_matrix(QString matrix)
+// Reads the 16 values row by row, brackets and separators are free form
+bool MainWindow::convert_to_matrix( const QString &text, Matrix4 &matrix )
 {
-    QStringList parsed;
-    QStringList row;
-    parsed = matrix.replace('[[', '[').replace(']]', ']').split(';');
-    int i;
-    for ( i = 0; i < 4; i++ ) {
-        row = parsed[i].remove('(').remove(')').split(',');
-        parsed.append(row);
+    static const QRegularExpression number("[-+]?(\\d+\\.?\\d*|\\.\\d+)([eE][-+]?\\d+)?");
+
+    float values[16];
+    int count = 0;
+    QRegularExpressionMatchIterator it = number.globalMatch(text);
+    while ( it.hasNext() )
+    {
+        if ( count == 16 )
+            return false;
+        values[count++] = it.next().captured(0).toFloat();
     }
-    return parsed;
+    if ( count != 16 )
+        return false;
+
+    matrix = Matrix4(values);
+    return true;
 }
 
-QString MainWindow::sum_matrices( QStringList A, QStringList B )
+QString MainWindow::matrix_to_text( const Matrix4 &matrix )
 {
-    QString result;
-    result.append('[');
-    float row[4];
-    int i, j;
-    for ( i = 0; i < 4; i++ ) {
-        for ( j = 0; j < 4; j++) {
-            row[j] = (float)A[i][j] + (float)B[i][j];
-        }
-        result.append(row.to_text());
+    QString result("[");
+    for ( int i = 0; i < 4; i++ ) {
+        if ( i )
+            result.append(';');
+        result.append(QString("(%1,%2,%3,%4)").arg(matrix(i, 0)).arg(matrix(i, 1)).arg(matrix(i, 2)).arg(matrix(i, 3)));
     }
+    result.append(']');
+    return result;
 }
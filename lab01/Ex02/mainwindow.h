@@ -3,6 +3,8 @@
 
 #include <QMainWindow>
 
+#include "matrix4.h"
+
 namespace Ui {
 class MainWindow;
 }
@@ -17,12 +19,11 @@ public:
 
 private:
     Ui::MainWindow *ui;
-    QStringList convert_to_matrix( QString );
+    static bool convert_to_matrix( const QString &, Matrix4 & );
+    static QString matrix_to_text( const Matrix4 & );
 
 public slots:
-    void MainWindow::calculate( void );
-    QString MainWindow::sum_matrices( QStringList, QStringList );
-    QString MainWindow::multipy_matrices( QStringList, QStringList );
+    void calculate( void );
 
 };
 
@@ -0,0 +1,337 @@
+#include "matrix4.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define MATRIX4_SSE
+#endif
+
+#ifdef MATRIX4_SSE
+#define SHUFFLE_MASK(x, y, z, w) ((x) | ((y) << 2) | ((z) << 4) | ((w) << 6))
+#define SWIZZLE(v, x, y, z, w) _mm_shuffle_ps(v, v, SHUFFLE_MASK(x, y, z, w))
+
+// 2x2 blocks packed into one register as (a00, a01, a10, a11)
+
+// A * B
+static inline __m128 mat2Mul(__m128 a, __m128 b)
+{
+    return _mm_add_ps(_mm_mul_ps(a, SWIZZLE(b, 0, 3, 0, 3)),
+                      _mm_mul_ps(SWIZZLE(a, 1, 0, 3, 2), SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+// adj(A) * B
+static inline __m128 mat2AdjMul(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(SWIZZLE(a, 3, 3, 0, 0), b),
+                      _mm_mul_ps(SWIZZLE(a, 1, 1, 2, 2), SWIZZLE(b, 2, 3, 0, 1)));
+}
+
+// A * adj(B)
+static inline __m128 mat2MulAdj(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(a, SWIZZLE(b, 3, 0, 3, 0)),
+                      _mm_mul_ps(SWIZZLE(a, 1, 0, 3, 2), SWIZZLE(b, 2, 1, 2, 1)));
+}
+#endif
+
+Matrix4::Matrix4()
+{
+    memset(m, 0, sizeof(m));
+    m[0] = m[5] = m[10] = m[15] = 1.0f;
+}
+
+Matrix4::Matrix4(const float *values)
+{
+    for (int row = 0; row < 4; ++row)
+        for (int column = 0; column < 4; ++column)
+            m[column * 4 + row] = values[row * 4 + column];
+}
+
+Matrix4 Matrix4::operator+(const Matrix4 &other) const
+{
+    Matrix4 result;
+#ifdef MATRIX4_SSE
+    for (int i = 0; i < 16; i += 4)
+        _mm_store_ps(result.m + i, _mm_add_ps(_mm_load_ps(m + i), _mm_load_ps(other.m + i)));
+#else
+    for (int i = 0; i < 16; ++i)
+        result.m[i] = m[i] + other.m[i];
+#endif
+    return result;
+}
+
+Matrix4 Matrix4::operator*(const Matrix4 &other) const
+{
+    Matrix4 result;
+#ifdef MATRIX4_SSE
+    __m128 c0 = _mm_load_ps(m);
+    __m128 c1 = _mm_load_ps(m + 4);
+    __m128 c2 = _mm_load_ps(m + 8);
+    __m128 c3 = _mm_load_ps(m + 12);
+
+    // Every result column combines the columns of this matrix
+    for (int j = 0; j < 16; j += 4)
+    {
+        __m128 r = _mm_mul_ps(c0, _mm_set1_ps(other.m[j]));
+        r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(other.m[j + 1])));
+        r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(other.m[j + 2])));
+        r = _mm_add_ps(r, _mm_mul_ps(c3, _mm_set1_ps(other.m[j + 3])));
+        _mm_store_ps(result.m + j, r);
+    }
+#else
+    for (int column = 0; column < 4; ++column)
+    {
+        for (int row = 0; row < 4; ++row)
+        {
+            float sum = 0;
+            for (int k = 0; k < 4; ++k)
+                sum += (*this)(row, k) * other(k, column);
+            result(row, column) = sum;
+        }
+    }
+#endif
+    return result;
+}
+
+Matrix4 Matrix4::transposed() const
+{
+    Matrix4 result;
+#ifdef MATRIX4_SSE
+    __m128 c0 = _mm_load_ps(m);
+    __m128 c1 = _mm_load_ps(m + 4);
+    __m128 c2 = _mm_load_ps(m + 8);
+    __m128 c3 = _mm_load_ps(m + 12);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    _mm_store_ps(result.m, c0);
+    _mm_store_ps(result.m + 4, c1);
+    _mm_store_ps(result.m + 8, c2);
+    _mm_store_ps(result.m + 12, c3);
+#else
+    for (int row = 0; row < 4; ++row)
+        for (int column = 0; column < 4; ++column)
+            result(row, column) = (*this)(column, row);
+#endif
+    return result;
+}
+
+// Not invertible gives the identity, as QMatrix4x4 does
+Matrix4 Matrix4::inverted(bool *invertible) const
+{
+    Matrix4 result;
+#ifdef MATRIX4_SSE
+    // Block inverse on 2x2 sub matrices. It is written for rows, fed with
+    // columns it inverts the transpose, whose rows are the wanted columns.
+    __m128 v0 = _mm_load_ps(m);
+    __m128 v1 = _mm_load_ps(m + 4);
+    __m128 v2 = _mm_load_ps(m + 8);
+    __m128 v3 = _mm_load_ps(m + 12);
+
+    __m128 a = _mm_movelh_ps(v0, v1);
+    __m128 b = _mm_movehl_ps(v1, v0);
+    __m128 c = _mm_movelh_ps(v2, v3);
+    __m128 d = _mm_movehl_ps(v3, v2);
+
+    // (|A|, |B|, |C|, |D|)
+    __m128 detSub = _mm_sub_ps(
+        _mm_mul_ps(_mm_shuffle_ps(v0, v2, SHUFFLE_MASK(0, 2, 0, 2)), _mm_shuffle_ps(v1, v3, SHUFFLE_MASK(1, 3, 1, 3))),
+        _mm_mul_ps(_mm_shuffle_ps(v0, v2, SHUFFLE_MASK(1, 3, 1, 3)), _mm_shuffle_ps(v1, v3, SHUFFLE_MASK(0, 2, 0, 2))));
+    __m128 detA = SWIZZLE(detSub, 0, 0, 0, 0);
+    __m128 detB = SWIZZLE(detSub, 1, 1, 1, 1);
+    __m128 detC = SWIZZLE(detSub, 2, 2, 2, 2);
+    __m128 detD = SWIZZLE(detSub, 3, 3, 3, 3);
+
+    __m128 dc = mat2AdjMul(d, c);
+    __m128 ab = mat2AdjMul(a, b);
+    __m128 x = _mm_sub_ps(_mm_mul_ps(detD, a), mat2Mul(b, dc));
+    __m128 w = _mm_sub_ps(_mm_mul_ps(detA, d), mat2Mul(c, ab));
+    __m128 y = _mm_sub_ps(_mm_mul_ps(detB, c), mat2MulAdj(d, ab));
+    __m128 z = _mm_sub_ps(_mm_mul_ps(detC, b), mat2MulAdj(a, dc));
+
+    // |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+    __m128 trace = _mm_mul_ps(ab, SWIZZLE(dc, 0, 2, 1, 3));
+    trace = _mm_add_ps(trace, SWIZZLE(trace, 1, 0, 3, 2));
+    trace = _mm_add_ps(trace, SWIZZLE(trace, 2, 3, 0, 1));
+    __m128 det = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), trace);
+
+    float determinant = _mm_cvtss_f32(det);
+    bool ok = determinant != 0.0f && isfinite(determinant);
+    if (invertible)
+        *invertible = ok;
+    if (!ok)
+        return result;
+
+    __m128 reciprocal = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det);
+    x = _mm_mul_ps(x, reciprocal);
+    y = _mm_mul_ps(y, reciprocal);
+    z = _mm_mul_ps(z, reciprocal);
+    w = _mm_mul_ps(w, reciprocal);
+
+    _mm_store_ps(result.m, _mm_shuffle_ps(x, y, SHUFFLE_MASK(3, 1, 3, 1)));
+    _mm_store_ps(result.m + 4, _mm_shuffle_ps(x, y, SHUFFLE_MASK(2, 0, 2, 0)));
+    _mm_store_ps(result.m + 8, _mm_shuffle_ps(z, w, SHUFFLE_MASK(3, 1, 3, 1)));
+    _mm_store_ps(result.m + 12, _mm_shuffle_ps(z, w, SHUFFLE_MASK(2, 0, 2, 0)));
+#else
+    // Cofactor expansion, the index pattern works for either storage order
+    const float *s = m;
+    float *inv = result.m;
+
+    inv[0] = s[5] * s[10] * s[15] - s[5] * s[11] * s[14] - s[9] * s[6] * s[15] + s[9] * s[7] * s[14] + s[13] * s[6] * s[11] - s[13] * s[7] * s[10];
+    inv[4] = -s[4] * s[10] * s[15] + s[4] * s[11] * s[14] + s[8] * s[6] * s[15] - s[8] * s[7] * s[14] - s[12] * s[6] * s[11] + s[12] * s[7] * s[10];
+    inv[8] = s[4] * s[9] * s[15] - s[4] * s[11] * s[13] - s[8] * s[5] * s[15] + s[8] * s[7] * s[13] + s[12] * s[5] * s[11] - s[12] * s[7] * s[9];
+    inv[12] = -s[4] * s[9] * s[14] + s[4] * s[10] * s[13] + s[8] * s[5] * s[14] - s[8] * s[6] * s[13] - s[12] * s[5] * s[10] + s[12] * s[6] * s[9];
+    inv[1] = -s[1] * s[10] * s[15] + s[1] * s[11] * s[14] + s[9] * s[2] * s[15] - s[9] * s[3] * s[14] - s[13] * s[2] * s[11] + s[13] * s[3] * s[10];
+    inv[5] = s[0] * s[10] * s[15] - s[0] * s[11] * s[14] - s[8] * s[2] * s[15] + s[8] * s[3] * s[14] + s[12] * s[2] * s[11] - s[12] * s[3] * s[10];
+    inv[9] = -s[0] * s[9] * s[15] + s[0] * s[11] * s[13] + s[8] * s[1] * s[15] - s[8] * s[3] * s[13] - s[12] * s[1] * s[11] + s[12] * s[3] * s[9];
+    inv[13] = s[0] * s[9] * s[14] - s[0] * s[10] * s[13] - s[8] * s[1] * s[14] + s[8] * s[2] * s[13] + s[12] * s[1] * s[10] - s[12] * s[2] * s[9];
+    inv[2] = s[1] * s[6] * s[15] - s[1] * s[7] * s[14] - s[5] * s[2] * s[15] + s[5] * s[3] * s[14] + s[13] * s[2] * s[7] - s[13] * s[3] * s[6];
+    inv[6] = -s[0] * s[6] * s[15] + s[0] * s[7] * s[14] + s[4] * s[2] * s[15] - s[4] * s[3] * s[14] - s[12] * s[2] * s[7] + s[12] * s[3] * s[6];
+    inv[10] = s[0] * s[5] * s[15] - s[0] * s[7] * s[13] - s[4] * s[1] * s[15] + s[4] * s[3] * s[13] + s[12] * s[1] * s[7] - s[12] * s[3] * s[5];
+    inv[14] = -s[0] * s[5] * s[14] + s[0] * s[6] * s[13] + s[4] * s[1] * s[14] - s[4] * s[2] * s[13] - s[12] * s[1] * s[6] + s[12] * s[2] * s[5];
+    inv[3] = -s[1] * s[6] * s[11] + s[1] * s[7] * s[10] + s[5] * s[2] * s[11] - s[5] * s[3] * s[10] - s[9] * s[2] * s[7] + s[9] * s[3] * s[6];
+    inv[7] = s[0] * s[6] * s[11] - s[0] * s[7] * s[10] - s[4] * s[2] * s[11] + s[4] * s[3] * s[10] + s[8] * s[2] * s[7] - s[8] * s[3] * s[6];
+    inv[11] = -s[0] * s[5] * s[11] + s[0] * s[7] * s[9] + s[4] * s[1] * s[11] - s[4] * s[3] * s[9] - s[8] * s[1] * s[7] + s[8] * s[3] * s[5];
+    inv[15] = s[0] * s[5] * s[10] - s[0] * s[6] * s[9] - s[4] * s[1] * s[10] + s[4] * s[2] * s[9] + s[8] * s[1] * s[6] - s[8] * s[2] * s[5];
+
+    float determinant = s[0] * inv[0] + s[1] * inv[4] + s[2] * inv[8] + s[3] * inv[12];
+    bool ok = determinant != 0.0f && isfinite(determinant);
+    if (invertible)
+        *invertible = ok;
+    if (!ok)
+        return Matrix4();
+
+    for (int i = 0; i < 16; ++i)
+        inv[i] /= determinant;
+#endif
+    return result;
+}
+
+void Matrix4::normalMatrix(float *out) const
+{
+    // Inverse transpose of the upper 3x3 is its cofactor matrix over the determinant
+    const Matrix4 &a = *this;
+    float cofactors[9] = {
+        a(1, 1) * a(2, 2) - a(1, 2) * a(2, 1),
+        a(1, 2) * a(2, 0) - a(1, 0) * a(2, 2),
+        a(1, 0) * a(2, 1) - a(1, 1) * a(2, 0),
+        a(0, 2) * a(2, 1) - a(0, 1) * a(2, 2),
+        a(0, 0) * a(2, 2) - a(0, 2) * a(2, 0),
+        a(0, 1) * a(2, 0) - a(0, 0) * a(2, 1),
+        a(0, 1) * a(1, 2) - a(0, 2) * a(1, 1),
+        a(0, 2) * a(1, 0) - a(0, 0) * a(1, 2),
+        a(0, 0) * a(1, 1) - a(0, 1) * a(1, 0)};
+
+    float determinant = a(0, 0) * cofactors[0] + a(0, 1) * cofactors[1] + a(0, 2) * cofactors[2];
+    if (determinant == 0.0f)
+    {
+        const float identity[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+        memcpy(out, identity, sizeof(identity));
+        return;
+    }
+
+    // cofactors is indexed [row * 3 + column], out is column-major
+    float reciprocal = 1.0f / determinant;
+    for (int row = 0; row < 3; ++row)
+        for (int column = 0; column < 3; ++column)
+            out[column * 3 + row] = cofactors[row * 3 + column] * reciprocal;
+}
+
+void Matrix4::transformPoints(const float *points, float *out, size_t count) const
+{
+    bool affine = m[3] == 0.0f && m[7] == 0.0f && m[11] == 0.0f && m[15] == 1.0f;
+    size_t i = 0;
+
+#ifdef MATRIX4_SSE
+    const __m128 m00 = _mm_set1_ps(m[0]), m10 = _mm_set1_ps(m[1]), m20 = _mm_set1_ps(m[2]), m30 = _mm_set1_ps(m[3]);
+    const __m128 m01 = _mm_set1_ps(m[4]), m11 = _mm_set1_ps(m[5]), m21 = _mm_set1_ps(m[6]), m31 = _mm_set1_ps(m[7]);
+    const __m128 m02 = _mm_set1_ps(m[8]), m12 = _mm_set1_ps(m[9]), m22 = _mm_set1_ps(m[10]), m32 = _mm_set1_ps(m[11]);
+    const __m128 m03 = _mm_set1_ps(m[12]), m13 = _mm_set1_ps(m[13]), m23 = _mm_set1_ps(m[14]), m33 = _mm_set1_ps(m[15]);
+
+    // Four points per iteration: three loads of xyz triplets shuffled into x, y and z registers
+    for (; i + 4 <= count; i += 4)
+    {
+        const float *p = points + i * 3;
+        __m128 a = _mm_loadu_ps(p);
+        __m128 b = _mm_loadu_ps(p + 4);
+        __m128 c = _mm_loadu_ps(p + 8);
+
+        __m128 x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, SHUFFLE_MASK(2, 2, 1, 1)), SHUFFLE_MASK(0, 3, 0, 2));
+        __m128 y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, SHUFFLE_MASK(1, 1, 0, 0)),
+                                  _mm_shuffle_ps(b, c, SHUFFLE_MASK(3, 3, 2, 2)), SHUFFLE_MASK(0, 2, 0, 2));
+        __m128 z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, SHUFFLE_MASK(2, 2, 1, 1)),
+                                  _mm_shuffle_ps(c, c, SHUFFLE_MASK(0, 0, 3, 3)), SHUFFLE_MASK(0, 2, 0, 2));
+
+        __m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, x), _mm_mul_ps(m01, y)), _mm_add_ps(_mm_mul_ps(m02, z), m03));
+        __m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m10, x), _mm_mul_ps(m11, y)), _mm_add_ps(_mm_mul_ps(m12, z), m13));
+        __m128 rz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m20, x), _mm_mul_ps(m21, y)), _mm_add_ps(_mm_mul_ps(m22, z), m23));
+        if (!affine)
+        {
+            __m128 rw = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m30, x), _mm_mul_ps(m31, y)), _mm_add_ps(_mm_mul_ps(m32, z), m33));
+            rx = _mm_div_ps(rx, rw);
+            ry = _mm_div_ps(ry, rw);
+            rz = _mm_div_ps(rz, rw);
+        }
+
+        // And back to triplets
+        float *o = out + i * 3;
+        _mm_storeu_ps(o, _mm_shuffle_ps(_mm_shuffle_ps(rx, ry, SHUFFLE_MASK(0, 0, 0, 0)),
+                                        _mm_shuffle_ps(rz, rx, SHUFFLE_MASK(0, 0, 1, 1)), SHUFFLE_MASK(0, 2, 0, 2)));
+        _mm_storeu_ps(o + 4, _mm_shuffle_ps(_mm_shuffle_ps(ry, rz, SHUFFLE_MASK(1, 1, 1, 1)),
+                                            _mm_shuffle_ps(rx, ry, SHUFFLE_MASK(2, 2, 2, 2)), SHUFFLE_MASK(0, 2, 0, 2)));
+        _mm_storeu_ps(o + 8, _mm_shuffle_ps(_mm_shuffle_ps(rz, rx, SHUFFLE_MASK(2, 2, 3, 3)),
+                                            _mm_shuffle_ps(ry, rz, SHUFFLE_MASK(3, 3, 3, 3)), SHUFFLE_MASK(0, 2, 0, 2)));
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        float x = points[i * 3], y = points[i * 3 + 1], z = points[i * 3 + 2];
+        float rx = m[0] * x + m[4] * y + m[8] * z + m[12];
+        float ry = m[1] * x + m[5] * y + m[9] * z + m[13];
+        float rz = m[2] * x + m[6] * y + m[10] * z + m[14];
+        if (!affine)
+        {
+            float rw = m[3] * x + m[7] * y + m[11] * z + m[15];
+            rx /= rw;
+            ry /= rw;
+            rz /= rw;
+        }
+        out[i * 3] = rx;
+        out[i * 3 + 1] = ry;
+        out[i * 3 + 2] = rz;
+    }
+}
+
+Matrix4 Matrix4::translation(float x, float y, float z)
+{
+    Matrix4 result;
+    result.m[12] = x;
+    result.m[13] = y;
+    result.m[14] = z;
+    return result;
+}
+
+Matrix4 Matrix4::scaling(float x, float y, float z)
+{
+    Matrix4 result;
+    result.m[0] = x;
+    result.m[5] = y;
+    result.m[10] = z;
+    return result;
+}
+
+Matrix4 Matrix4::rotation(float x, float y, float z, float w)
+{
+    Matrix4 result;
+    result(0, 0) = 1.0f - 2.0f * (y * y + z * z);
+    result(0, 1) = 2.0f * (x * y - z * w);
+    result(0, 2) = 2.0f * (x * z + y * w);
+    result(1, 0) = 2.0f * (x * y + z * w);
+    result(1, 1) = 1.0f - 2.0f * (x * x + z * z);
+    result(1, 2) = 2.0f * (y * z - x * w);
+    result(2, 0) = 2.0f * (x * z - y * w);
+    result(2, 1) = 2.0f * (y * z + x * w);
+    result(2, 2) = 1.0f - 2.0f * (x * x + y * y);
+    return result;
+}
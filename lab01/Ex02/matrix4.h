@@ -0,0 +1,39 @@
+#ifndef MATRIX4_H
+#define MATRIX4_H
+
+#include <cstddef>
+
+// 4x4 float matrix stored column-major like QMatrix4x4 and OpenGL, so data()
+// can go straight to glUniformMatrix4fv. Each column is one 16 byte aligned
+// SSE register; every operation has a scalar fallback for builds without SSE.
+class alignas(16) Matrix4
+{
+public:
+    Matrix4(); // Identity
+    explicit Matrix4(const float *values); // 16 values in row-major order, as they are written
+
+    float operator()(int row, int column) const { return m[column * 4 + row]; }
+    float &operator()(int row, int column) { return m[column * 4 + row]; }
+
+    const float *data() const { return m; }
+
+    Matrix4 operator+(const Matrix4 &other) const;
+    Matrix4 operator*(const Matrix4 &other) const;
+    Matrix4 transposed() const;
+    Matrix4 inverted(bool *invertible = nullptr) const;
+
+    // Upper 3x3 of the inverse transpose, column-major, for lighting normals
+    void normalMatrix(float *out) const;
+
+    // points holds count x, y, z triplets; results are divided by w when w != 1
+    void transformPoints(const float *points, float *out, size_t count) const;
+
+    static Matrix4 translation(float x, float y, float z);
+    static Matrix4 scaling(float x, float y, float z);
+    static Matrix4 rotation(float x, float y, float z, float w); // Unit quaternion
+
+private:
+    float m[16];
+};
+
+#endif // MATRIX4_H
@@ -17,6 +17,15 @@ TEMPLATE = app
 # deprecated API in order to know how to port your code away from it.
 DEFINES += QT_DEPRECATED_WARNINGS
 
+CONFIG += c++14
+
+# The tic-tac-toe table is solved by the compiler, which takes more constexpr
+# evaluation steps than clang and MSVC allow by default
+*clang*: QMAKE_CXXFLAGS += -fconstexpr-steps=100000000
+msvc: QMAKE_CXXFLAGS += /constexpr:steps100000000
+
+unix: LIBS += -lpthread
+
 # You can also make your code fail to compile if you use deprecated APIs.
 # In order to do so, uncomment the following line.
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
@@ -25,10 +34,16 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 SOURCES += \
         main.cpp \
-        mainwindow.cpp
+        mainwindow.cpp \
+        mnkgame.cpp \
+        tictactoe.cpp \
+        benchmark.cpp
 
 HEADERS += \
-        mainwindow.h
+        mainwindow.h \
+        mnkgame.h \
+        tictactoe.h \
+        benchmark.h
 
 FORMS += \
         mainwindow.ui
@@ -0,0 +1,90 @@
+#include "benchmark.h"
+#include "mnkgame.h"
+
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+struct BenchmarkPosition
+{
+    const char *name;
+    int width, height, k;
+    int maxDepth;
+    int opening[8][2]; // Moves played before searching, row and column; -1 ends the list
+};
+
+int runBenchmark(int timeLimitMs)
+{
+    const BenchmarkPosition positions[] = {
+        {"tic-tac-toe, solved", 3, 3, 3, 9, {{-1, -1}}},
+        {"4,4,3 (first player wins)", 4, 4, 3, 16, {{-1, -1}}},
+        {"4,4,4, solved", 4, 4, 4, 16, {{-1, -1}}},
+        {"gomoku 15,15,5 opening", 15, 15, 5, 64, {{7, 7}, {7, 8}, {8, 8}, {6, 6}, {8, 7}, {-1, -1}}},
+    };
+
+    unsigned long long totalNodes = 0;
+    double totalSeconds = 0;
+
+    for (const BenchmarkPosition &position : positions)
+    {
+        MnkGame game(position.width, position.height, position.k);
+        for (int i = 0; i < 8 && position.opening[i][0] >= 0; ++i)
+            game.play(game.cell(position.opening[i][0], position.opening[i][1]));
+
+        MnkSearch search;
+        SearchResult result = search.search(game, position.maxDepth, timeLimitMs);
+
+        const char *outcome = result.score >= MnkSearch::WIN_THRESHOLD ? "win" :
+                              result.score <= -MnkSearch::WIN_THRESHOLD ? "loss" : "";
+        printf("%-28s depth %2d  move (%d,%d)  score %8d %-4s  %12llu nodes  %8.3f s  %10.0f nodes/s\n",
+               position.name, result.depth, result.move / game.stride, result.move % game.stride,
+               result.score, outcome, static_cast<unsigned long long>(result.nodes), result.seconds,
+               result.nodes / (result.seconds > 0 ? result.seconds : 1e-9));
+
+        totalNodes += result.nodes;
+        totalSeconds += result.seconds;
+    }
+
+    printf("total %llu nodes in %.3f s, %.0f nodes/s\n", totalNodes, totalSeconds,
+           totalNodes / (totalSeconds > 0 ? totalSeconds : 1e-9));
+    return 0;
+}
+
+int runSmpBenchmark(int depth)
+{
+    const BenchmarkPosition positions[] = {
+        {"gomoku opening A", 15, 15, 5, depth, {{7, 7}, {7, 8}, {8, 8}, {6, 6}, {8, 7}, {-1, -1}}},
+        {"gomoku opening B", 15, 15, 5, depth, {{7, 7}, {8, 8}, {6, 8}, {8, 6}, {8, 7}, {6, 7}, {-1, -1}}},
+    };
+
+    int cores = static_cast<int>(std::thread::hardware_concurrency());
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < cores; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(cores > 0 ? cores : 1);
+
+    for (const BenchmarkPosition &position : positions)
+    {
+        double baseline = 0;
+        printf("%s, depth %d\n", position.name, position.maxDepth);
+
+        for (int threads : threadCounts)
+        {
+            MnkGame game(position.width, position.height, position.k);
+            for (int i = 0; i < 8 && position.opening[i][0] >= 0; ++i)
+                game.play(game.cell(position.opening[i][0], position.opening[i][1]));
+
+            // A fresh table each time, so no run profits from the previous one
+            MnkSearch search(22);
+            SearchResult result = search.search(game, position.maxDepth, 0, threads);
+            if (threads == 1)
+                baseline = result.seconds;
+
+            printf("  %3d threads  %8.3f s  speedup %5.2fx  %12llu nodes  %10.0f nodes/s  move (%d,%d) score %d\n",
+                   threads, result.seconds, baseline / result.seconds, static_cast<unsigned long long>(result.nodes),
+                   result.nodes / (result.seconds > 0 ? result.seconds : 1e-9),
+                   result.move / game.stride, result.move % game.stride, result.score);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,11 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+// Searches a few fixed positions and reports nodes per second
+int runBenchmark(int timeLimitMs);
+
+// Searches fixed 15,15,5 positions to a fixed depth with 1, 2, 4... threads up
+// to every core and reports the time to depth speedup over one thread
+int runSmpBenchmark(int depth);
+
+#endif // BENCHMARK_H
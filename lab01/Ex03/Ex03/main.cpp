@@ -1,8 +1,25 @@
 #include "mainwindow.h"
+#include "benchmark.h"
+#include "tictactoe.h"
 #include <QApplication>
 
+#include <stdlib.h>
+#include <string.h>
+
 int main(int argc, char *argv[])
 {
+    // Ex03 --benchmark [ms per position]: search fixed positions and report nodes/s
+    if (argc > 1 && strcmp(argv[1], "--benchmark") == 0)
+        return runBenchmark(argc > 2 ? atoi(argv[2]) : 5000);
+
+    // Ex03 --smp-benchmark [depth]: time to depth with more and more threads
+    if (argc > 1 && strcmp(argv[1], "--smp-benchmark") == 0)
+        return runSmpBenchmark(argc > 2 ? atoi(argv[2]) : 6);
+
+    // Ex03 --self-check: compare the compile time tic-tac-toe table with the search
+    if (argc > 1 && strcmp(argv[1], "--self-check") == 0)
+        return TicTacToe::selfCheck() ? 0 : 1;
+
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
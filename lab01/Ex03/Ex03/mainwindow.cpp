@@ -1,17 +1,25 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include "tictactoe.h"
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
-    ui(new Ui::MainWindow)
+    ui(new Ui::MainWindow),
+    game(3, 3, 3)
 {
     ui->setupUi(this);
 
-    int position_matrix[3][3] = {{-1,-1,-1}, {-1,-1,-1}, {-1,-1,-1}};
-    char player = 'X';
-    bool end = false;
-
+    QPushButton *grid[3][3] = {{ui->pushButton11, ui->pushButton12, ui->pushButton13},
+                               {ui->pushButton21, ui->pushButton22, ui->pushButton23},
+                               {ui->pushButton31, ui->pushButton32, ui->pushButton33}};
+    for ( int row = 0; row < 3; row++ ) {
+        for ( int column = 0; column < 3; column++ ) {
+            buttons[row][column] = grid[row][column];
+            connect(grid[row][column], &QPushButton::clicked, this, [this, row, column]() { cell_clicked(row, column); });
+        }
+    }
 
+    update_state();
 }
 
 MainWindow::~MainWindow()
@@ -19,7 +27,65 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
-int MainWindow::update_state(int position_matrix[3][3]) {
+void MainWindow::cell_clicked( int row, int column )
+{
+    // Any click after the end starts a new game
+    if ( end ) {
+        game.reset();
+        position = 0;
+        end = false;
+        update_state();
+        return;
+    }
+
+    int cell = game.cell(row, column);
+    if ( game.stoneAt(cell) >= 0 )
+        return;
+
+    play(row, column);
+    if ( !finish_move(cell) ) {
+        // One table load instead of a search
+        int square = TicTacToe::bestMove(position);
+        play(square / 3, square % 3);
+        finish_move(game.cell(square / 3, square % 3));
+    }
 
+    update_state();
+}
+
+void MainWindow::play( int row, int column )
+{
+    position = TicTacToe::play(position, row * 3 + column, game.sideToMove);
+    game.play(game.cell(row, column));
+}
+
+// Checks whether the move just played ended the game
+bool MainWindow::finish_move( int cell )
+{
+    int player = game.sideToMove ^ 1;
+    if ( game.wins(player, cell) ) {
+        result = player == 0 ? "X wins!" : "O wins!";
+        end = true;
+    }
+    else if ( game.isFull() ) {
+        result = "Draw!";
+        end = true;
+    }
+    return end;
+}
+
+void MainWindow::update_state( void )
+{
+    for ( int row = 0; row < 3; row++ ) {
+        for ( int column = 0; column < 3; column++ ) {
+            int stone = game.stoneAt(game.cell(row, column));
+            buttons[row][column]->setText(stone == 0 ? "X" : (stone == 1 ? "O" : " "));
+        }
+    }
 
+    ui->label->setText(end ? result : "Player 1: X");
+    if ( end )
+        ui->statusBar->showMessage("Click any cell to play again");
+    else
+        ui->statusBar->clearMessage();
 }
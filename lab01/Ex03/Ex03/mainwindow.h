@@ -2,6 +2,9 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QPushButton>
+
+#include "mnkgame.h"
 
 namespace Ui {
 class MainWindow;
@@ -17,6 +20,21 @@ public:
 
 private:
     Ui::MainWindow *ui;
+
+    QPushButton *buttons[3][3];
+
+    // Player 1 (X) is the human, O answers from the perfect play table
+    MnkGame game;
+    int position = 0; // Base-3 index into TicTacToe's table
+    bool end = false;
+    QString result;
+
+    void play( int row, int column );
+    bool finish_move( int cell );
+    void update_state( void );
+
+public slots:
+    void cell_clicked( int row, int column );
 };
 
 #endif // MAINWINDOW_H
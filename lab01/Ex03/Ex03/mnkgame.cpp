@@ -0,0 +1,450 @@
+#include "mnkgame.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+int Bitboard::count() const
+{
+    return __builtin_popcountll(w[0]) + __builtin_popcountll(w[1]) +
+           __builtin_popcountll(w[2]) + __builtin_popcountll(w[3]);
+}
+
+int Bitboard::popLowest()
+{
+    for (int i = 0; i < WORDS; ++i)
+    {
+        if (w[i])
+        {
+            int bit = __builtin_ctzll(w[i]);
+            w[i] &= w[i] - 1;
+            return i * 64 + bit;
+        }
+    }
+    return -1;
+}
+
+Bitboard Bitboard::operator&(const Bitboard &o) const
+{
+    Bitboard r;
+    for (int i = 0; i < WORDS; ++i)
+        r.w[i] = w[i] & o.w[i];
+    return r;
+}
+
+Bitboard Bitboard::operator|(const Bitboard &o) const
+{
+    Bitboard r;
+    for (int i = 0; i < WORDS; ++i)
+        r.w[i] = w[i] | o.w[i];
+    return r;
+}
+
+Bitboard Bitboard::operator~() const
+{
+    Bitboard r;
+    for (int i = 0; i < WORDS; ++i)
+        r.w[i] = ~w[i];
+    return r;
+}
+
+bool Bitboard::operator==(const Bitboard &o) const
+{
+    return w[0] == o.w[0] && w[1] == o.w[1] && w[2] == o.w[2] && w[3] == o.w[3];
+}
+
+Bitboard Bitboard::shiftedUp(int n) const
+{
+    Bitboard r;
+    if (n == 0)
+        return *this;
+    for (int i = WORDS - 1; i > 0; --i)
+        r.w[i] = (w[i] << n) | (w[i - 1] >> (64 - n));
+    r.w[0] = w[0] << n;
+    return r;
+}
+
+Bitboard Bitboard::shiftedDown(int n) const
+{
+    Bitboard r;
+    if (n == 0)
+        return *this;
+    for (int i = 0; i < WORDS - 1; ++i)
+        r.w[i] = (w[i] >> n) | (w[i + 1] << (64 - n));
+    r.w[WORDS - 1] = w[WORDS - 1] >> n;
+    return r;
+}
+
+MnkGame::MnkGame(int _width, int _height, int _k)
+{
+    width = _width;
+    height = _height;
+    k = _k;
+    stride = width + 1;
+
+    for (int row = 0; row < height; ++row)
+        for (int column = 0; column < width; ++column)
+            boardMask.set(cell(row, column));
+
+    // Win masks: every run of k cells in the four directions
+    const int directions[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+    cellLines.resize(stride * height);
+    for (int row = 0; row < height; ++row)
+    {
+        for (int column = 0; column < width; ++column)
+        {
+            for (const auto &d : directions)
+            {
+                int endRow = row + d[0] * (k - 1);
+                int endColumn = column + d[1] * (k - 1);
+                if (endRow >= height || endColumn < 0 || endColumn >= width)
+                    continue;
+
+                Bitboard line;
+                for (int i = 0; i < k; ++i)
+                    line.set(cell(row + d[0] * i, column + d[1] * i));
+                for (int i = 0; i < k; ++i)
+                    cellLines[cell(row + d[0] * i, column + d[1] * i)].push_back(static_cast<int>(lines.size()));
+                lines.push_back(line);
+            }
+        }
+    }
+
+    // Fixed seed, so hashes are reproducible between runs
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    for (int player = 0; player < 2; ++player)
+    {
+        zobrist[player].resize(stride * height);
+        for (uint64_t &key : zobrist[player])
+        {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            key = state;
+        }
+    }
+}
+
+int MnkGame::stoneAt(int cell) const
+{
+    if (stones[0].test(cell))
+        return 0;
+    if (stones[1].test(cell))
+        return 1;
+    return -1;
+}
+
+void MnkGame::reset()
+{
+    stones[0] = Bitboard();
+    stones[1] = Bitboard();
+    sideToMove = 0;
+    numMoves = 0;
+    hash = 0;
+}
+
+void MnkGame::play(int cell)
+{
+    stones[sideToMove].set(cell);
+    hash ^= zobrist[sideToMove][cell];
+    sideToMove ^= 1;
+    numMoves++;
+}
+
+void MnkGame::undo(int cell)
+{
+    sideToMove ^= 1;
+    stones[sideToMove].clear(cell);
+    hash ^= zobrist[sideToMove][cell];
+    numMoves--;
+}
+
+bool MnkGame::wins(int player, int lastCell) const
+{
+    for (int line : cellLines[lastCell])
+        if ((stones[player] & lines[line]) == lines[line])
+            return true;
+    return false;
+}
+
+Bitboard MnkGame::emptyCells() const
+{
+    return ~(stones[0] | stones[1]) & boardMask;
+}
+
+// Small boards try every empty cell, large ones only cells touching a stone
+Bitboard MnkGame::candidateMoves() const
+{
+    Bitboard empty = emptyCells();
+    if (numCells() <= 25)
+        return empty;
+
+    Bitboard occupied = stones[0] | stones[1];
+    if (!occupied.any())
+    {
+        Bitboard centre;
+        centre.set(cell(height / 2, width / 2));
+        return centre;
+    }
+
+    Bitboard near = occupied;
+    const int shifts[4] = {1, stride - 1, stride, stride + 1};
+    for (int shift : shifts)
+        near = near | occupied.shiftedUp(shift) | occupied.shiftedDown(shift);
+    return near & empty;
+}
+
+TranspositionTable::TranspositionTable(int bits)
+{
+    slots.reset(new Slot[size_t(1) << bits]);
+    mask = (uint64_t(1) << bits) - 1;
+    clear();
+}
+
+void TranspositionTable::clear()
+{
+    for (uint64_t i = 0; i <= mask; ++i)
+    {
+        slots[i].check.store(0, std::memory_order_relaxed);
+        slots[i].data.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool TranspositionTable::probe(uint64_t key, Entry &entry) const
+{
+    const Slot &slot = slots[key & mask];
+    uint64_t data = slot.data.load(std::memory_order_relaxed);
+    uint64_t check = slot.check.load(std::memory_order_relaxed);
+    if ((check ^ data) != key || !data)
+        return false;
+
+    entry.score = static_cast<int32_t>(data & 0xFFFFFFFF);
+    entry.move = static_cast<int16_t>((data >> 32) & 0xFFFF);
+    entry.depth = static_cast<int8_t>((data >> 48) & 0xFF);
+    entry.bound = static_cast<int>(data >> 56);
+    return true;
+}
+
+void TranspositionTable::store(uint64_t key, const Entry &entry)
+{
+    uint64_t data = uint64_t(uint32_t(entry.score)) |
+                    uint64_t(uint16_t(entry.move)) << 32 |
+                    uint64_t(uint8_t(entry.depth)) << 48 |
+                    uint64_t(uint8_t(entry.bound)) << 56;
+
+    Slot &slot = slots[key & mask];
+    slot.check.store(key ^ data, std::memory_order_relaxed);
+    slot.data.store(data, std::memory_order_relaxed);
+}
+
+MnkSearch::MnkSearch(int tableBits) :
+    table(tableBits),
+    stop(false)
+{
+}
+
+void MnkSearch::clear()
+{
+    table.clear();
+}
+
+static int64_t nowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+SearchResult MnkSearch::search(MnkGame &game, int maxDepth, int timeLimitMs, int numThreads)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    stop = false;
+    deadline = timeLimitMs > 0 ? nowMs() + timeLimitMs : 0;
+    maxDepth = std::min(maxDepth, game.numCells() - game.numMoves);
+    numThreads = std::max(numThreads, 1);
+
+    std::vector<Worker> workers;
+    workers.reserve(numThreads);
+    for (int i = 0; i < numThreads; ++i)
+        workers.push_back(Worker{i, game, std::vector<int>(Bitboard::BITS, 0), 0, SearchResult()});
+
+    // Helpers run until the main thread is done with its last depth
+    std::vector<std::thread> helpers;
+    for (int i = 1; i < numThreads; ++i)
+        helpers.emplace_back(&MnkSearch::iterate, this, std::ref(workers[i]), maxDepth);
+    iterate(workers[0], maxDepth);
+    stop = true;
+    for (std::thread &helper : helpers)
+        helper.join();
+
+    SearchResult result = workers[0].result;
+
+    // Even a search stopped in its first pass must return something legal
+    if (result.move < 0)
+    {
+        Bitboard moves = game.candidateMoves();
+        result.move = moves.any() ? moves.popLowest() : -1;
+    }
+
+    result.nodes = 0;
+    for (const Worker &worker : workers)
+        result.nodes += worker.nodes;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+// Iterative deepening: each pass seeds the table and history for the next
+void MnkSearch::iterate(Worker &worker, int maxDepth)
+{
+    for (int depth = 1 + (worker.id & 1); depth <= maxDepth && !stop; ++depth)
+    {
+        int move = -1;
+        int score = negamax(worker, depth, -WIN, WIN, 0, &move);
+        if (stop)
+            break;
+
+        worker.result.move = move;
+        worker.result.score = score;
+        worker.result.depth = depth;
+
+        if (score >= WIN_THRESHOLD || score <= -WIN_THRESHOLD)
+            break;
+    }
+}
+
+int MnkSearch::orderMoves(const Worker &worker, int ttMove, int ply, int *moves) const
+{
+    Bitboard candidates = worker.game.candidateMoves();
+    int numMoves = 0;
+    while (candidates.any())
+        moves[numMoves++] = candidates.popLowest();
+
+    const std::vector<int> &h = worker.history;
+    std::stable_sort(moves, moves + numMoves, [&h, ttMove](int a, int b)
+    {
+        if ((a == ttMove) != (b == ttMove))
+            return a == ttMove;
+        return h[a] > h[b];
+    });
+
+    // Helpers look at the first plies in another order so they diverge from the main thread
+    if (worker.id && ply < 2)
+    {
+        int first = moves[0] == ttMove ? 1 : 0;
+        if (numMoves - first > 1)
+            std::rotate(moves + first, moves + first + worker.id % (numMoves - first), moves + numMoves);
+    }
+    return numMoves;
+}
+
+int MnkSearch::negamax(Worker &worker, int depth, int alpha, int beta, int ply, int *bestMove)
+{
+    MnkGame &game = worker.game;
+
+    worker.nodes++;
+    if ((worker.nodes & 4095) == 0 && deadline && nowMs() >= deadline)
+        stop = true;
+    if (stop)
+        return 0;
+
+    if (depth == 0)
+        return evaluate(game);
+
+    // Wins are stored relative to this node so they stay valid at any ply
+    TranspositionTable::Entry entry;
+    int ttMove = -1;
+    if (table.probe(game.hash, entry))
+    {
+        ttMove = entry.move;
+        if (entry.depth >= depth && ply > 0)
+        {
+            int score = entry.score;
+            if (score >= WIN_THRESHOLD)
+                score -= ply;
+            else if (score <= -WIN_THRESHOLD)
+                score += ply;
+
+            if (entry.bound == TranspositionTable::Exact ||
+                (entry.bound == TranspositionTable::Lower && score >= beta) ||
+                (entry.bound == TranspositionTable::Upper && score <= alpha))
+                return score;
+        }
+    }
+
+    int moves[Bitboard::BITS];
+    int numMoves = orderMoves(worker, ttMove, ply, moves);
+
+    int originalAlpha = alpha;
+    int best = -WIN;
+    int bestCell = numMoves ? moves[0] : -1;
+    int player = game.sideToMove;
+
+    for (int i = 0; i < numMoves; ++i)
+    {
+        int cell = moves[i];
+        int score;
+
+        game.play(cell);
+        if (game.wins(player, cell))
+            score = WIN - (ply + 1);
+        else if (game.isFull())
+            score = 0;
+        else
+            score = -negamax(worker, depth - 1, -beta, -alpha, ply + 1, nullptr);
+        game.undo(cell);
+
+        if (stop)
+            return 0;
+
+        if (score > best)
+        {
+            best = score;
+            bestCell = cell;
+        }
+        if (best > alpha)
+            alpha = best;
+        if (alpha >= beta)
+        {
+            worker.history[cell] += depth * depth;
+            break;
+        }
+    }
+
+    entry.score = best;
+    if (best >= WIN_THRESHOLD)
+        entry.score += ply;
+    else if (best <= -WIN_THRESHOLD)
+        entry.score -= ply;
+    entry.move = bestCell;
+    entry.depth = depth;
+    entry.bound = best <= originalAlpha ? TranspositionTable::Upper :
+                  (best >= beta ? TranspositionTable::Lower : TranspositionTable::Exact);
+    table.store(game.hash, entry);
+
+    if (bestMove)
+        *bestMove = bestCell;
+    return best;
+}
+
+// Every line still open for only one player counts, growing fast with its stones
+int MnkSearch::evaluate(const MnkGame &game) const
+{
+    static const int weights[] = {0, 1, 8, 64, 512, 4096, 32768, 262144};
+
+    const Bitboard &mine = game.stones[game.sideToMove];
+    const Bitboard &theirs = game.stones[game.sideToMove ^ 1];
+    int limit = static_cast<int>(sizeof(weights) / sizeof(weights[0])) - 1;
+
+    int score = 0;
+    for (const Bitboard &line : game.lines)
+    {
+        int own = (mine & line).count();
+        int other = (theirs & line).count();
+        if (own && !other)
+            score += weights[std::min(own, limit)];
+        else if (other && !own)
+            score -= weights[std::min(other, limit)];
+    }
+    return score;
+}
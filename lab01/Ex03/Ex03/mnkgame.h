@@ -0,0 +1,161 @@
+#ifndef MNKGAME_H
+#define MNKGAME_H
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// 256 bit set, enough for boards up to 15 rows of 15 columns plus padding
+struct Bitboard
+{
+    static const int WORDS = 4;
+    static const int BITS = WORDS * 64;
+
+    uint64_t w[WORDS] = {0, 0, 0, 0};
+
+    bool test(int i) const { return (w[i >> 6] >> (i & 63)) & 1; }
+    void set(int i) { w[i >> 6] |= uint64_t(1) << (i & 63); }
+    void clear(int i) { w[i >> 6] &= ~(uint64_t(1) << (i & 63)); }
+
+    bool any() const { return w[0] | w[1] | w[2] | w[3]; }
+    int count() const;
+    int popLowest(); // Index of the lowest set bit, which is cleared; the set must not be empty
+
+    Bitboard operator&(const Bitboard &o) const;
+    Bitboard operator|(const Bitboard &o) const;
+    Bitboard operator~() const;
+    bool operator==(const Bitboard &o) const;
+
+    Bitboard shiftedUp(int n) const; // Towards higher indices, n < 64
+    Bitboard shiftedDown(int n) const;
+};
+
+// An m,n,k-game: two players alternate placing stones on a width x height
+// board, the first to get k in a row (any direction) wins. Tic-tac-toe is
+// 3,3,3; gomoku is 15,15,5.
+//
+// Cells are numbered row * stride + column with stride = width + 1, so every
+// row ends in an always empty padding bit. Shifting a bitboard by 1, stride - 1,
+// stride or stride + 1 then never wraps from one row into the next, which
+// keeps neighbourhood generation to a handful of shifts.
+class MnkGame
+{
+public:
+    MnkGame(int _width = 3, int _height = 3, int _k = 3);
+
+    int width;
+    int height;
+    int k;
+    int stride;
+
+    Bitboard stones[2];
+    Bitboard boardMask; // Every real cell, padding excluded
+    int sideToMove = 0;
+    int numMoves = 0;
+    uint64_t hash = 0;
+
+    // Every line of k cells, and for each cell the lines through it
+    std::vector<Bitboard> lines;
+    std::vector<std::vector<int>> cellLines;
+
+    int cell(int row, int column) const { return row * stride + column; }
+    int stoneAt(int cell) const; // 0 or 1 for the players, -1 when empty
+    int numCells() const { return width * height; }
+
+    void reset();
+    void play(int cell);
+    void undo(int cell);
+
+    bool wins(int player, int lastCell) const;
+    bool isFull() const { return numMoves == numCells(); }
+
+    Bitboard emptyCells() const;
+    Bitboard candidateMoves() const;
+
+private:
+    std::vector<uint64_t> zobrist[2];
+};
+
+struct SearchResult
+{
+    int move = -1;
+    int score = 0;
+    int depth = 0;
+    uint64_t nodes = 0;
+    double seconds = 0;
+};
+
+// Transposition table shared by all search threads without locks. Each slot
+// holds the packed entry and the key XORed with it, written as two relaxed
+// atomics; a slot torn by two writers no longer XORs back to the key and
+// simply reads as a miss.
+class TranspositionTable
+{
+public:
+    TranspositionTable(int bits);
+
+    struct Entry
+    {
+        int score = 0;
+        int move = -1;
+        int depth = -1;
+        int bound = 0;
+    };
+    enum Bound { Exact = 1, Lower = 2, Upper = 3 };
+
+    bool probe(uint64_t key, Entry &entry) const;
+    void store(uint64_t key, const Entry &entry);
+    void clear();
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    uint64_t mask;
+};
+
+// Negamax with alpha-beta pruning, a transposition table keyed by Zobrist
+// hashes, history move ordering and iterative deepening under a time limit.
+// Scores are from the side to move; wins are WIN minus the distance in plies.
+//
+// With more than one thread the search is Lazy SMP: every thread deepens the
+// same root on its own copy of the game, helpers start at alternating depths
+// and in a rotated move order, and all of them share the table, so each one
+// mostly finds the work of the others already done.
+class MnkSearch
+{
+public:
+    MnkSearch(int tableBits = 20);
+
+    static const int WIN = 1000000;
+    static const int WIN_THRESHOLD = WIN - 1000;
+
+    SearchResult search(MnkGame &game, int maxDepth, int timeLimitMs, int numThreads = 1);
+    void clear();
+
+private:
+    struct Worker
+    {
+        int id;
+        MnkGame game;
+        std::vector<int> history;
+        uint64_t nodes = 0;
+        SearchResult result;
+    };
+
+    TranspositionTable table;
+    std::atomic<bool> stop;
+    int64_t deadline = 0;
+
+    void iterate(Worker &worker, int maxDepth);
+    int negamax(Worker &worker, int depth, int alpha, int beta, int ply, int *bestMove);
+    int evaluate(const MnkGame &game) const;
+    int orderMoves(const Worker &worker, int ttMove, int ply, int *moves) const;
+};
+
+#endif // MNKGAME_H
@@ -0,0 +1,212 @@
+#include "tictactoe.h"
+#include "mnkgame.h"
+
+#include <stdio.h>
+
+namespace TicTacToe
+{
+
+struct Table
+{
+    uint8_t entries[NUM_POSITIONS];
+    int reachable;
+};
+
+constexpr int POWERS_OF_3[NUM_SQUARES] = {1, 3, 9, 27, 81, 243, 729, 2187, 6561};
+
+constexpr int LINES[8][3] = {{0, 1, 2}, {3, 4, 5}, {6, 7, 8},
+                             {0, 3, 6}, {1, 4, 7}, {2, 5, 8},
+                             {0, 4, 8}, {2, 4, 6}};
+
+// Digit of the player owning a full line, 0 when nobody does
+constexpr int lineOwner(const int *cells)
+{
+    for (const auto &line : LINES)
+        if (cells[line[0]] && cells[line[0]] == cells[line[1]] && cells[line[0]] == cells[line[2]])
+            return cells[line[0]];
+    return 0;
+}
+
+// Placing a stone only ever raises the index, so walking the indices downwards
+// visits every child before its parent and one pass solves the whole game.
+// Scores are 10 - stones for the winner of a finished game, negated for the
+// loser, so faster wins and slower losses are preferred.
+constexpr Table buildTable()
+{
+    Table table{};
+    int8_t scores[NUM_POSITIONS] = {};
+    bool reachable[NUM_POSITIONS] = {};
+
+    for (int position = NUM_POSITIONS - 1; position >= 0; --position)
+    {
+        int cells[NUM_SQUARES] = {};
+        int xs = 0, os = 0;
+        for (int square = 0, rest = position; square < NUM_SQUARES; ++square, rest /= 3)
+        {
+            cells[square] = rest % 3;
+            xs += cells[square] == 1;
+            os += cells[square] == 2;
+        }
+
+        if (os > xs || xs > os + 1)
+            continue;
+
+        int mover = xs == os ? 1 : 2;
+        int owner = lineOwner(cells);
+        int stones = xs + os;
+
+        // The side to move can not already own a line: the game would have ended
+        if (owner == mover)
+            continue;
+        if (owner)
+        {
+            scores[position] = static_cast<int8_t>(stones - 10);
+            table.entries[position] = static_cast<uint8_t>(Loss << 4 | NO_MOVE);
+            continue;
+        }
+        if (stones == NUM_SQUARES)
+        {
+            table.entries[position] = static_cast<uint8_t>(Draw << 4 | NO_MOVE);
+            continue;
+        }
+
+        int best = -100, bestSquare = NO_MOVE;
+        for (int square = 0; square < NUM_SQUARES; ++square)
+        {
+            if (cells[square])
+                continue;
+            int value = -scores[position + mover * POWERS_OF_3[square]];
+            if (value > best)
+            {
+                best = value;
+                bestSquare = square;
+            }
+        }
+
+        Outcome result = best > 0 ? Win : (best < 0 ? Loss : Draw);
+        scores[position] = static_cast<int8_t>(best);
+        table.entries[position] = static_cast<uint8_t>(result << 4 | bestSquare);
+    }
+
+    // Forwards again to count what actual games can reach
+    reachable[0] = true;
+    for (int position = 0; position < NUM_POSITIONS; ++position)
+    {
+        if (!reachable[position])
+            continue;
+        table.reachable++;
+        if ((table.entries[position] & 15) == NO_MOVE)
+            continue;
+
+        int xs = 0, os = 0;
+        for (int square = 0, rest = position; square < NUM_SQUARES; ++square, rest /= 3)
+        {
+            xs += rest % 3 == 1;
+            os += rest % 3 == 2;
+        }
+        int mover = xs == os ? 1 : 2;
+        for (int square = 0, rest = position; square < NUM_SQUARES; ++square, rest /= 3)
+            if (rest % 3 == 0)
+                reachable[position + mover * POWERS_OF_3[square]] = true;
+    }
+
+    return table;
+}
+
+constexpr Table table = buildTable();
+
+constexpr int positionOf(const char *board)
+{
+    int position = 0;
+    for (int square = 0; square < NUM_SQUARES; ++square)
+        position += (board[square] == 'X' ? 1 : (board[square] == 'O' ? 2 : 0)) * POWERS_OF_3[square];
+    return position;
+}
+
+constexpr int entryMove(const char *board) { return table.entries[positionOf(board)] & 15; }
+constexpr int entryOutcome(const char *board) { return table.entries[positionOf(board)] >> 4; }
+
+// Well known facts about the game, checked while compiling
+static_assert(table.reachable == 5478, "tic-tac-toe has 5478 reachable positions");
+static_assert(entryOutcome(".........") == Draw, "perfect play from the empty board is a draw");
+static_assert(entryOutcome("XX.OO....") == Win && entryMove("XX.OO....") == 2, "X completes the top row");
+static_assert(entryMove("XX.O.....") == 2, "O blocks the top row, even in a lost position");
+static_assert(entryOutcome("XX..O....") == Draw && entryMove("XX..O....") == 2, "O has to block the top row");
+static_assert(entryOutcome("X...O...X") == Draw, "O answers the diagonal fork threat");
+static_assert(entryOutcome("XXXOO....") == Loss && entryMove("XXXOO....") == NO_MOVE, "finished games have no move");
+
+const uint8_t *entries = table.entries;
+
+int play(int position, int square, int player)
+{
+    return position + (player + 1) * POWERS_OF_3[square];
+}
+
+int reachablePositions()
+{
+    return table.reachable;
+}
+
+bool selfCheck()
+{
+    MnkGame game(3, 3, 3);
+    MnkSearch search(16);
+    int checked = 0, mismatches = 0;
+
+    for (int position = 0; position < NUM_POSITIONS; ++position)
+    {
+        Outcome expected = outcome(position);
+        int move = bestMove(position);
+        if (expected == Invalid || move == NO_MOVE)
+            continue;
+
+        // Rebuild the position, X and O alternating so the hash matches a real game
+        int xs[5], os[5], numX = 0, numO = 0;
+        for (int square = 0, rest = position; square < NUM_SQUARES; ++square, rest /= 3)
+        {
+            if (rest % 3 == 1)
+                xs[numX++] = square;
+            else if (rest % 3 == 2)
+                os[numO++] = square;
+        }
+        game.reset();
+        for (int i = 0; i < numX; ++i)
+        {
+            game.play(game.cell(xs[i] / 3, xs[i] % 3));
+            if (i < numO)
+                game.play(game.cell(os[i] / 3, os[i] % 3));
+        }
+
+        SearchResult result = search.search(game, NUM_SQUARES, 0);
+        Outcome searched = result.score > 0 ? Win : (result.score < 0 ? Loss : Draw);
+
+        // The table move must reach the same outcome as the search
+        int cell = game.cell(move / 3, move % 3);
+        int player = game.sideToMove;
+        Outcome achieved;
+        game.play(cell);
+        if (game.wins(player, cell))
+            achieved = Win;
+        else if (game.isFull())
+            achieved = Draw;
+        else
+        {
+            int reply = search.search(game, NUM_SQUARES, 0).score;
+            achieved = reply < 0 ? Win : (reply > 0 ? Loss : Draw);
+        }
+
+        checked++;
+        if (searched != expected || achieved != expected)
+        {
+            mismatches++;
+            printf("position %d: table %d, search %d, table move %d reaches %d\n",
+                   position, expected, searched, move, achieved);
+        }
+    }
+
+    printf("tic-tac-toe table: %d reachable positions, %d checked against the search, %d mismatches\n",
+           reachablePositions(), checked, mismatches);
+    return mismatches == 0;
+}
+
+}
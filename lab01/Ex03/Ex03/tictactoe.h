@@ -0,0 +1,32 @@
+#ifndef TICTACTOE_H
+#define TICTACTOE_H
+
+#include <stdint.h>
+
+// Perfect play for 3x3 tic-tac-toe from a table generated at compile time.
+// A position is the base-3 number sum(digit[square] * 3^square) with squares
+// numbered row * 3 + column and digits 0 empty, 1 X, 2 O. X always starts,
+// so the side to move follows from the stone counts.
+namespace TicTacToe
+{
+    const int NUM_SQUARES = 9;
+    const int NUM_POSITIONS = 19683; // 3^9
+    const int NO_MOVE = 9;
+
+    // For the side to move
+    enum Outcome { Invalid = 0, Loss = 1, Draw = 2, Win = 3 };
+
+    // Each entry is one byte: the best square in the low four bits, the outcome above
+    extern const uint8_t *entries;
+
+    inline int bestMove(int position) { return entries[position] & 15; }
+    inline Outcome outcome(int position) { return static_cast<Outcome>(entries[position] >> 4); }
+
+    int play(int position, int square, int player); // player 0 is X
+    int reachablePositions();
+
+    // Compares every reachable position with a runtime MnkSearch
+    bool selfCheck();
+}
+
+#endif // TICTACTOE_H
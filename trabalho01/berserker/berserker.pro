@@ -28,11 +28,17 @@ DEFINES += QT_DEPRECATED_WARNINGS
 SOURCES += \
         main.cpp \
         mainwindow.cpp \
-    openglwidget.cpp
+    openglwidget.cpp \
+    spritebatch.cpp \
+    particlesystem.cpp \
+    bullethell.cpp
 
 HEADERS += \
         mainwindow.h \
-    openglwidget.h
+    openglwidget.h \
+    spritebatch.h \
+    particlesystem.h \
+    bullethell.h
 
 FORMS += \
         mainwindow.ui
@@ -0,0 +1,278 @@
+#include "bullethell.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+BulletHell::BulletHell(QOpenGLWidget *_glWidget)
+{
+    glWidget = _glWidget;
+    glWidget->makeCurrent();
+
+    initializeOpenGLFunctions();
+
+    projectiles = std::make_unique<ParticleSystem>(glWidget, MAX_PROJECTILES, MAX_SPAWN);
+    enemies = std::make_unique<ParticleSystem>(glWidget, MAX_ENEMIES, MAX_SPAWN);
+
+    createShaders();
+    createFBO();
+}
+
+BulletHell::~BulletHell()
+{
+    destroyFBO();
+    destroyShaders();
+}
+
+GLuint BulletHell::compileShader(GLenum type, const QString &fileName)
+{
+    QFile file(fileName);
+    file.open(QFile::ReadOnly | QFile::Text);
+    QTextStream stream(&file);
+    std::string stdString = stream.readAll().toStdString();
+    file.close();
+
+    GLuint shader = glCreateShader(type);
+    const GLchar *source = stdString.c_str();
+    glShaderSource(shader, 1, &source, 0);
+    glCompileShader(shader);
+
+    GLint isCompiled = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &isCompiled);
+    if (isCompiled == GL_FALSE)
+    {
+        GLint maxLength = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &maxLength);
+        // The maxLength includes the NULL character
+        std::vector<GLchar> infoLog(maxLength);
+        glGetShaderInfoLog(shader, maxLength, &maxLength, &infoLog[0]);
+        qDebug("%s: %s", qPrintable(fileName), &infoLog[0]);
+
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+GLuint BulletHell::createProgram(const QString &vertexShaderFile, const QString &geometryShaderFile,
+                                 const QString &fragmentShaderFile, const char *feedbackVarying)
+{
+    const GLenum types[] = {GL_VERTEX_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER};
+    const QString files[] = {vertexShaderFile, geometryShaderFile, fragmentShaderFile};
+    GLuint shaders[] = {0, 0, 0};
+
+    GLuint program = glCreateProgram();
+    bool compiled = true;
+    for (int i = 0; i < 3; ++i)
+    {
+        if (files[i].isEmpty())
+            continue;
+        shaders[i] = compileShader(types[i], files[i]);
+        if (!shaders[i])
+            compiled = false;
+        else
+            glAttachShader(program, shaders[i]);
+    }
+
+    // Captured outputs must be declared before linking
+    if (feedbackVarying)
+        glTransformFeedbackVaryings(program, 1, &feedbackVarying, GL_INTERLEAVED_ATTRIBS);
+
+    GLint isLinked = 0;
+    if (compiled)
+    {
+        glLinkProgram(program);
+        glGetProgramiv(program, GL_LINK_STATUS, (int *)&isLinked);
+        if (isLinked == GL_FALSE)
+        {
+            GLint maxLength = 0;
+            glGetProgramiv(program, GL_INFO_LOG_LENGTH, &maxLength);
+            std::vector<GLchar> infoLog(maxLength);
+            glGetProgramInfoLog(program, maxLength, &maxLength, &infoLog[0]);
+            qDebug("%s", &infoLog[0]);
+        }
+    }
+
+    for (int i = 0; i < 3; ++i)
+    {
+        if (!shaders[i])
+            continue;
+        glDetachShader(program, shaders[i]);
+        glDeleteShader(shaders[i]);
+    }
+
+    if (!compiled || isLinked == GL_FALSE)
+    {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+void BulletHell::createShaders()
+{
+    destroyShaders();
+
+    updateProgram = createProgram(":/shaders/vupdate.glsl", ":/shaders/gupdate.glsl", QString(), "outState");
+    locElapsedTime = glGetUniformLocation(updateProgram, "elapsedTime");
+    locIsEnemy = glGetUniformLocation(updateProgram, "isEnemy");
+    locOccupancy = glGetUniformLocation(updateProgram, "occupancy");
+
+    pointsProgram = createProgram(":/shaders/vpoints.glsl", QString(), ":/shaders/fpoints.glsl", nullptr);
+    locPointSize = glGetUniformLocation(pointsProgram, "pointSize");
+    locPointColor = glGetUniformLocation(pointsProgram, "pointColor");
+}
+
+void BulletHell::destroyShaders()
+{
+    glDeleteProgram(updateProgram);
+    glDeleteProgram(pointsProgram);
+    updateProgram = 0;
+    pointsProgram = 0;
+}
+
+void BulletHell::createFBO()
+{
+    destroyFBO();
+
+    // r: enemies, g: projectiles
+    glGenTextures(1, &gridTexture);
+    glBindTexture(GL_TEXTURE_2D, gridTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, GRID_SIZE, GRID_SIZE, 0, GL_RG, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenFramebuffers(1, &gridFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, gridFbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gridTexture, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        qDebug("Bullet hell occupancy framebuffer is incomplete");
+    glBindFramebuffer(GL_FRAMEBUFFER, glWidget->defaultFramebufferObject());
+}
+
+void BulletHell::destroyFBO()
+{
+    glDeleteFramebuffers(1, &gridFbo);
+    glDeleteTextures(1, &gridTexture);
+    gridFbo = 0;
+    gridTexture = 0;
+}
+
+void BulletHell::animate(float elapsedTime, float playerPosX, float playerPosY, int shootingDirection)
+{
+    pendingTime += elapsedTime;
+
+    // Projectiles: an aimed stream plus a rotating spiral around the player
+    float aim = static_cast<float>(M_PI / 2 - shootingDirection * M_PI / 2);
+    projectileBudget += 30000.0f * elapsedTime;
+    for (int i = 0; projectileBudget >= 1.0f; ++i, projectileBudget -= 1.0f)
+    {
+        float angle;
+        if (i % 2)
+        {
+            spiralAngle += 0.05f;
+            angle = spiralAngle;
+        }
+        else
+        {
+            angle = aim + 0.6f * (2.0f * rand() / RAND_MAX - 1.0f);
+        }
+        float speed = 1.0f + 0.5f * rand() / RAND_MAX;
+        if (!projectiles->spawn(QVector4D(playerPosX, playerPosY, speed * cosf(angle), speed * sinf(angle))))
+        {
+            projectileBudget = 0;
+            break;
+        }
+    }
+
+    // Enemies drift in from the borders
+    enemyBudget += 6000.0f * elapsedTime;
+    for (; enemyBudget >= 1.0f; enemyBudget -= 1.0f)
+    {
+        float t = 2.0f * rand() / RAND_MAX - 1.0f;
+        float x, y;
+        switch (rand() % 4)
+        {
+        case 0: x = t; y = 1.0f; break;
+        case 1: x = 1.0f; y = t; break;
+        case 2: x = t; y = -1.0f; break;
+        default: x = -1.0f; y = t; break;
+        }
+        float angle = static_cast<float>(2.0 * M_PI * rand() / RAND_MAX);
+        float speed = 0.1f + 0.3f * rand() / RAND_MAX;
+        if (!enemies->spawn(QVector4D(x, y, speed * cosf(angle), speed * sinf(angle))))
+        {
+            enemyBudget = 0;
+            break;
+        }
+    }
+}
+
+void BulletHell::render(GLuint targetFbo, int width, int height)
+{
+    if (!updateProgram || !pointsProgram)
+        return;
+
+    // Counts from earlier frames, only the ones that are already available
+    enemies->collectCounts(false);
+    projectiles->collectCounts(false);
+    hits += enemies->takeRemoved();
+    projectiles->takeRemoved();
+
+    glEnable(GL_PROGRAM_POINT_SIZE);
+
+    // 1. Occupancy grid of the current positions
+    const GLfloat clearColor[] = {0, 0, 0, 0};
+    glBindFramebuffer(GL_FRAMEBUFFER, gridFbo);
+    glViewport(0, 0, GRID_SIZE, GRID_SIZE);
+    glClearBufferfv(GL_COLOR, 0, clearColor);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+
+    glUseProgram(pointsProgram);
+    glUniform1f(locPointSize, 2.0f);
+    glUniform4f(locPointColor, 1, 0, 0, 0);
+    enemies->draw();
+    glUniform1f(locPointSize, 1.0f);
+    glUniform4f(locPointColor, 0, 1, 0, 0);
+    projectiles->draw();
+
+    glDisable(GL_BLEND);
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFbo);
+    glViewport(0, 0, width, height);
+
+    // 2. Integrate, collide and compact both populations
+    glEnable(GL_RASTERIZER_DISCARD);
+    glUseProgram(updateProgram);
+    glUniform1f(locElapsedTime, pendingTime);
+    glUniform1i(locOccupancy, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, gridTexture);
+
+    glUniform1i(locIsEnemy, 1);
+    enemies->update();
+    glUniform1i(locIsEnemy, 0);
+    projectiles->update();
+
+    glDisable(GL_RASTERIZER_DISCARD);
+    pendingTime = 0;
+
+    // 3. Draw the new state
+    glUseProgram(pointsProgram);
+    glUniform1f(locPointSize, 5.0f);
+    glUniform4f(locPointColor, 1.0f, 0.3f, 0.2f, 1.0f);
+    enemies->draw();
+    glUniform1f(locPointSize, 2.0f);
+    glUniform4f(locPointColor, 1.0f, 0.9f, 0.3f, 1.0f);
+    projectiles->draw();
+
+    glDisable(GL_PROGRAM_POINT_SIZE);
+}
+
+unsigned int BulletHell::takeHits()
+{
+    unsigned int result = hits;
+    hits = 0;
+    return result;
+}
@@ -0,0 +1,68 @@
+#ifndef BULLETHELL_H
+#define BULLETHELL_H
+
+#include <QtOpenGL>
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions_4_1_Core>
+
+#include <memory>
+
+#include "particlesystem.h"
+
+// Bullet-hell mode: tens of thousands of projectiles and enemies simulated on
+// the GPU. Each frame both populations are splatted into a coarse occupancy
+// grid, then integrated through transform feedback; a projectile and an enemy
+// sharing a grid cell destroy each other. Enemies bounce off the borders, so
+// every enemy that disappears is a hit.
+class BulletHell : public QOpenGLFunctions_4_1_Core
+{
+public:
+    BulletHell(QOpenGLWidget *_glWidget);
+    ~BulletHell();
+
+    QOpenGLWidget *glWidget;
+
+    static const unsigned int MAX_PROJECTILES = 65536;
+    static const unsigned int MAX_ENEMIES = 32768;
+    static const unsigned int MAX_SPAWN = 4096; // Per population and frame
+    static const int GRID_SIZE = 256;
+
+    std::unique_ptr<ParticleSystem> projectiles = nullptr;
+    std::unique_ptr<ParticleSystem> enemies = nullptr;
+
+    GLuint updateProgram = 0;
+    GLint locElapsedTime = -1;
+    GLint locIsEnemy = -1;
+    GLint locOccupancy = -1;
+
+    GLuint pointsProgram = 0;
+    GLint locPointSize = -1;
+    GLint locPointColor = -1;
+
+    GLuint gridFbo = 0;
+    GLuint gridTexture = 0;
+
+    float pendingTime = 0; // Simulation time accumulated by animate since the last render
+    float projectileBudget = 0;
+    float enemyBudget = 0;
+    float spiralAngle = 0;
+
+    unsigned int hits = 0;
+
+    void createShaders();
+    void createFBO();
+
+    void destroyShaders();
+    void destroyFBO();
+
+    void animate(float elapsedTime, float playerPosX, float playerPosY, int shootingDirection);
+    void render(GLuint targetFbo, int width, int height);
+    unsigned int takeHits();
+
+private:
+    GLuint compileShader(GLenum type, const QString &fileName);
+    GLuint createProgram(const QString &vertexShaderFile, const QString &geometryShaderFile,
+                         const QString &fragmentShaderFile, const char *feedbackVarying);
+};
+
+#endif // BULLETHELL_H
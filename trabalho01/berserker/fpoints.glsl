@@ -0,0 +1,10 @@
+#version 410
+
+uniform vec4 pointColor;
+
+out vec4 myfragcolor;
+
+void main()
+{
+    myfragcolor = pointColor;
+}
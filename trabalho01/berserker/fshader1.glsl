@@ -1,10 +1,13 @@
 #version 410
 
  in vec4 v2fcolor;
+ in vec2 v2ftexcoord;
+
+ uniform sampler2D colorTexture;
 
  out vec4 myfragcolor;
 
  void main()
  {
-     myfragcolor = v2fcolor;
+     myfragcolor = v2fcolor * texture(colorTexture, v2ftexcoord);
  }
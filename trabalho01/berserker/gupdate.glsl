@@ -0,0 +1,20 @@
+#version 410
+
+layout (points) in;
+layout (points, max_vertices = 1) out;
+
+in vec4 gState[];
+in float gAlive[];
+
+out vec4 outState;
+
+void main()
+{
+    // Dead particles are not emitted, which keeps the output buffer packed
+    if (gAlive[0] > 0.5)
+    {
+        outState = gState[0];
+        EmitVertex();
+        EndPrimitive();
+    }
+}
@@ -1,5 +1,7 @@
 #include "openglwidget.h"
 
+#include <stdlib.h>
+
 OpenGLWidget::OpenGLWidget(QWidget *parent)
     : QOpenGLWidget(parent)
 {
@@ -22,12 +24,31 @@ OpenGLWidget::OpenGLWidget(QWidget *parent)
     targetOffset = 0.125f;
     numHits = 0;
     totalTime = 0;
+
+    stressMode = false;
+    stressFrameTime = 0;
+    stressFrames = 0;
+
+    bulletHellMode = false;
+    bulletHellHits = 0;
+    viewportWidth = 0;
+    viewportHeight = 0;
+
+    numDrawnSprites = 0;
+    fullRedraw = true;
+    framesDrawn = 0;
+    framesSkipped = 0;
+    pixelsRedrawn = 0;
+
+    // Keep the back buffer between frames so only changed areas are repainted
+    setUpdateBehavior(QOpenGLWidget::PartialUpdate);
 }
 
 OpenGLWidget::~OpenGLWidget()
 {
-    destroyVBOs();
-    destroyShaders();
+    makeCurrent();
+    bulletHell.reset();
+    batch.reset();
 }
 
 void OpenGLWidget::initializeGL()
@@ -38,230 +59,194 @@ void OpenGLWidget::initializeGL()
     qDebug("OpenGL version: %s", glGetString(GL_VERSION));
     qDebug("GLSL %s", glGetString(GL_SHADING_LANGUAGE_VERSION));
 
-    createShaders();
-    createVBOs();
+    // Room for the game sprites plus the stress mode sprites
+    batch = std::make_unique<SpriteBatch>(this, NUM_STRESS_SPRITES + 16);
 
     connect(&timer, SIGNAL(timeout()), this, SLOT(animate()));
+    connect(&wakeTimer, SIGNAL(timeout()), this, SLOT(animate()));
+    wakeTimer.setSingleShot(true);
     timer.start(0);
 
     time.start();
+    statsTimer.start();
 }
 
 void OpenGLWidget::resizeGL(int width, int height)
 {
     glViewport(0, 0, width, height);
+    viewportWidth = width;
+    viewportHeight = height;
+    fullRedraw = true;
 }
 
 void OpenGLWidget::paintGL()
 {
-    glClear(GL_COLOR_BUFFER_BIT);
-
-    GLuint locScaling = glGetUniformLocation(shaderProgram, "scaling");
-    GLuint locTranslation = glGetUniformLocation(shaderProgram, "translation");
-
-    glUseProgram(shaderProgram);
-
-    glBindVertexArray(vao);
+    stressTimer.start();
 
-    // Player
-    glUniform4f(locTranslation, playerPosX, playerPosY, 0, 0);
-    glUniform1f(locScaling, playerSize);
-    glDrawElements(GL_TRIANGLES, 2 * 3, GL_UNSIGNED_INT, 0);
-
-    // Target
-    glUniform4f(locTranslation, targetPosX, targetPosY, 0, 0);
-    glUniform1f(locScaling, targetSize);
-    glDrawElements(GL_TRIANGLES, 2 * 3, GL_UNSIGNED_INT, 0);
+    QVector4D sprites[MAX_GAME_SPRITES];
+    int numSprites = collectGameSprites(sprites);
 
-    // Projectile
-    if (shooting)
+    // Repaint the union of where the sprites were and where they are now
+    QRect dirty;
+    if (fullRedraw || stressMode || bulletHellMode)
     {
-        glUniform4f(locTranslation, projectilePosX, projectilePosY, 0, 0);
-        glUniform1f(locScaling, 0.05);
-        glDrawElements(GL_TRIANGLES, 2 * 3, GL_UNSIGNED_INT, 0);
+        dirty = QRect(0, 0, viewportWidth, viewportHeight);
+    }
+    else
+    {
+        for (int i = 0; i < numDrawnSprites; ++i)
+            dirty |= spriteBounds(drawnSprites[i]);
+        for (int i = 0; i < numSprites; ++i)
+            dirty |= spriteBounds(sprites[i]);
+        dirty &= QRect(0, 0, viewportWidth, viewportHeight);
     }
-}
-
-void OpenGLWidget::createShaders()
-{
-    // makeCurrent();
-    destroyShaders();
-
-    QFile vs(":/shaders/vshader1.glsl");
-    QFile fs(":/shaders/fshader1.glsl");
-
-    vs.open(QFile::ReadOnly | QFile::Text);
-    fs.open(QFile::ReadOnly | QFile::Text);
-
-    QTextStream streamVs(&vs), streamFs(&fs);
-
-    QString qtStringVs = streamVs.readAll();
-    QString qtStringFs = streamFs.readAll();
-
-    std::string stdStringVs = qtStringVs.toStdString();
-    std::string stdStringFs = qtStringFs.toStdString();
 
-    // Create an empty vertex shader handle
-    GLuint vertexShader = 0;
-    vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    for (int i = 0; i < numSprites; ++i)
+        drawnSprites[i] = sprites[i];
+    numDrawnSprites = numSprites;
+    fullRedraw = false;
 
-    // Send the vertex shader source code to GL
-    const GLchar *source = stdStringVs.c_str();
+    if (dirty.isEmpty())
+        return;
 
-    glShaderSource(vertexShader, 1, &source, 0);
+    framesDrawn++;
+    pixelsRedrawn += static_cast<qint64>(dirty.width()) * dirty.height();
 
-    // Compile the vertex shader
-    glCompileShader(vertexShader);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(dirty.x(), dirty.y(), dirty.width(), dirty.height());
+    glClear(GL_COLOR_BUFFER_BIT);
 
-    GLint isCompiled = 0;
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &isCompiled);
-    if (isCompiled == GL_FALSE)
+    if (bulletHellMode)
     {
-        GLint maxLength = 0;
-        glGetShaderiv(vertexShader, GL_INFO_LOG_LENGTH, &maxLength);
-        // The maxLength includes the NULL character
-        std::vector<GLchar> infoLog(maxLength);
-        glGetShaderInfoLog(vertexShader, maxLength, &maxLength, &infoLog[0]);
-        qDebug("%s", &infoLog[0]);
-
-        glDeleteShader(vertexShader);
-        return;
+        // Always a full redraw, and the occupancy grid pass must not be scissored
+        glDisable(GL_SCISSOR_TEST);
+        bulletHell->render(defaultFramebufferObject(), viewportWidth, viewportHeight);
+        glEnable(GL_SCISSOR_TEST);
     }
 
-    // Create an empty fragment shader handle
-    GLuint fragmentShader = 0;
-    fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    const QVector4D white(1, 1, 1, 1);
 
-    // Send the fragment shader source code to GL
-    // Note that std::string's .c_str is NULL character terminated.
-    source = stdStringFs.c_str();
-    glShaderSource(fragmentShader, 1, &source, 0);
+    batch->begin();
 
-    // Compile the fragment shader
-    glCompileShader(fragmentShader);
-
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &isCompiled);
-    if (isCompiled == GL_FALSE)
+    if (stressMode)
     {
-        GLint maxLength = 0;
-        glGetShaderiv(fragmentShader, GL_INFO_LOG_LENGTH, &maxLength);
-
-        std::vector<GLchar> infoLog(maxLength);
-        glGetShaderInfoLog(fragmentShader, maxLength, &maxLength, &infoLog[0]);
-        qDebug("%s", &infoLog[0]);
-
-        glDeleteShader(fragmentShader);
-        glDeleteShader(vertexShader);
-        return;
+        for (unsigned int i = 0; i < NUM_STRESS_SPRITES; ++i)
+            batch->add(stressSprites[i].x(), stressSprites[i].y(), 0.01f, 0.01f, stressColors[i]);
     }
 
-    // Vertex and fragment shaders are successfully compiled.
-    // Now time to link them together into a program.
-    // Get a program object.
-    shaderProgram = glCreateProgram();
+    // Player, target and projectile
+    for (int i = 0; i < numSprites; ++i)
+        batch->add(sprites[i].x(), sprites[i].y(), sprites[i].z(), sprites[i].w(), white);
 
-    // Attach our shaders to our program
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
+    // Everything above goes out in a single draw call
+    batch->flush();
 
-    // Link our program
-    glLinkProgram(shaderProgram);
+    glDisable(GL_SCISSOR_TEST);
 
-    // Note the different functions here: glGetProgram* instead of glGetShader*.
-    GLint isLinked = 0;
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, (int *)&isLinked);
-    if (isLinked == GL_FALSE)
+    if (stressMode)
     {
-        GLint maxLength = 0;
-        glGetProgramiv(shaderProgram, GL_INFO_LOG_LENGTH, &maxLength);
+        // glFinish so the measured time includes the GPU work of the batch
+        glFinish();
+        stressFrameTime += stressTimer.nsecsElapsed();
+        stressFrames++;
+        if (stressFrameTime > 1000000000LL)
+        {
+            double frameMs = stressFrameTime / 1.0e6 / stressFrames;
+            qDebug("Stress: %u sprites, %.2f ms/frame, %.1f M sprites/s", batch->numSprites, frameMs,
+                   batch->numSprites / frameMs / 1000.0);
+            stressFrameTime = 0;
+            stressFrames = 0;
+        }
+    }
+}
 
-        // The maxLength includes the NULL character
-        std::vector<GLchar> infoLog(maxLength);
-        glGetProgramInfoLog(shaderProgram, maxLength, &maxLength, &infoLog[0]);
-        qDebug("%s", &infoLog[0]);
+int OpenGLWidget::collectGameSprites(QVector4D *sprites)
+{
+    int numSprites = 0;
 
-        glDeleteProgram(shaderProgram);
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
-        return;
-    }
+    // Player
+    sprites[numSprites++] = QVector4D(playerPosX, playerPosY, playerSize, playerSize);
 
-    glDetachShader(shaderProgram, vertexShader);
-    glDetachShader(shaderProgram, fragmentShader);
+    // Target
+    sprites[numSprites++] = QVector4D(targetPosX, targetPosY, targetSize, targetSize);
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    // Projectile
+    if (shooting)
+        sprites[numSprites++] = QVector4D(projectilePosX, projectilePosY, 0.05f, 0.05f);
 
-    vs.close();
-    fs.close();
+    return numSprites;
 }
 
-void OpenGLWidget::destroyShaders()
+QRect OpenGLWidget::spriteBounds(const QVector4D &sprite)
 {
-    makeCurrent();
-    glDeleteProgram(shaderProgram);
+    if (sprite.z() <= 0 || sprite.w() <= 0)
+        return QRect();
+
+    // Clip space to window pixels, both with the origin at the bottom left
+    float x0 = (sprite.x() - sprite.z() * 0.5f + 1.0f) * 0.5f * viewportWidth;
+    float x1 = (sprite.x() + sprite.z() * 0.5f + 1.0f) * 0.5f * viewportWidth;
+    float y0 = (sprite.y() - sprite.w() * 0.5f + 1.0f) * 0.5f * viewportHeight;
+    float y1 = (sprite.y() + sprite.w() * 0.5f + 1.0f) * 0.5f * viewportHeight;
+
+    // One pixel of margin for rounding and multisampled edges
+    return QRect(QPoint(static_cast<int>(floorf(x0)) - 1, static_cast<int>(floorf(y0)) - 1),
+                 QPoint(static_cast<int>(ceilf(x1)) + 1, static_cast<int>(ceilf(y1)) + 1));
 }
 
-void OpenGLWidget::createVBOs()
+bool OpenGLWidget::isAnimating()
 {
-    makeCurrent();
-    destroyVBOs();
-
-    vertices = std::make_unique<QVector4D[]>(4);
-    colors = std::make_unique<QVector4D[]>(4);
-    indices = std::make_unique<unsigned int[]>(2 * 3);
-
-    // create  four  vertices  to  define a square
-    vertices[0] = QVector4D(-0.5,  -0.5, 0, 1);
-    vertices[1] = QVector4D( 0.5,  -0.5, 0, 1);
-    vertices[2] = QVector4D( 0.5,   0.5, 0, 1);
-    vertices[3] = QVector4D(-0.5,   0.5, 0, 1);
-    // create  colors  for  the  vertices
-    colors[0] = QVector4D(1, 1, 1, 1);     // red
-    colors[1] = QVector4D(1, 1, 1, 1);     // green
-    colors[2] = QVector4D(1, 1, 1, 1);     // blue
-    colors[3] = QVector4D(1, 1, 1, 1);     // yellow
-    // topology  of the  mesh ( square )
-    indices[0] = 0;
-    indices[1] = 1;
-    indices[2] = 2;
-    indices[3] = 2;
-    indices[4] = 3;
-    indices[5] = 0;
-
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
-
-    glGenBuffers(1, &vboVertices);
-    glBindBuffer(GL_ARRAY_BUFFER, vboVertices);
-    glBufferData(GL_ARRAY_BUFFER, 4 * sizeof(QVector4D), vertices.get(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, nullptr);
-    glEnableVertexAttribArray(0);
-
-    glGenBuffers(1, &vboColors);
-    glBindBuffer(GL_ARRAY_BUFFER, vboColors);
-    glBufferData(GL_ARRAY_BUFFER, 4 * sizeof(QVector4D), colors.get(), GL_STATIC_DRAW);
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, nullptr);
-    glEnableVertexAttribArray(1);
-
-    glGenBuffers(1, &vboIndices);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vboIndices);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, 2 * 3 * sizeof(unsigned int), indices.get(), GL_DYNAMIC_DRAW);
+    if (stressMode || bulletHellMode || shooting)
+        return true;
+    if (playerPosXOffset != 0 || playerPosYOffset != 0)
+        return true;
+    // The target follows the player once something was hit
+    if (numHits > 0 && (playerPosX != 0 || playerPosY != 0) && targetSize > 0)
+        return true;
+    return false;
+}
+
+void OpenGLWidget::startAnimating()
+{
+    if (timer.isActive())
+        return;
+
+    // Idle time still counts for the target growth, but must not move anything
+    totalTime += time.restart() / 1000.0f;
+    wakeTimer.stop();
+    timer.start(0);
 }
 
-void OpenGLWidget::destroyVBOs()
+void OpenGLWidget::createStressSprites()
 {
-    //makeCurrent();
+    stressSprites = std::make_unique<QVector4D[]>(NUM_STRESS_SPRITES);
+    stressColors = std::make_unique<QVector4D[]>(NUM_STRESS_SPRITES);
 
-    glDeleteBuffers(1, &vboVertices);
-    glDeleteBuffers(1, &vboColors);
-    glDeleteBuffers(1, &vboIndices);
-    glDeleteVertexArrays(1, &vao);
+    for (unsigned int i = 0; i < NUM_STRESS_SPRITES; ++i)
+    {
+        float x = 2.0f * rand() / RAND_MAX - 1.0f;
+        float y = 2.0f * rand() / RAND_MAX - 1.0f;
+        float vx = 1.0f * rand() / RAND_MAX - 0.5f;
+        float vy = 1.0f * rand() / RAND_MAX - 0.5f;
+        stressSprites[i] = QVector4D(x, y, vx, vy);
+        stressColors[i] = QVector4D(0.5f + 0.5f * rand() / RAND_MAX, 0.5f * rand() / RAND_MAX,
+                                    0.5f + 0.5f * rand() / RAND_MAX, 1);
+    }
+}
 
-    vboVertices = 0;
-    vboIndices = 0;
-    vboColors = 0;
-    vao = 0;
+void OpenGLWidget::animateStressSprites(float elapsedTime)
+{
+    for (unsigned int i = 0; i < NUM_STRESS_SPRITES; ++i)
+    {
+        QVector4D &sprite = stressSprites[i];
+        sprite[0] += sprite[2] * elapsedTime;
+        sprite[1] += sprite[3] * elapsedTime;
+
+        // Bounce off the viewport borders
+        if (sprite[0] < -1.0f || sprite[0] > 1.0f)
+            sprite[2] = -sprite[2];
+        if (sprite[1] < -1.0f || sprite[1] > 1.0f)
+            sprite[3] = -sprite[3];
+    }
 }
 
 void OpenGLWidget::animate()
@@ -313,6 +298,21 @@ void OpenGLWidget::animate()
         }
     }
 
+    if (stressMode)
+        animateStressSprites(elapsedTime);
+
+    if (bulletHellMode)
+    {
+        // Spawning is the only per-particle work left on the CPU
+        bulletHell->animate(elapsedTime, playerPosX, playerPosY, shootingDirection);
+        unsigned int hits = bulletHell->takeHits();
+        if (hits)
+        {
+            bulletHellHits += hits;
+            emit updateHitsLabel(QString("Score: %1 Bullet hell hits: %2").arg(numHits).arg(bulletHellHits));
+        }
+    }
+
     // Update projectile
     if (shooting)
     {
@@ -377,12 +377,45 @@ void OpenGLWidget::animate()
         QOpenGLWidget::setEnabled(false);
     }
 
-    update();
+    // Only repaint when a sprite actually moved or changed size
+    QVector4D sprites[MAX_GAME_SPRITES];
+    int numSprites = collectGameSprites(sprites);
+    bool changed = fullRedraw || stressMode || bulletHellMode || numSprites != numDrawnSprites;
+    for (int i = 0; !changed && i < numSprites; ++i)
+        changed = sprites[i] != drawnSprites[i];
+
+    if (changed)
+        update();
+    else
+        framesSkipped++;
+
+    if (statsTimer.elapsed() > 5000)
+    {
+        qDebug("Frames drawn: %u, skipped: %u, pixels redrawn: %lld", framesDrawn, framesSkipped, pixelsRedrawn);
+        framesDrawn = 0;
+        framesSkipped = 0;
+        pixelsRedrawn = 0;
+        statsTimer.restart();
+    }
+
+    // Sleep while nothing moves, waking up only for the next target growth
+    if (!isAnimating())
+    {
+        timer.stop();
+        if (targetSize > 0)
+        {
+            float nextGrowth = (floorf(totalTime / 3.0f) + 1.0f) * 3.0f;
+            wakeTimer.start(static_cast<int>((nextGrowth - totalTime) * 1000.0f) + 1);
+        }
+    }
 }
 
 // Strong focus is required
 void OpenGLWidget::keyPressEvent(QKeyEvent *event)
 {
+    // Any key may start something moving, animate decides when to sleep again
+    startAnimating();
+
     // Player directions update
     if (event->key() == Qt::Key_W)
         playerPosYOffset = 2.0f;
@@ -414,6 +447,26 @@ void OpenGLWidget::keyPressEvent(QKeyEvent *event)
         setShootingParameters();
     }
 
+    // Toggle the sprite batch stress test
+    if (event->key() == Qt::Key_F2)
+    {
+        stressMode = !stressMode;
+        if (stressMode && !stressSprites)
+            createStressSprites();
+        stressFrameTime = 0;
+        stressFrames = 0;
+        fullRedraw = true;
+    }
+
+    // Toggle the bullet-hell mode
+    if (event->key() == Qt::Key_B)
+    {
+        if (!bulletHell)
+            bulletHell = std::make_unique<BulletHell>(this);
+        bulletHellMode = !bulletHellMode;
+        fullRedraw = true;
+    }
+
     if (event->key() == Qt::Key_Escape)
     {
         QApplication::quit();
@@ -7,21 +7,20 @@
 
 #include <memory>
 
+#include "spritebatch.h"
+#include "bullethell.h"
+
 class OpenGLWidget : public QOpenGLWidget, protected QOpenGLExtraFunctions
 {
     Q_OBJECT
 
-    GLuint vboVertices = 0;
-    GLuint vboColors = 0;
-    GLuint vboIndices = 0;
-
-    GLuint vao = 0;
+    static const unsigned int NUM_STRESS_SPRITES = 100000;
 
-    std::unique_ptr<QVector4D []> vertices = nullptr;
-    std::unique_ptr<QVector4D []> colors = nullptr;
-    std::unique_ptr<unsigned int[]> indices = nullptr;
+    std::unique_ptr<SpriteBatch> batch = nullptr;
+    std::unique_ptr<BulletHell> bulletHell = nullptr;
 
-    GLuint shaderProgram;
+    int viewportWidth;
+    int viewportHeight;
 
     float playerPosXOffset; // Player displacement along X axis
     float playerPosYOffset; // Player displacement along Y axis
@@ -43,18 +42,43 @@ class OpenGLWidget : public QOpenGLWidget, protected QOpenGLExtraFunctions
     int numHits; // Number of hits
     float totalTime;
 
+    bool stressMode; // Draw NUM_STRESS_SPRITES extra moving sprites to measure throughput
+    std::unique_ptr<QVector4D []> stressSprites = nullptr; // x, y, vx, vy
+    std::unique_ptr<QVector4D []> stressColors = nullptr;
+    QElapsedTimer stressTimer;
+    qint64 stressFrameTime; // Accumulated paintGL time in nanoseconds
+    int stressFrames;
+
+    bool bulletHellMode; // GPU simulated projectiles and enemies
+    unsigned int bulletHellHits; // Kept apart from numHits, which drives the target speed
+
     QTimer timer;
+    QTimer wakeTimer; // Single shot, wakes an idle widget for time based events
     QTime time;
 
+    // Render on demand: sprites drawn by the last paintGL, as x, y, width, height
+    static const int MAX_GAME_SPRITES = 3;
+    QVector4D drawnSprites[MAX_GAME_SPRITES];
+    int numDrawnSprites;
+    bool fullRedraw; // Set when the preserved back buffer can not be trusted
+
+    // Counters for the render on demand scheduling
+    unsigned int framesDrawn;
+    unsigned int framesSkipped;
+    qint64 pixelsRedrawn;
+    QElapsedTimer statsTimer;
+
 public:
     explicit OpenGLWidget (QWidget *parent = 0);
     ~OpenGLWidget();
 
-    void createVBOs();
-    void createShaders();
+    void createStressSprites();
+    void animateStressSprites(float elapsedTime);
 
-    void destroyVBOs();
-    void destroyShaders();
+    int collectGameSprites(QVector4D *sprites);
+    QRect spriteBounds(const QVector4D &sprite);
+    bool isAnimating();
+    void startAnimating();
 
 protected :
     void initializeGL();
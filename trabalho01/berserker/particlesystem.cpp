@@ -0,0 +1,186 @@
+#include "particlesystem.h"
+
+ParticleSystem::ParticleSystem(QOpenGLWidget *_glWidget, unsigned int _maxParticles, unsigned int _maxSpawn)
+{
+    glWidget = _glWidget;
+    glWidget->makeCurrent();
+
+    initializeOpenGLFunctions();
+
+    maxParticles = _maxParticles;
+    maxSpawn = _maxSpawn;
+    spawns = std::make_unique<QVector4D[]>(maxSpawn);
+
+    createVBOs();
+}
+
+ParticleSystem::~ParticleSystem()
+{
+    destroyVBOs();
+}
+
+void ParticleSystem::createVBOs()
+{
+    destroyVBOs();
+
+    glGenBuffers(2, vboParticles);
+    glGenVertexArrays(2, vaoParticles);
+    glGenTransformFeedbacks(2, feedback);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        glBindVertexArray(vaoParticles[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, vboParticles[i]);
+        glBufferData(GL_ARRAY_BUFFER, maxParticles * sizeof(QVector4D), nullptr, GL_DYNAMIC_COPY);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, nullptr);
+        glEnableVertexAttribArray(0);
+
+        // The feedback object remembers which buffer it writes into
+        glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, feedback[i]);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, vboParticles[i]);
+    }
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+
+    glGenVertexArrays(1, &vaoSpawn);
+    glBindVertexArray(vaoSpawn);
+    glGenBuffers(1, &vboSpawn);
+    glBindBuffer(GL_ARRAY_BUFFER, vboSpawn);
+    glBufferData(GL_ARRAY_BUFFER, maxSpawn * sizeof(QVector4D), nullptr, GL_STREAM_DRAW);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glEnableVertexAttribArray(0);
+
+    glBindVertexArray(0);
+
+    glGenQueries(NUM_QUERIES, queries);
+}
+
+void ParticleSystem::destroyVBOs()
+{
+    glDeleteQueries(NUM_QUERIES, queries);
+    glDeleteTransformFeedbacks(2, feedback);
+    glDeleteBuffers(2, vboParticles);
+    glDeleteVertexArrays(2, vaoParticles);
+    glDeleteBuffers(1, &vboSpawn);
+    glDeleteVertexArrays(1, &vaoSpawn);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        vboParticles[i] = 0;
+        vaoParticles[i] = 0;
+        feedback[i] = 0;
+        hasParticles[i] = false;
+    }
+    for (int i = 0; i < NUM_QUERIES; ++i)
+        queries[i] = 0;
+    vboSpawn = 0;
+    vaoSpawn = 0;
+    pendingQueries = 0;
+    count = 0;
+}
+
+unsigned int ParticleSystem::estimatedCount()
+{
+    // Upper bound: the last known count plus everything spawned since then
+    unsigned int estimate = count + numSpawns;
+    for (int i = 0; i < pendingQueries; ++i)
+        estimate += spawnedAt[(queryHead - 1 - i + NUM_QUERIES) % NUM_QUERIES];
+    return estimate;
+}
+
+bool ParticleSystem::spawn(const QVector4D &state)
+{
+    // Never let the feedback buffer overflow, dropped writes would count as kills
+    if (numSpawns >= maxSpawn || estimatedCount() >= maxParticles)
+        return false;
+
+    spawns[numSpawns++] = state;
+    return true;
+}
+
+void ParticleSystem::update()
+{
+    int src = current;
+    int dst = 1 - current;
+
+    // Keep at most NUM_QUERIES in flight, the oldest is long done by now
+    if (pendingQueries == NUM_QUERIES)
+        collectCounts(true);
+
+    int slot = queryHead;
+    spawnedAt[slot] = numSpawns;
+    queryHead = (queryHead + 1) % NUM_QUERIES;
+    pendingQueries++;
+
+    if (numSpawns)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, vboSpawn);
+        glBufferData(GL_ARRAY_BUFFER, maxSpawn * sizeof(QVector4D), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, numSpawns * sizeof(QVector4D), spawns.get());
+    }
+
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, feedback[dst]);
+    glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, queries[slot]);
+    glBeginTransformFeedback(GL_POINTS);
+
+    // Survivors first, then this frame's spawns appended behind them
+    if (hasParticles[src])
+    {
+        glBindVertexArray(vaoParticles[src]);
+        glDrawTransformFeedback(GL_POINTS, feedback[src]);
+    }
+    if (numSpawns)
+    {
+        glBindVertexArray(vaoSpawn);
+        glDrawArrays(GL_POINTS, 0, numSpawns);
+    }
+
+    glEndTransformFeedback();
+    glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+    glBindVertexArray(0);
+
+    hasParticles[dst] = true;
+    current = dst;
+    numSpawns = 0;
+}
+
+void ParticleSystem::draw()
+{
+    if (!hasParticles[current])
+        return;
+
+    glBindVertexArray(vaoParticles[current]);
+    glDrawTransformFeedback(GL_POINTS, feedback[current]);
+    glBindVertexArray(0);
+}
+
+void ParticleSystem::collectCounts(bool wait)
+{
+    while (pendingQueries > 0)
+    {
+        int slot = (queryHead - pendingQueries + NUM_QUERIES) % NUM_QUERIES;
+
+        GLuint available = 0;
+        glGetQueryObjectuiv(queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available && !wait)
+            break;
+
+        GLuint written = 0;
+        glGetQueryObjectuiv(queries[slot], GL_QUERY_RESULT, &written);
+
+        unsigned int expected = count + spawnedAt[slot];
+        if (expected > written)
+            removed += expected - written;
+        count = written;
+
+        pendingQueries--;
+        wait = false; // Only the oldest query is ever waited for
+    }
+}
+
+unsigned int ParticleSystem::takeRemoved()
+{
+    unsigned int result = removed;
+    removed = 0;
+    return result;
+}
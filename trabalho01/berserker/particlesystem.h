@@ -0,0 +1,58 @@
+#ifndef PARTICLESYSTEM_H
+#define PARTICLESYSTEM_H
+
+#include <QtOpenGL>
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions_4_1_Core>
+
+#include <memory>
+
+// Particles living entirely in GPU memory. Each particle is one vec4 (position
+// xy, velocity zw). Updates run through transform feedback from one buffer into
+// the other, and the geometry stage drops dead particles so the live set stays
+// packed. The CPU only appends spawns and reads back how many particles survived.
+class ParticleSystem : public QOpenGLFunctions_4_1_Core
+{
+public:
+    ParticleSystem(QOpenGLWidget *_glWidget, unsigned int _maxParticles, unsigned int _maxSpawn);
+    ~ParticleSystem();
+
+    QOpenGLWidget *glWidget;
+
+    static const int NUM_QUERIES = 4;
+
+    unsigned int maxParticles;
+    unsigned int maxSpawn;
+
+    GLuint vboParticles[2] = {0, 0};
+    GLuint vaoParticles[2] = {0, 0};
+    GLuint feedback[2] = {0, 0};
+    bool hasParticles[2] = {false, false}; // Whether feedback[i] captured anything yet
+    int current = 0; // Buffer holding the latest state
+
+    GLuint vboSpawn = 0;
+    GLuint vaoSpawn = 0;
+    std::unique_ptr<QVector4D[]> spawns = nullptr;
+    unsigned int numSpawns = 0;
+
+    // Live counts come back through a small ring of queries, read when ready
+    GLuint queries[NUM_QUERIES] = {0, 0, 0, 0};
+    unsigned int spawnedAt[NUM_QUERIES] = {0, 0, 0, 0};
+    int queryHead = 0;
+    int pendingQueries = 0;
+
+    unsigned int count = 0; // Live particles as of the last query read back
+    unsigned int removed = 0; // Particles killed since the last takeRemoved()
+
+    void createVBOs();
+    void destroyVBOs();
+
+    unsigned int estimatedCount();
+    bool spawn(const QVector4D &state);
+    void update();
+    void draw();
+    void collectCounts(bool wait);
+    unsigned int takeRemoved();
+};
+
+#endif // PARTICLESYSTEM_H
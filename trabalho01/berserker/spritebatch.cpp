@@ -0,0 +1,233 @@
+#include "spritebatch.h"
+
+SpriteBatch::SpriteBatch(QOpenGLWidget *_glWidget, unsigned int _maxSprites)
+{
+    glWidget = _glWidget;
+    glWidget->makeCurrent();
+
+    initializeOpenGLFunctions();
+
+    maxSprites = _maxSprites;
+    sprites = std::make_unique<Sprite[]>(maxSprites);
+
+    createShaders();
+    createVBOs();
+}
+
+SpriteBatch::~SpriteBatch()
+{
+    destroyVBOs();
+    destroyShaders();
+}
+
+void SpriteBatch::createShaders()
+{
+    destroyShaders();
+
+    QFile vs(":/shaders/vshader1.glsl");
+    QFile fs(":/shaders/fshader1.glsl");
+
+    vs.open(QFile::ReadOnly | QFile::Text);
+    fs.open(QFile::ReadOnly | QFile::Text);
+
+    QTextStream streamVs(&vs), streamFs(&fs);
+
+    QString qtStringVs = streamVs.readAll();
+    QString qtStringFs = streamFs.readAll();
+
+    std::string stdStringVs = qtStringVs.toStdString();
+    std::string stdStringFs = qtStringFs.toStdString();
+
+    // Create an empty vertex shader handle
+    GLuint vertexShader = 0;
+    vertexShader = glCreateShader(GL_VERTEX_SHADER);
+
+    // Send the vertex shader source code to GL
+    const GLchar *source = stdStringVs.c_str();
+
+    glShaderSource(vertexShader, 1, &source, 0);
+
+    // Compile the vertex shader
+    glCompileShader(vertexShader);
+
+    GLint isCompiled = 0;
+    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &isCompiled);
+    if (isCompiled == GL_FALSE)
+    {
+        GLint maxLength = 0;
+        glGetShaderiv(vertexShader, GL_INFO_LOG_LENGTH, &maxLength);
+        // The maxLength includes the NULL character
+        std::vector<GLchar> infoLog(maxLength);
+        glGetShaderInfoLog(vertexShader, maxLength, &maxLength, &infoLog[0]);
+        qDebug("%s", &infoLog[0]);
+
+        glDeleteShader(vertexShader);
+        return;
+    }
+
+    // Create an empty fragment shader handle
+    GLuint fragmentShader = 0;
+    fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+
+    // Send the fragment shader source code to GL
+    source = stdStringFs.c_str();
+    glShaderSource(fragmentShader, 1, &source, 0);
+
+    // Compile the fragment shader
+    glCompileShader(fragmentShader);
+
+    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &isCompiled);
+    if (isCompiled == GL_FALSE)
+    {
+        GLint maxLength = 0;
+        glGetShaderiv(fragmentShader, GL_INFO_LOG_LENGTH, &maxLength);
+
+        std::vector<GLchar> infoLog(maxLength);
+        glGetShaderInfoLog(fragmentShader, maxLength, &maxLength, &infoLog[0]);
+        qDebug("%s", &infoLog[0]);
+
+        glDeleteShader(fragmentShader);
+        glDeleteShader(vertexShader);
+        return;
+    }
+
+    shaderProgram = glCreateProgram();
+
+    glAttachShader(shaderProgram, vertexShader);
+    glAttachShader(shaderProgram, fragmentShader);
+
+    glLinkProgram(shaderProgram);
+
+    GLint isLinked = 0;
+    glGetProgramiv(shaderProgram, GL_LINK_STATUS, (int *)&isLinked);
+    if (isLinked == GL_FALSE)
+    {
+        GLint maxLength = 0;
+        glGetProgramiv(shaderProgram, GL_INFO_LOG_LENGTH, &maxLength);
+
+        // The maxLength includes the NULL character
+        std::vector<GLchar> infoLog(maxLength);
+        glGetProgramInfoLog(shaderProgram, maxLength, &maxLength, &infoLog[0]);
+        qDebug("%s", &infoLog[0]);
+
+        glDeleteProgram(shaderProgram);
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        shaderProgram = 0;
+        return;
+    }
+
+    glDetachShader(shaderProgram, vertexShader);
+    glDetachShader(shaderProgram, fragmentShader);
+
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    vs.close();
+    fs.close();
+
+    // Looked up once here instead of every frame
+    locColorTexture = glGetUniformLocation(shaderProgram, "colorTexture");
+}
+
+void SpriteBatch::destroyShaders()
+{
+    glDeleteProgram(shaderProgram);
+    shaderProgram = 0;
+}
+
+void SpriteBatch::createVBOs()
+{
+    destroyVBOs();
+
+    // Unit quad shared by every sprite, drawn as a triangle strip
+    const float corners[] = {-0.5f, -0.5f,  0.5f, -0.5f,  -0.5f, 0.5f,  0.5f, 0.5f};
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    glGenBuffers(1, &vboCorners);
+    glBindBuffer(GL_ARRAY_BUFFER, vboCorners);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glEnableVertexAttribArray(0);
+
+    // One Sprite per instance
+    glGenBuffers(1, &vboSprites);
+    glBindBuffer(GL_ARRAY_BUFFER, vboSprites);
+    glBufferData(GL_ARRAY_BUFFER, maxSprites * sizeof(Sprite), nullptr, GL_STREAM_DRAW);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Sprite), reinterpret_cast<void *>(offsetof(Sprite, rect)));
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Sprite), reinterpret_cast<void *>(offsetof(Sprite, color)));
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(Sprite), reinterpret_cast<void *>(offsetof(Sprite, texRect)));
+    for (GLuint i = 1; i <= 3; ++i)
+    {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, 1);
+    }
+
+    glBindVertexArray(0);
+
+    // Untextured sprites sample a single white texel
+    const unsigned char white[] = {255, 255, 255, 255};
+    glGenTextures(1, &whiteTexture);
+    glBindTexture(GL_TEXTURE_2D, whiteTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+}
+
+void SpriteBatch::destroyVBOs()
+{
+    glDeleteBuffers(1, &vboCorners);
+    glDeleteBuffers(1, &vboSprites);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteTextures(1, &whiteTexture);
+
+    vboCorners = 0;
+    vboSprites = 0;
+    vao = 0;
+    whiteTexture = 0;
+}
+
+void SpriteBatch::begin()
+{
+    numSprites = 0;
+}
+
+void SpriteBatch::add(float x, float y, float width, float height, const QVector4D &color,
+                      const QVector4D &texRect)
+{
+    if (numSprites >= maxSprites)
+        return;
+
+    Sprite &sprite = sprites[numSprites++];
+    sprite.rect[0] = x;
+    sprite.rect[1] = y;
+    sprite.rect[2] = width;
+    sprite.rect[3] = height;
+    for (int i = 0; i < 4; ++i)
+    {
+        sprite.color[i] = color[i];
+        sprite.texRect[i] = texRect[i];
+    }
+}
+
+void SpriteBatch::flush(GLuint texture)
+{
+    if (!numSprites || !shaderProgram)
+        return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, vboSprites);
+    // Orphan the previous storage, then fill only what this frame uses
+    glBufferData(GL_ARRAY_BUFFER, maxSprites * sizeof(Sprite), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, numSprites * sizeof(Sprite), sprites.get());
+
+    glUseProgram(shaderProgram);
+    glUniform1i(locColorTexture, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture ? texture : whiteTexture);
+
+    glBindVertexArray(vao);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, numSprites);
+    drawCalls++;
+}
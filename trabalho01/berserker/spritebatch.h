@@ -0,0 +1,55 @@
+#ifndef SPRITEBATCH_H
+#define SPRITEBATCH_H
+
+#include <QtOpenGL>
+#include <QOpenGLWidget>
+#include <QOpenGLExtraFunctions>
+
+#include <cstddef>
+#include <memory>
+
+struct Sprite
+{
+    float rect[4]; // Centre x, y and width, height in clip space
+    float color[4];
+    float texRect[4]; // u0, v0, u1, v1
+};
+
+// Collects the quads of a frame and draws them all with one instanced call.
+// The instance buffer is orphaned before every upload so the driver never
+// has to wait for the previous frame to finish reading it.
+class SpriteBatch : public QOpenGLExtraFunctions
+{
+public:
+    SpriteBatch(QOpenGLWidget *_glWidget, unsigned int _maxSprites);
+    ~SpriteBatch();
+
+    QOpenGLWidget *glWidget;
+
+    unsigned int maxSprites;
+    std::unique_ptr<Sprite[]> sprites = nullptr;
+    unsigned int numSprites = 0;
+
+    GLuint vao = 0;
+    GLuint vboCorners = 0;
+    GLuint vboSprites = 0;
+    GLuint whiteTexture = 0;
+
+    GLuint shaderProgram = 0;
+    GLint locColorTexture = -1;
+
+    unsigned int drawCalls = 0;
+
+    void createShaders();
+    void createVBOs();
+
+    void destroyVBOs();
+    void destroyShaders();
+
+    void begin();
+    void add(float x, float y, float width, float height, const QVector4D &color,
+             const QVector4D &texRect = QVector4D(0, 0, 1, 1));
+    void flush(GLuint texture = 0);
+};
+
+#endif // SPRITEBATCH_H
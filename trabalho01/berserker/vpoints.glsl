@@ -0,0 +1,11 @@
+#version 410
+
+layout (location = 0) in vec4 vState; // position xy, velocity zw
+
+uniform float pointSize;
+
+void main()
+{
+    gl_Position = vec4(vState.xy, 0, 1);
+    gl_PointSize = pointSize;
+}
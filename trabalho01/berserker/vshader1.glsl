@@ -1,18 +1,20 @@
 #version 410
 
  //(in)put variables processed in parallel
-layout (location = 0) in vec4 vPosition;
-layout (location = 1) in vec4 vColors;
+layout (location = 0) in vec2 vCorner;
+ // per sprite (instance) attributes
+layout (location = 1) in vec4 vRect; // centre xy, size zw
+layout (location = 2) in vec4 vColors;
+layout (location = 3) in vec4 vTexRect; // u0 v0 u1 v1
 
  //(out)put variable interpolated at fragment shader raster
  out vec4 v2fcolor;
-
- uniform float scaling;
- uniform vec4 translation;
+ out vec2 v2ftexcoord;
 
  void main()
  {
      //gl_Position->out builtin variable
-     gl_Position = (vPosition * vec4(scaling, scaling, scaling, 1)) + translation;
+     gl_Position = vec4(vRect.xy + vCorner * vRect.zw, 0, 1);
      v2fcolor = vColors;
+     v2ftexcoord = mix(vTexRect.xy, vTexRect.zw, vCorner + 0.5);
  }
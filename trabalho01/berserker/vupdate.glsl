@@ -0,0 +1,44 @@
+#version 410
+
+layout (location = 0) in vec4 vState; // position xy, velocity zw
+
+uniform float elapsedTime;
+uniform int isEnemy;
+uniform sampler2D occupancy; // r: enemies, g: projectiles
+
+out vec4 gState;
+out float gAlive;
+
+void main()
+{
+    vec2 position = vState.xy + vState.zw * elapsedTime;
+    vec2 velocity = vState.zw;
+
+    // The grid was splatted from the positions before this step
+    vec4 cell = texture(occupancy, vState.xy * 0.5 + 0.5);
+
+    gAlive = 1.0;
+    if (isEnemy == 1)
+    {
+        // Enemies bounce, so they only ever die when hit
+        if (abs(position.x) > 1.0)
+        {
+            velocity.x = -velocity.x;
+            position.x = clamp(position.x, -1.0, 1.0);
+        }
+        if (abs(position.y) > 1.0)
+        {
+            velocity.y = -velocity.y;
+            position.y = clamp(position.y, -1.0, 1.0);
+        }
+        if (cell.g > 0.0)
+            gAlive = 0.0;
+    }
+    else
+    {
+        if (abs(position.x) > 1.0 || abs(position.y) > 1.0 || cell.r > 0.0)
+            gAlive = 0.0;
+    }
+
+    gState = vec4(position, velocity);
+}
@@ -0,0 +1,523 @@
+#include "bvh.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QVector2D>
+
+#include <stdio.h>
+#include <math.h>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <thread>
+#include <utility>
+
+#include "model.h"
+#include "offformat.h"
+
+namespace
+{
+    float surfaceArea(const float *min, const float *max)
+    {
+        float dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+        return 2.0f * (dx * dy + dy * dz + dz * dx);
+    }
+
+    void growBounds(float *min, float *max, const float *pointMin, const float *pointMax)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            min[k] = std::min(min[k], pointMin[k]);
+            max[k] = std::max(max[k], pointMax[k]);
+        }
+    }
+
+    void emptyBounds(float *min, float *max)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            min[k] = std::numeric_limits<float>::max();
+            max[k] = std::numeric_limits<float>::lowest();
+        }
+    }
+
+    void transformPoint(const float *m, const float *p, float *out)
+    {
+        // Column major, like QMatrix4x4::constData
+        for (int r = 0; r < 3; ++r)
+            out[r] = m[r] * p[0] + m[4 + r] * p[1] + m[8 + r] * p[2] + m[12 + r];
+    }
+
+    // Box of b's node in a's space, conservative for the rotated box
+    void transformBox(const float *m, const BvhNode &node, float *min, float *max)
+    {
+        float centre[3], extent[3], newCentre[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            centre[k] = (node.min[k] + node.max[k]) * 0.5f;
+            extent[k] = (node.max[k] - node.min[k]) * 0.5f;
+        }
+        transformPoint(m, centre, newCentre);
+        for (int r = 0; r < 3; ++r)
+        {
+            float e = fabsf(m[r]) * extent[0] + fabsf(m[4 + r]) * extent[1] + fabsf(m[8 + r]) * extent[2];
+            min[r] = newCentre[r] - e;
+            max[r] = newCentre[r] + e;
+        }
+    }
+
+    bool boxesOverlap(const float *minA, const float *maxA, const float *minB, const float *maxB)
+    {
+        return minA[0] <= maxB[0] && minB[0] <= maxA[0]
+            && minA[1] <= maxB[1] && minB[1] <= maxA[1]
+            && minA[2] <= maxB[2] && minB[2] <= maxA[2];
+    }
+
+    void triangleBounds(const float *t, float *min, float *max)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            min[k] = std::min(t[k], std::min(t[3 + k], t[6 + k]));
+            max[k] = std::max(t[k], std::max(t[3 + k], t[6 + k]));
+        }
+    }
+
+    void subtract(const float *a, const float *b, float *out)
+    {
+        out[0] = a[0] - b[0];
+        out[1] = a[1] - b[1];
+        out[2] = a[2] - b[2];
+    }
+
+    void cross(const float *a, const float *b, float *out)
+    {
+        out[0] = a[1] * b[2] - a[2] * b[1];
+        out[1] = a[2] * b[0] - a[0] * b[2];
+        out[2] = a[0] * b[1] - a[1] * b[0];
+    }
+
+    float dot(const float *a, const float *b)
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    bool separatedAlong(const float *axis, const float *a, const float *b)
+    {
+        if (dot(axis, axis) < 1e-12f)
+            return false; // Parallel edges, the axis says nothing
+
+        float a0 = dot(axis, a), a1 = dot(axis, a + 3), a2 = dot(axis, a + 6);
+        float b0 = dot(axis, b), b1 = dot(axis, b + 3), b2 = dot(axis, b + 6);
+        return std::max(a0, std::max(a1, a2)) < std::min(b0, std::min(b1, b2))
+            || std::max(b0, std::max(b1, b2)) < std::min(a0, std::min(a1, a2));
+    }
+
+    // Separating axis test: the two normals and the nine edge crosses decide
+    // for triangles in different planes, the in-plane edge normals for
+    // coplanar ones. Testing all of them is always correct.
+    bool trianglesIntersect(const float *a, const float *b)
+    {
+        float edgesA[3][3], edgesB[3][3], normalA[3], normalB[3], axis[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            subtract(a + ((i + 1) % 3) * 3, a + i * 3, edgesA[i]);
+            subtract(b + ((i + 1) % 3) * 3, b + i * 3, edgesB[i]);
+        }
+        cross(edgesA[0], edgesA[1], normalA);
+        cross(edgesB[0], edgesB[1], normalB);
+
+        if (separatedAlong(normalA, a, b) || separatedAlong(normalB, a, b))
+            return false;
+
+        for (int i = 0; i < 3; ++i)
+            for (int j = 0; j < 3; ++j)
+            {
+                cross(edgesA[i], edgesB[j], axis);
+                if (separatedAlong(axis, a, b))
+                    return false;
+            }
+
+        for (int i = 0; i < 3; ++i)
+        {
+            cross(normalA, edgesA[i], axis);
+            if (separatedAlong(axis, a, b))
+                return false;
+            cross(normalB, edgesB[i], axis);
+            if (separatedAlong(axis, a, b))
+                return false;
+        }
+        return true;
+    }
+}
+
+void MeshBvh::build(const QVector4D *vertices, const unsigned int *indices, unsigned int numFaces, int numThreads)
+{
+    nodes.clear();
+    triangles.clear();
+    if (!numFaces)
+        return;
+
+    if (numThreads <= 0)
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    references.resize(numFaces);
+    for (unsigned int i = 0; i < numFaces; ++i)
+    {
+        Reference &reference = references[i];
+        float t[9];
+        for (int v = 0; v < 3; ++v)
+        {
+            const QVector4D &p = vertices[indices[i * 3 + v]];
+            t[v * 3 + 0] = p.x();
+            t[v * 3 + 1] = p.y();
+            t[v * 3 + 2] = p.z();
+        }
+        triangleBounds(t, reference.min, reference.max);
+        for (int k = 0; k < 3; ++k)
+            reference.centroid[k] = (reference.min[k] + reference.max[k]) * 0.5f;
+        reference.triangle = i;
+    }
+
+    // A binary tree over n leaves never needs more than 2n - 1 nodes, so the
+    // array is never reallocated while threads hold references into it
+    nodes.resize(2 * numFaces - 1);
+    usedNodes = 1;
+    buildNode(0, 0, int(numFaces), numThreads);
+    nodes.resize(usedNodes);
+
+    // Triangles in leaf order so a leaf reads one contiguous run
+    triangles.resize(size_t(numFaces) * 9);
+    for (unsigned int i = 0; i < numFaces; ++i)
+    {
+        unsigned int face = references[i].triangle;
+        for (int v = 0; v < 3; ++v)
+        {
+            const QVector4D &p = vertices[indices[face * 3 + v]];
+            triangles[i * 9 + v * 3 + 0] = p.x();
+            triangles[i * 9 + v * 3 + 1] = p.y();
+            triangles[i * 9 + v * 3 + 2] = p.z();
+        }
+    }
+
+    references.clear();
+    references.shrink_to_fit();
+}
+
+void MeshBvh::makeLeaf(BvhNode &node, int first, int count)
+{
+    node.first = first;
+    node.count = count;
+}
+
+void MeshBvh::buildNode(int index, int first, int count, int numThreads)
+{
+    BvhNode &node = nodes[index];
+    float centroidMin[3], centroidMax[3];
+    emptyBounds(node.min, node.max);
+    emptyBounds(centroidMin, centroidMax);
+    for (int i = first; i < first + count; ++i)
+    {
+        growBounds(node.min, node.max, references[i].min, references[i].max);
+        growBounds(centroidMin, centroidMax, references[i].centroid, references[i].centroid);
+    }
+
+    if (count <= MAX_LEAF)
+    {
+        makeLeaf(node, first, count);
+        return;
+    }
+
+    int axis = 0;
+    for (int k = 1; k < 3; ++k)
+        if (centroidMax[k] - centroidMin[k] > centroidMax[axis] - centroidMin[axis])
+            axis = k;
+    float extent = centroidMax[axis] - centroidMin[axis];
+    if (extent <= 0.0f && count <= MAX_SAH_LEAF)
+    {
+        // Every centroid in the same spot, no plane can separate them
+        makeLeaf(node, first, count);
+        return;
+    }
+
+    int binCounts[BINS] = {};
+    float binMin[BINS][3], binMax[BINS][3];
+    for (int b = 0; b < BINS; ++b)
+        emptyBounds(binMin[b], binMax[b]);
+
+    float toBin = extent > 0.0f ? BINS / extent : 0.0f;
+    auto binOf = [&](const Reference &reference) {
+        return std::min(BINS - 1, int((reference.centroid[axis] - centroidMin[axis]) * toBin));
+    };
+    for (int i = first; i < first + count; ++i)
+    {
+        int b = binOf(references[i]);
+        binCounts[b]++;
+        growBounds(binMin[b], binMax[b], references[i].min, references[i].max);
+    }
+
+    // Sweep from the right to get the cost of every right side, then from the
+    // left to combine; splitting after bin s puts bins 0..s on the left
+    float rightArea[BINS];
+    int rightCount[BINS];
+    float sweepMin[3], sweepMax[3];
+    emptyBounds(sweepMin, sweepMax);
+    int runningCount = 0;
+    for (int b = BINS - 1; b > 0; --b)
+    {
+        runningCount += binCounts[b];
+        if (binCounts[b])
+            growBounds(sweepMin, sweepMax, binMin[b], binMax[b]);
+        rightCount[b] = runningCount;
+        rightArea[b] = runningCount ? surfaceArea(sweepMin, sweepMax) : 0.0f;
+    }
+
+    float bestCost = std::numeric_limits<float>::max();
+    int bestSplit = -1;
+    emptyBounds(sweepMin, sweepMax);
+    runningCount = 0;
+    for (int s = 0; s < BINS - 1; ++s)
+    {
+        runningCount += binCounts[s];
+        if (binCounts[s])
+            growBounds(sweepMin, sweepMax, binMin[s], binMax[s]);
+        if (!runningCount || !rightCount[s + 1])
+            continue;
+        float cost = runningCount * surfaceArea(sweepMin, sweepMax) + rightCount[s + 1] * rightArea[s + 1];
+        if (cost < bestCost)
+        {
+            bestCost = cost;
+            bestSplit = s;
+        }
+    }
+
+    float leafCost = count * surfaceArea(node.min, node.max);
+    if (count <= MAX_SAH_LEAF && bestCost >= leafCost)
+    {
+        makeLeaf(node, first, count);
+        return;
+    }
+
+    Reference *begin = references.data() + first;
+    Reference *end = begin + count;
+    Reference *middle;
+    if (bestSplit >= 0)
+    {
+        middle = std::partition(begin, end, [&](const Reference &reference) {
+            return binOf(reference) <= bestSplit;
+        });
+    }
+    else
+    {
+        // All centroids fell in one bin: halve by position instead
+        middle = begin + count / 2;
+        std::nth_element(begin, middle, end, [axis](const Reference &p, const Reference &q) {
+            return p.centroid[axis] < q.centroid[axis];
+        });
+    }
+    int leftCount = int(middle - begin);
+
+    int children = usedNodes.fetch_add(2);
+    node.first = children;
+    node.count = 0;
+
+    if (numThreads > 1 && count >= PARALLEL_MIN)
+    {
+        int leftThreads = numThreads / 2;
+        std::thread left([=] { buildNode(children, first, leftCount, leftThreads); });
+        buildNode(children + 1, first + leftCount, count - leftCount, numThreads - leftThreads);
+        left.join();
+    }
+    else
+    {
+        buildNode(children, first, leftCount, 1);
+        buildNode(children + 1, first + leftCount, count - leftCount, 1);
+    }
+}
+
+bool MeshBvh::overlaps(const MeshBvh &a, const Matrix4 &transformA,
+                       const MeshBvh &b, const Matrix4 &transformB)
+{
+    if (a.isEmpty() || b.isEmpty())
+        return false;
+
+    Matrix4 bToA = transformA.inverted() * transformB;
+    const float *m = bToA.data();
+
+    // Reused between queries so a collision tick does not allocate
+    thread_local std::vector<std::pair<int, int>> stack;
+    stack.clear();
+    stack.push_back(std::make_pair(0, 0));
+
+    float boxMin[3], boxMax[3];
+    float transformed[MAX_SAH_LEAF * 9];
+    float triangleMin[3], triangleMax[3], otherMin[3], otherMax[3];
+
+    while (!stack.empty())
+    {
+        std::pair<int, int> pair = stack.back();
+        stack.pop_back();
+        const BvhNode &nodeA = a.nodes[pair.first];
+        const BvhNode &nodeB = b.nodes[pair.second];
+
+        transformBox(m, nodeB, boxMin, boxMax);
+        if (!boxesOverlap(nodeA.min, nodeA.max, boxMin, boxMax))
+            continue;
+
+        if (nodeA.count && nodeB.count)
+        {
+            for (int j = 0; j < nodeB.count; ++j)
+            {
+                const float *source = &b.triangles[size_t(nodeB.first + j) * 9];
+                for (int v = 0; v < 3; ++v)
+                    transformPoint(m, source + v * 3, transformed + j * 9 + v * 3);
+            }
+
+            for (int i = 0; i < nodeA.count; ++i)
+            {
+                const float *triangle = &a.triangles[size_t(nodeA.first + i) * 9];
+                triangleBounds(triangle, triangleMin, triangleMax);
+                if (!boxesOverlap(triangleMin, triangleMax, boxMin, boxMax))
+                    continue;
+                for (int j = 0; j < nodeB.count; ++j)
+                {
+                    triangleBounds(transformed + j * 9, otherMin, otherMax);
+                    if (boxesOverlap(triangleMin, triangleMax, otherMin, otherMax)
+                            && trianglesIntersect(triangle, transformed + j * 9))
+                        return true;
+                }
+            }
+            continue;
+        }
+
+        // Open the bigger of the two boxes, or whichever is not a leaf
+        bool descendA = !nodeA.count && (nodeB.count || surfaceArea(nodeA.min, nodeA.max) >= surfaceArea(boxMin, boxMax));
+        if (descendA)
+        {
+            stack.push_back(std::make_pair(nodeA.first, pair.second));
+            stack.push_back(std::make_pair(nodeA.first + 1, pair.second));
+        }
+        else
+        {
+            stack.push_back(std::make_pair(pair.first, nodeB.first));
+            stack.push_back(std::make_pair(pair.first, nodeB.first + 1));
+        }
+    }
+    return false;
+}
+
+namespace
+{
+    // Same parsing as Model::readOFFFile, without the attributes a BVH has no use for
+    bool readOFF(const QString &fileName, std::vector<QVector4D> &vertices, std::vector<unsigned int> &indices)
+    {
+        QFile file(fileName);
+        OffHeader header;
+        if (!file.open(QFile::ReadOnly) || !OffFormat::readHeader(file, header))
+            return false;
+
+        QByteArray line;
+        OffVertex vertex;
+        vertices.resize(header.numVertices);
+        for (unsigned int i = 0; i < header.numVertices; ++i)
+        {
+            OffFormat::parseVertex(OffFormat::readLine(file, line) ? line.constData() : "", header, vertex);
+            vertices[i] = QVector4D(vertex.position[0], vertex.position[1], vertex.position[2], 1.0f);
+        }
+
+        indices.clear();
+        indices.reserve(header.numFaces * 3);
+        std::vector<unsigned int> polygon;
+        float color[4];
+        bool hasColor = false;
+        for (unsigned int i = 0; i < header.numFaces; ++i)
+        {
+            if (OffFormat::readLine(file, line) &&
+                OffFormat::parseFace(line.constData(), header.numVertices, polygon, color, hasColor))
+                OffFormat::triangulate(polygon, vertices.data(), indices);
+        }
+        return true;
+    }
+
+    struct BenchmarkMesh
+    {
+        const char *name;
+        std::vector<QVector4D> vertices;
+        std::vector<unsigned int> indices;
+        MeshBvh bvh;
+    };
+}
+
+int runBvhBenchmark()
+{
+    const char *names[] = {"car", "barriere", "gastank"};
+    BenchmarkMesh meshes[3];
+    int numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    printf("%-10s %10s %8s %12s %12s\n", "mesh", "triangles", "nodes", "1 thread ms",
+           QString("%1 threads ms").arg(numThreads).toLatin1().constData());
+    for (int i = 0; i < 3; ++i)
+    {
+        BenchmarkMesh &mesh = meshes[i];
+        mesh.name = names[i];
+        if (!readOFF(QString(":/models/%1.off").arg(mesh.name), mesh.vertices, mesh.indices))
+        {
+            printf("cannot read %s.off\n", mesh.name);
+            return 1;
+        }
+        unsigned int numFaces = unsigned(mesh.indices.size() / 3);
+
+        QElapsedTimer timer;
+        timer.start();
+        mesh.bvh.build(mesh.vertices.data(), mesh.indices.data(), numFaces, 1);
+        double serialMs = timer.nsecsElapsed() / 1.0e6;
+
+        timer.restart();
+        mesh.bvh.build(mesh.vertices.data(), mesh.indices.data(), numFaces, numThreads);
+        double parallelMs = timer.nsecsElapsed() / 1.0e6;
+
+        printf("%-10s %10u %8d %12.2f %12.2f\n", mesh.name, numFaces, int(mesh.bvh.nodes.size()),
+               serialMs, parallelMs);
+    }
+
+    // Same placements as the game: the car on its lane, obstacles scattered
+    // around it so roughly half of the queries end up near a hit
+    const int QUERIES = 200000;
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> offsetX(-1.2f, 1.2f);
+    std::uniform_real_distribution<float> offsetY(-1.2f, 1.2f);
+
+    Matrix4 car = Model::transform(0.0f, -2.5f, 0.23f, 0.2f, QVector3D(0, 0, 0));
+    struct { int mesh; float z; float scale; float oldRadius; } obstacles[] = {
+        {1, 0.45f, 0.1f, 0.4f},
+        {2, 0.4f, 0.2f, 0.3f},
+    };
+
+    printf("\n%-10s %12s %8s %16s\n", "vs car", "queries/s", "hits", "old check agrees");
+    for (const auto &obstacle : obstacles)
+    {
+        std::vector<Matrix4> placements(QUERIES);
+        std::vector<QVector2D> positions(QUERIES);
+        for (int q = 0; q < QUERIES; ++q)
+        {
+            positions[q] = QVector2D(offsetX(random), -2.5f + offsetY(random));
+            placements[q] = Model::transform(positions[q].x(), positions[q].y(), obstacle.z, obstacle.scale, QVector3D(0, 0, 0));
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        int hits = 0, agrees = 0;
+        for (int q = 0; q < QUERIES; ++q)
+        {
+            bool hit = MeshBvh::overlaps(meshes[0].bvh, car, meshes[obstacle.mesh].bvh, placements[q]);
+            hits += hit;
+            bool oldHit = QVector2D(positions[q] - QVector2D(0.0f, -2.5f)).length() < obstacle.oldRadius;
+            agrees += hit == oldHit;
+        }
+        double seconds = timer.nsecsElapsed() / 1.0e9;
+
+        printf("%-10s %12.0f %7.1f%% %15.1f%%\n", meshes[obstacle.mesh].name, QUERIES / seconds,
+               100.0 * hits / QUERIES, 100.0 * agrees / QUERIES);
+    }
+    return 0;
+}
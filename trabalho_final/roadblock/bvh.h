@@ -0,0 +1,66 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <QVector4D>
+
+#include <atomic>
+#include <vector>
+
+#include "matrix4.h"
+
+// Interior nodes keep their two children next to each other at first and
+// first + 1; leaves have count > 0 triangles starting at first.
+struct BvhNode
+{
+    float min[3];
+    float max[3];
+    int first;
+    int count;
+};
+
+// Bounding volume hierarchy over the triangles of one mesh, in model space.
+// Splits are chosen with the surface area heuristic over BINS centroid bins,
+// and large subtrees are built on their own threads.
+class MeshBvh
+{
+public:
+    static const int BINS = 16;
+    static const int MAX_LEAF = 4;       // Always a leaf at or below this many triangles
+    static const int MAX_SAH_LEAF = 16;  // Leaf when no split beats it by SAH
+    static const int PARALLEL_MIN = 4096; // Smallest subtree handed to another thread
+
+    std::vector<BvhNode> nodes;
+    std::vector<float> triangles; // Nine floats per triangle, in leaf order
+
+    bool isEmpty() const { return nodes.empty(); }
+    int numTriangles() const { return int(triangles.size() / 9); }
+
+    void build(const QVector4D *vertices, const unsigned int *indices, unsigned int numFaces, int numThreads = 0);
+
+    // Whether any triangle of a, placed by transformA, touches any triangle
+    // of b placed by transformB. b is brought into a's model space and both
+    // trees are descended together, so only close leaf pairs are tested.
+    static bool overlaps(const MeshBvh &a, const Matrix4 &transformA,
+                         const MeshBvh &b, const Matrix4 &transformB);
+
+private:
+    struct Reference
+    {
+        float min[3];
+        float max[3];
+        float centroid[3];
+        unsigned int triangle;
+    };
+
+    std::vector<Reference> references;
+    std::atomic<int> usedNodes;
+
+    void buildNode(int node, int first, int count, int numThreads);
+    void makeLeaf(BvhNode &node, int first, int count);
+};
+
+// roadblock3D --bvh-benchmark: build times and overlap queries per second
+// for the car against the barrier and gas tank meshes
+int runBvhBenchmark();
+
+#endif // BVH_H
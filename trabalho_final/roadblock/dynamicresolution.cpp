@@ -0,0 +1,200 @@
+#include "dynamicresolution.h"
+
+#include <cmath>
+
+#include "profiler.h"
+
+constexpr float DynamicResolution::MIN_SCALE;
+constexpr float DynamicResolution::MAX_SCALE;
+constexpr float DynamicResolution::SCALE_STEP;
+constexpr float DynamicResolution::TARGET_MS;
+constexpr float DynamicResolution::UPPER_BAND;
+constexpr float DynamicResolution::LOWER_BAND;
+constexpr float DynamicResolution::SMOOTHING;
+
+DynamicResolution::DynamicResolution(QOpenGLWidget *_glWidget, std::shared_ptr<ShaderLibrary> _shaderLibrary)
+{
+    glWidget = _glWidget;
+    shaderLibrary = _shaderLibrary;
+    makeGLCurrent(glWidget);
+
+    initializeOpenGLFunctions();
+
+    shaderProgram = shaderLibrary->program(":/shaders/vupscale.glsl", ":/shaders/fupscale.glsl", QStringList());
+    GL_CHECK(glGenVertexArrays(1, &vao));
+    GL_CHECK(glGenQueries(NUM_QUERIES, queries));
+}
+
+DynamicResolution::~DynamicResolution()
+{
+    makeGLCurrent(glWidget);
+    destroyBuffers();
+    GL_CHECK(glDeleteQueries(NUM_QUERIES, queries));
+    GL_CHECK(glDeleteVertexArrays(1, &vao));
+}
+
+void DynamicResolution::createBuffers()
+{
+    destroyBuffers();
+
+    GL_CHECK(glGenTextures(1, &colorTexture));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, colorTexture));
+    GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+
+    GL_CHECK(glGenRenderbuffers(1, &depthBuffer));
+    GL_CHECK(glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer));
+    GL_CHECK(glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height));
+    GL_CHECK(glBindRenderbuffer(GL_RENDERBUFFER, 0));
+
+    GLint previous = 0;
+    GL_CHECK(glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous));
+    GL_CHECK(glGenFramebuffers(1, &fbo));
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, fbo));
+    GL_CHECK(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0));
+    GL_CHECK(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer));
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        qDebug("DynamicResolution: offscreen framebuffer incomplete");
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, previous));
+
+    ResourceTracker::set("DynamicResolution", "colorTexture", ResourceTracker::Texture, qint64(width) * height * 4);
+    ResourceTracker::set("DynamicResolution", "depthBuffer", ResourceTracker::Renderbuffer, qint64(width) * height * 4);
+}
+
+void DynamicResolution::destroyBuffers()
+{
+    GL_CHECK(glDeleteFramebuffers(1, &fbo));
+    GL_CHECK(glDeleteTextures(1, &colorTexture));
+    GL_CHECK(glDeleteRenderbuffers(1, &depthBuffer));
+    fbo = 0;
+    colorTexture = 0;
+    depthBuffer = 0;
+    ResourceTracker::releaseOwner("DynamicResolution");
+}
+
+void DynamicResolution::resize(int _width, int _height)
+{
+    width = std::max(_width, 1);
+    height = std::max(_height, 1);
+
+    makeGLCurrent(glWidget);
+    createBuffers();
+}
+
+void DynamicResolution::setEnabled(bool _enabled)
+{
+    enabled = _enabled;
+    if (!enabled)
+        scale = MAX_SCALE;
+    framesSinceChange = 0;
+    qDebug("DynamicResolution: %s", enabled ? "on" : "off");
+}
+
+void DynamicResolution::begin()
+{
+    PROFILE_ZONE("DynamicResolution::begin");
+
+    sceneWidth = std::max(static_cast<int>(width * scale + 0.5f), 1);
+    sceneHeight = std::max(static_cast<int>(height * scale + 0.5f), 1);
+    offscreen = scale < MAX_SCALE && fbo;
+
+    if (offscreen)
+    {
+        // The widget's framebuffer, or a render thread frame
+        GL_CHECK(glGetIntegerv(GL_FRAMEBUFFER_BINDING, &targetFbo));
+        GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, fbo));
+        GL_CHECK(glViewport(0, 0, sceneWidth, sceneHeight));
+        GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+    }
+
+    // A query still in flight in this slot means the GPU is far behind; skip a sample
+    timing = !queryPending[nextQuery];
+    if (timing)
+        GL_CHECK(glBeginQuery(GL_TIME_ELAPSED, queries[nextQuery]));
+}
+
+void DynamicResolution::end()
+{
+    PROFILE_ZONE("DynamicResolution::end");
+
+    if (timing)
+    {
+        GL_CHECK(glEndQuery(GL_TIME_ELAPSED));
+        queryPending[nextQuery] = true;
+        nextQuery = (nextQuery + 1) % NUM_QUERIES;
+    }
+
+    if (offscreen)
+    {
+        GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, targetFbo));
+        GL_CHECK(glViewport(0, 0, width, height));
+
+        GL_CHECK(glDisable(GL_DEPTH_TEST));
+        GL_CHECK(glUseProgram(shaderProgram));
+        GL_CHECK(glUniform1i(glGetUniformLocation(shaderProgram, "sceneTexture"), 0));
+        // Only the corner the scene was drawn into is sampled
+        GL_CHECK(glUniform2f(glGetUniformLocation(shaderProgram, "sceneExtent"),
+                             static_cast<float>(sceneWidth) / width, static_cast<float>(sceneHeight) / height));
+        GL_CHECK(glActiveTexture(GL_TEXTURE0));
+        GL_CHECK(glBindTexture(GL_TEXTURE_2D, colorTexture));
+        GL_CHECK(glBindVertexArray(vao));
+        GL_CHECK(glDrawArrays(GL_TRIANGLES, 0, 3));
+        GL_CHECK(glBindVertexArray(0));
+        GL_CHECK(glEnable(GL_DEPTH_TEST));
+    }
+
+    collectQueries();
+}
+
+void DynamicResolution::collectQueries()
+{
+    // Oldest first, stopping at the first result the GPU has not produced yet
+    for (int i = 0; i < NUM_QUERIES; ++i)
+    {
+        int query = (nextQuery + i) % NUM_QUERIES;
+        if (!queryPending[query])
+            continue;
+
+        GLuint available = 0;
+        GL_CHECK(glGetQueryObjectuiv(queries[query], GL_QUERY_RESULT_AVAILABLE, &available));
+        if (!available)
+            break;
+
+        GLuint nanoseconds = 0;
+        GL_CHECK(glGetQueryObjectuiv(queries[query], GL_QUERY_RESULT, &nanoseconds));
+        queryPending[query] = false;
+        update(nanoseconds / 1.0e6f);
+    }
+}
+
+void DynamicResolution::update(float sampleMs)
+{
+    gpuTimeMs = gpuTimeMs > 0.0f ? gpuTimeMs + (sampleMs - gpuTimeMs) * SMOOTHING : sampleMs;
+
+    if (!enabled || ++framesSinceChange < SETTLE_FRAMES)
+        return;
+
+    float wanted = scale;
+    if (gpuTimeMs > TARGET_MS * UPPER_BAND)
+    {
+        // Shading cost follows the pixel count, the square of the scale
+        wanted = std::floor(scale * std::sqrt(TARGET_MS / gpuTimeMs) / SCALE_STEP) * SCALE_STEP;
+        wanted = std::min(wanted, scale - SCALE_STEP);
+    }
+    else if (gpuTimeMs < TARGET_MS * LOWER_BAND)
+    {
+        wanted = scale + SCALE_STEP;
+    }
+    wanted = std::max(MIN_SCALE, std::min(MAX_SCALE, wanted));
+
+    if (std::fabs(wanted - scale) < SCALE_STEP * 0.5f)
+        return;
+
+    qDebug("DynamicResolution: scene %.1f ms, scale %.2f -> %.2f", gpuTimeMs, scale, wanted);
+    scale = wanted;
+    framesSinceChange = 0;
+}
@@ -0,0 +1,83 @@
+#ifndef DYNAMICRESOLUTION_H
+#define DYNAMICRESOLUTION_H
+
+#include <QtOpenGL>
+#include <QOpenGLWidget>
+#include <QOpenGLExtraFunctions>
+
+#include <memory>
+
+#include "resourcetracker.h"
+#include "shaderlibrary.h"
+#include "util.h"
+
+// Renders the scene at a fraction of the window size when per-pixel shading
+// is what limits the frame rate. The GPU time of the scene is measured with
+// timer queries, read back a few frames later so nothing waits on them, and
+// a controller picks the scale: it drops as soon as the smoothed time is
+// above the target band and climbs back one step at a time once it is well
+// below, waiting SETTLE_FRAMES after each change for the new cost to show.
+//
+// Below full scale the scene goes into an offscreen colour texture and depth
+// buffer, allocated once at window size and used from the corner, and is
+// stretched over the widget framebuffer with linear filtering. At full scale
+// the scene is drawn straight to the widget and keeps its multisampling.
+class DynamicResolution : public QOpenGLExtraFunctions
+{
+public:
+    DynamicResolution(QOpenGLWidget *_glWidget, std::shared_ptr<ShaderLibrary> _shaderLibrary);
+    ~DynamicResolution();
+
+    QOpenGLWidget *glWidget;
+    std::shared_ptr<ShaderLibrary> shaderLibrary;
+
+    static constexpr float MIN_SCALE = 0.5f;
+    static constexpr float MAX_SCALE = 1.0f;
+    static constexpr float SCALE_STEP = 0.05f;  // Scales are multiples of this
+    static constexpr float TARGET_MS = 12.0f;   // Scene GPU time, leaving room in a 60 Hz frame
+    static constexpr float UPPER_BAND = 1.05f;  // Scale down above TARGET_MS * UPPER_BAND
+    static constexpr float LOWER_BAND = 0.75f;  // Scale up below TARGET_MS * LOWER_BAND
+    static constexpr float SMOOTHING = 0.1f;    // Weight of the newest sample
+    static const int SETTLE_FRAMES = 30;
+    static const int NUM_QUERIES = 4;
+
+    bool enabled = true;     // Key R; off renders at full scale
+    float scale = MAX_SCALE; // Of the window width and height
+    float gpuTimeMs = 0;     // Smoothed scene time
+
+    void resize(int width, int height);
+    void setEnabled(bool _enabled);
+
+    // Around the scene draws. begin binds and clears the offscreen target
+    // when it is in use; end stretches it over the widget framebuffer.
+    void begin();
+    void end();
+
+private:
+    GLuint fbo = 0;
+    GLint targetFbo = 0; // Bound when begin was called, where the scene ends up
+    GLuint colorTexture = 0;
+    GLuint depthBuffer = 0;
+    GLuint vao = 0; // Empty, the upscale triangle comes from gl_VertexID
+    GLuint shaderProgram = 0; // Owned by shaderLibrary
+
+    GLuint queries[NUM_QUERIES] = {};
+    bool queryPending[NUM_QUERIES] = {};
+    int nextQuery = 0;
+    bool timing = false;
+
+    int width = 1;
+    int height = 1;
+    int sceneWidth = 1;
+    int sceneHeight = 1;
+    bool offscreen = false;
+    int framesSinceChange = 0;
+
+    void createBuffers();
+    void destroyBuffers();
+
+    void collectQueries();
+    void update(float sampleMs);
+};
+
+#endif // DYNAMICRESOLUTION_H
@@ -0,0 +1,43 @@
+#version 430
+
+in vec3 fN;
+in vec3 fE;
+in vec3 fL;
+flat in uint fMaterial;
+
+struct Material
+{
+    vec4 ambientProduct;
+    vec4 diffuseProduct;
+    vec4 specularProduct;
+    vec4 color;
+    float shininess;
+};
+
+layout (std430, binding = 1) readonly buffer Materials
+{
+    Material materials[];
+};
+
+out vec4 frag_color;
+
+vec4 Phong(vec3 n, Material material)
+{
+    vec3 N = normalize(n);
+    vec3 E = normalize(fE);
+    vec3 L = normalize(fL);
+    float NdotL = dot(N, L);
+    vec3 R = normalize(2.0 * NdotL * N - L);
+    float Kd = max(NdotL, 0.0);
+    float Ks = (NdotL < 0.0) ? 0.0 : pow(max(dot(R, E), 0.0), material.shininess);
+    vec4 diffuse = Kd * material.diffuseProduct;
+    vec4 specular = Ks * material.specularProduct;
+    vec4 ambient = material.ambientProduct;
+    return ambient + diffuse + specular;
+}
+
+void main()
+{
+    Material material = materials[fMaterial];
+    frag_color = Phong(fN, material) * material.color;
+}
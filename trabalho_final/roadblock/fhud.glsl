@@ -0,0 +1,16 @@
+#version 400
+
+in vec2 fTexCoord;
+
+uniform sampler2D glyphTexture;
+uniform vec4 textColor;
+
+out vec4 frag_color;
+
+void main()
+{
+    float coverage = texture(glyphTexture, fTexCoord).r;
+    if (coverage == 0.0)
+        discard;
+    frag_color = vec4(textColor.rgb, textColor.a * coverage);
+}
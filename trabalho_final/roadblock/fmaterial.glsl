@@ -0,0 +1,63 @@
+#version 400
+
+// Variants: TEXTURED modulates the diffuse term by colorTexture, SPECULAR
+// adds the Phong highlight. Without either the surface is a lit flat colour.
+// FLAT_NORMALS ignores fN and lights each face with the normal of its plane,
+// for meshes streamed in without per vertex normals. VERTEX_COLORS tints
+// baseColor with the colours read from the OFF file.
+
+in vec3 fN;
+in vec3 fE;
+in vec3 fL;
+#ifdef TEXTURED
+in vec2 ftexCoord;
+#endif
+#ifdef VERTEX_COLORS
+in vec4 fColor;
+#endif
+
+uniform vec4 ambientProduct;
+uniform vec4 diffuseProduct;
+uniform vec4 specularProduct;
+uniform float shininess;
+uniform vec4 baseColor;
+#ifdef TEXTURED
+uniform sampler2D colorTexture;
+#endif
+
+out vec4 frag_color;
+
+vec4 Phong(vec3 n)
+{
+    vec3 N = normalize(n);
+    vec3 L = normalize(fL);
+    float NdotL = dot(N, L);
+    float Kd = max(NdotL, 0.0);
+    vec4 diffuse = Kd * diffuseProduct;
+#ifdef TEXTURED
+    diffuse *= texture(colorTexture, ftexCoord);
+#endif
+    vec4 ambient = ambientProduct;
+    vec4 color = ambient + diffuse;
+#ifdef SPECULAR
+    vec3 E = normalize(fE);
+    vec3 R = normalize(2.0 * NdotL * N - L);
+    float Ks = (NdotL < 0.0) ? 0.0 : pow(max(dot(R, E), 0.0), shininess);
+    color += Ks * specularProduct;
+#endif
+    return color;
+}
+
+void main()
+{
+#ifdef FLAT_NORMALS
+    // Points have no slope; they face the eye
+    vec3 n = cross(dFdx(fE), dFdy(fE));
+    frag_color = Phong(dot(n, n) > 0.0 ? n : fE) * baseColor;
+#else
+    frag_color = Phong(fN) * baseColor;
+#endif
+#ifdef VERTEX_COLORS
+    frag_color *= fColor;
+#endif
+}
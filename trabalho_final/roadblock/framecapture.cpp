@@ -0,0 +1,286 @@
+#include "framecapture.h"
+
+#include <string.h>
+
+#include "profiler.h"
+
+FrameCapture::FrameCapture(QOpenGLWidget *_glWidget)
+{
+    glWidget = _glWidget;
+    makeGLCurrent(glWidget);
+
+    initializeOpenGLFunctions();
+}
+
+FrameCapture::~FrameCapture()
+{
+    stop();
+}
+
+void FrameCapture::createBuffers()
+{
+    destroyBuffers();
+
+    // Single sampled target the multisampled frame is resolved into
+    GL_CHECK(glGenRenderbuffers(1, &colorBuffer));
+    GL_CHECK(glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer));
+    GL_CHECK(glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height));
+    GL_CHECK(glBindRenderbuffer(GL_RENDERBUFFER, 0));
+
+    GLint previous = 0;
+    GL_CHECK(glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous));
+    GL_CHECK(glGenFramebuffers(1, &fbo));
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, fbo));
+    GL_CHECK(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer));
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, previous));
+
+    for (Slot &slot : slots)
+    {
+        GL_CHECK(glGenBuffers(1, &slot.pbo));
+        GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo));
+        GL_CHECK(glBufferData(GL_PIXEL_PACK_BUFFER, width * height * 4, nullptr, GL_STREAM_READ));
+        slot.fence = 0;
+        slot.frame = -1;
+    }
+    GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+    nextSlot = 0;
+
+    ResourceTracker::set("FrameCapture", "resolveBuffer", ResourceTracker::Renderbuffer, qint64(width) * height * 4);
+    ResourceTracker::set("FrameCapture", "pboRing", ResourceTracker::Buffer, qint64(NUM_PBOS) * width * height * 4);
+}
+
+void FrameCapture::destroyBuffers()
+{
+    for (Slot &slot : slots)
+    {
+        if (slot.fence)
+            glDeleteSync(slot.fence);
+        GL_CHECK(glDeleteBuffers(1, &slot.pbo));
+        slot.pbo = 0;
+        slot.fence = 0;
+        slot.frame = -1;
+    }
+
+    GL_CHECK(glDeleteFramebuffers(1, &fbo));
+    GL_CHECK(glDeleteRenderbuffers(1, &colorBuffer));
+    fbo = 0;
+    colorBuffer = 0;
+    ResourceTracker::releaseOwner("FrameCapture");
+}
+
+bool FrameCapture::start(const QString &_fileName, Format _format, int _width, int _height)
+{
+    stop();
+
+    fileName = _fileName;
+    format = _format;
+    width = _width;
+    height = _height;
+
+    if (format == Png && !QDir().mkpath(fileName))
+    {
+        qDebug("FrameCapture: cannot create %s", qPrintable(fileName));
+        return false;
+    }
+
+    makeGLCurrent(glWidget);
+    createBuffers();
+
+    framesIssued = 0;
+    framesDropped = 0;
+    captureNsecs = 0;
+    framesWritten = 0;
+    stopping = false;
+    queue.clear();
+    encoder = std::thread(&FrameCapture::encodeFrames, this);
+
+    recording = true;
+    qDebug("FrameCapture: recording %dx%d to %s", width, height, qPrintable(fileName));
+    return true;
+}
+
+void FrameCapture::stop()
+{
+    if (!recording)
+        return;
+    recording = false;
+
+    // The last reads are still in flight; waiting for them once is fine here
+    makeGLCurrent(glWidget);
+    for (int i = 0; i < NUM_PBOS; ++i)
+        retireSlot(slots[(nextSlot + i) % NUM_PBOS], true);
+    destroyBuffers();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    framesReady.notify_all();
+    encoder.join();
+
+    qDebug("FrameCapture: %d frames written, %d dropped, %.1f us capture overhead per frame",
+           framesWritten, framesDropped, framesIssued ? captureNsecs / 1.0e3 / framesIssued : 0.0);
+}
+
+void FrameCapture::retireSlot(Slot &slot, bool wait)
+{
+    if (!slot.fence)
+        return;
+
+    if (glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                         wait ? GL_TIMEOUT_IGNORED : 0) == GL_TIMEOUT_EXPIRED)
+        return;
+    glDeleteSync(slot.fence);
+    slot.fence = 0;
+
+    Frame frame;
+    frame.number = slot.frame;
+    slot.frame = -1;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (int(queue.size()) >= MAX_QUEUED)
+        {
+            framesDropped++; // The encoder fell behind
+            return;
+        }
+    }
+
+    const size_t size = size_t(width) * height * 4;
+    frame.pixels = std::make_unique<unsigned char[]>(size);
+
+    GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo));
+    void *data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    if (data)
+    {
+        memcpy(frame.pixels.get(), data, size);
+        GL_CHECK(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+    }
+    GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+    if (!data)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(std::move(frame));
+    }
+    framesReady.notify_one();
+}
+
+void FrameCapture::captureFrame()
+{
+    if (!recording)
+        return;
+
+    PROFILE_ZONE("FrameCapture::captureFrame");
+    QElapsedTimer timer;
+    timer.start();
+
+    // Hand over every read that has completed, oldest first
+    for (int i = 0; i < NUM_PBOS; ++i)
+        retireSlot(slots[(nextSlot + i) % NUM_PBOS], false);
+
+    Slot &slot = slots[nextSlot];
+    if (slot.fence)
+    {
+        // The GPU is more than NUM_PBOS frames behind: skip instead of waiting
+        framesDropped++;
+        captureNsecs += timer.nsecsElapsed();
+        return;
+    }
+
+    // The widget's framebuffer, or the render thread's frame
+    GLint widgetFbo = 0;
+    GL_CHECK(glGetIntegerv(GL_FRAMEBUFFER_BINDING, &widgetFbo));
+    GL_CHECK(glBindFramebuffer(GL_READ_FRAMEBUFFER, widgetFbo));
+    GL_CHECK(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo));
+    GL_CHECK(glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST));
+
+    GL_CHECK(glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo));
+    GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo));
+    GL_CHECK(glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+    GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, widgetFbo));
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frame = framesIssued++;
+    nextSlot = (nextSlot + 1) % NUM_PBOS;
+
+    captureNsecs += timer.nsecsElapsed();
+    if (framesIssued % 300 == 0)
+        qDebug("FrameCapture: %d frames, %d dropped, %.1f us per frame",
+               framesIssued, framesDropped, captureNsecs / 1.0e3 / framesIssued);
+}
+
+void FrameCapture::encodeFrames()
+{
+    PROFILE_THREAD("FrameCapture");
+
+    QFile file(fileName);
+    std::unique_ptr<unsigned char[]> planes;
+    if (format == Y4m)
+    {
+        if (!file.open(QFile::WriteOnly | QFile::Truncate))
+            qDebug("FrameCapture: cannot write %s", qPrintable(fileName));
+        else
+            file.write(QString("YUV4MPEG2 W%1 H%2 F%3:1 Ip A1:1 C444\n").arg(width).arg(height).arg(FPS).toLatin1());
+        planes = std::make_unique<unsigned char[]>(size_t(width) * height * 3);
+    }
+
+    for (;;)
+    {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            framesReady.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty())
+                return; // Stopping and drained
+            frame = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        PROFILE_ZONE("FrameCapture::encode");
+        if (format == Y4m)
+        {
+            if (file.isOpen())
+                writeY4mFrame(file, frame, planes);
+        }
+        else
+        {
+            writePngFrame(frame);
+        }
+        framesWritten++;
+    }
+}
+
+void FrameCapture::writeY4mFrame(QFile &file, const Frame &frame, std::unique_ptr<unsigned char[]> &planes)
+{
+    // BT.601 studio range, rows flipped from GL's bottom-up order
+    const size_t planeSize = size_t(width) * height;
+    unsigned char *y = planes.get();
+    unsigned char *u = y + planeSize;
+    unsigned char *v = u + planeSize;
+
+    for (int row = 0; row < height; ++row)
+    {
+        const unsigned char *rgba = frame.pixels.get() + size_t(height - 1 - row) * width * 4;
+        size_t out = size_t(row) * width;
+        for (int x = 0; x < width; ++x, rgba += 4, ++out)
+        {
+            int r = rgba[0], g = rgba[1], b = rgba[2];
+            y[out] = static_cast<unsigned char>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+            u[out] = static_cast<unsigned char>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            v[out] = static_cast<unsigned char>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+
+    file.write("FRAME\n", 6);
+    file.write(reinterpret_cast<const char *>(planes.get()), planeSize * 3);
+}
+
+void FrameCapture::writePngFrame(const Frame &frame)
+{
+    // The scene leaves alpha at zero, so it is ignored
+    QImage image(frame.pixels.get(), width, height, QImage::Format_RGBX8888);
+    image.mirrored().save(QString("%1/frame_%2.png").arg(fileName).arg(frame.number, 5, 10, QChar('0')));
+}
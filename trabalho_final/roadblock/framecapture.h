@@ -0,0 +1,94 @@
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <QtOpenGL>
+#include <QOpenGLWidget>
+#include <QOpenGLExtraFunctions>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "resourcetracker.h"
+#include "util.h"
+
+// Gameplay recorder that never waits on the GPU. Each captured frame is
+// resolved out of the multisampled widget framebuffer and read into the next
+// pixel buffer of a ring; a buffer is only mapped once the fence placed after
+// its read has signalled, a few frames later. Mapped frames go to an encoder
+// thread that writes a Y4M video (4:4:4) or a numbered PNG sequence.
+//
+// When the ring or the encoder queue is full the frame is dropped rather
+// than stalling the game; the counts are logged with the per frame overhead.
+class FrameCapture : public QOpenGLExtraFunctions
+{
+public:
+    FrameCapture(QOpenGLWidget *_glWidget);
+    ~FrameCapture();
+
+    QOpenGLWidget *glWidget;
+
+    enum Format { Y4m, Png };
+
+    static const int NUM_PBOS = 4;
+    static const int MAX_QUEUED = 8; // Frames waiting for the encoder
+    static const int FPS = 60;       // Frame rate written to the Y4M header
+
+    bool isRecording() const { return recording; }
+
+    // fileName is the .y4m file, or the directory receiving frame_NNNNN.png
+    bool start(const QString &fileName, Format _format, int _width, int _height);
+    void stop();
+
+    // Called at the end of the frame while its framebuffer is bound
+    void captureFrame();
+
+private:
+    struct Slot
+    {
+        GLuint pbo = 0;
+        GLsync fence = 0;
+        int frame = -1;
+    };
+
+    struct Frame
+    {
+        int number;
+        std::unique_ptr<unsigned char[]> pixels; // RGBA, bottom row first
+    };
+
+    Slot slots[NUM_PBOS];
+    int nextSlot = 0;
+
+    GLuint fbo = 0;
+    GLuint colorBuffer = 0;
+
+    bool recording = false;
+    Format format = Y4m;
+    QString fileName;
+    int width = 0;
+    int height = 0;
+
+    int framesIssued = 0;
+    int framesDropped = 0;
+    qint64 captureNsecs = 0; // Spent inside captureFrame on the GUI thread
+
+    std::thread encoder;
+    std::mutex mutex;
+    std::condition_variable framesReady;
+    std::deque<Frame> queue;
+    bool stopping = false;
+    int framesWritten = 0;
+
+    void createBuffers();
+    void destroyBuffers();
+
+    void retireSlot(Slot &slot, bool wait);
+    void encodeFrames();
+    void writeY4mFrame(QFile &file, const Frame &frame, std::unique_ptr<unsigned char[]> &planes);
+    void writePngFrame(const Frame &frame);
+};
+
+#endif // FRAMECAPTURE_H
@@ -0,0 +1,15 @@
+#version 400
+
+in vec2 fTexCoord;
+
+uniform sampler2D sceneTexture;
+uniform vec2 sceneExtent;
+
+out vec4 frag_color;
+
+void main()
+{
+    // Stay half a texel inside the scene so filtering never reads past it
+    vec2 limit = sceneExtent - 0.5 / vec2(textureSize(sceneTexture, 0));
+    frag_color = texture(sceneTexture, min(fTexCoord, limit));
+}
@@ -0,0 +1,91 @@
+#include "grassfield.h"
+
+#include <cmath>
+
+#include "profiler.h"
+
+constexpr float GrassField::CELL_SIZE;
+constexpr float GrassField::BEHIND;
+constexpr float GrassField::DEFAULT_HALF_WIDTH;
+
+GrassField::GrassField(QOpenGLWidget *_glWidget, std::shared_ptr<ShaderLibrary> _shaderLibrary)
+{
+    glWidget = _glWidget;
+    shaderLibrary = _shaderLibrary;
+    makeGLCurrent(glWidget);
+
+    initializeOpenGLFunctions();
+
+    shaderProgram = shaderLibrary->program(":/shaders/vgrass.glsl", ":/shaders/fgrass.glsl", QStringList());
+    GL_CHECK(glGenVertexArrays(1, &vao));
+
+    // Locations are looked up once instead of every frame
+    locView = glGetUniformLocation(shaderProgram, "view");
+    locProjection = glGetUniformLocation(shaderProgram, "projection");
+    locLightPosition = glGetUniformLocation(shaderProgram, "lightPosition");
+    locAmbientProduct = glGetUniformLocation(shaderProgram, "ambientProduct");
+    locDiffuseProduct = glGetUniformLocation(shaderProgram, "diffuseProduct");
+    locEye = glGetUniformLocation(shaderProgram, "eye");
+    locFirstRow = glGetUniformLocation(shaderProgram, "firstRow");
+    locTravelled = glGetUniformLocation(shaderProgram, "travelled");
+    locCellSize = glGetUniformLocation(shaderProgram, "cellSize");
+    locRoad = glGetUniformLocation(shaderProgram, "road");
+    locRoadStart = glGetUniformLocation(shaderProgram, "roadStart");
+    locRoadStep = glGetUniformLocation(shaderProgram, "roadStep");
+    locTime = glGetUniformLocation(shaderProgram, "time");
+
+    clock.start();
+    qDebug("GrassField: up to %u blades, no vertex buffers", numBlades());
+}
+
+GrassField::~GrassField()
+{
+    makeGLCurrent(glWidget);
+    GL_CHECK(glDeleteVertexArrays(1, &vao));
+}
+
+void GrassField::draw(const Camera &camera, const Light &light, RoadStream *roadStream, float travelled)
+{
+    if (!shaderProgram)
+        return;
+
+    PROFILE_ZONE("GrassField::draw");
+
+    // Road edges over the covered stretch, y measured from the player like the models
+    const float roadStart = -BEHIND - CELL_SIZE;
+    const float roadStep = (ROWS + 1) * CELL_SIZE / (ROAD_SAMPLES - 1);
+    for (int i = 0; i < ROAD_SAMPLES; ++i)
+    {
+        float centre = 0.0f, halfWidth = DEFAULT_HALF_WIDTH;
+        if (roadStream)
+            roadStream->roadAt(travelled + roadStart + i * roadStep, centre, halfWidth);
+        roadSamples[i * 2] = centre;
+        roadSamples[i * 2 + 1] = halfWidth;
+    }
+
+    // Rows are whole cells of road distance, so blades scroll with the road instead of sliding over it
+    int firstRow = static_cast<int>(std::floor((travelled - BEHIND) / CELL_SIZE));
+
+    QVector4D ambientProduct = light.ambient * material.ambient;
+    QVector4D diffuseProduct = light.diffuse * material.diffuse;
+
+    GL_CHECK(glUseProgram(shaderProgram));
+    GL_CHECK(glUniformMatrix4fv(locView, 1, GL_FALSE, camera.viewMatrix.constData()));
+    GL_CHECK(glUniformMatrix4fv(locProjection, 1, GL_FALSE, camera.projectionMatrix.constData()));
+    GL_CHECK(glUniform4f(locLightPosition, light.position.x(), light.position.y(), light.position.z(), light.position.w()));
+    GL_CHECK(glUniform4fv(locAmbientProduct, 1, &ambientProduct[0]));
+    GL_CHECK(glUniform4fv(locDiffuseProduct, 1, &diffuseProduct[0]));
+    GL_CHECK(glUniform3f(locEye, camera.eye.x(), camera.eye.y(), camera.eye.z()));
+    GL_CHECK(glUniform1i(locFirstRow, firstRow));
+    GL_CHECK(glUniform1f(locTravelled, travelled));
+    GL_CHECK(glUniform1f(locCellSize, CELL_SIZE));
+    GL_CHECK(glUniform2fv(locRoad, ROAD_SAMPLES, roadSamples));
+    GL_CHECK(glUniform1f(locRoadStart, roadStart));
+    GL_CHECK(glUniform1f(locRoadStep, roadStep));
+    GL_CHECK(glUniform1f(locTime, clock.elapsed() / 1000.0f));
+
+    GL_CHECK(glBindVertexArray(vao));
+    GL_CHECK(glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 2 * BLADE_SEGMENTS + 1, numBlades()));
+    drawCalls++;
+    GL_CHECK(glBindVertexArray(0));
+}
@@ -0,0 +1,76 @@
+#ifndef GRASSFIELD_H
+#define GRASSFIELD_H
+
+#include <QtOpenGL>
+#include <QOpenGLWidget>
+#include <QOpenGLExtraFunctions>
+
+#include <memory>
+
+#include "camera.h"
+#include "light.h"
+#include "material.h"
+#include "roadstream.h"
+#include "shaderlibrary.h"
+#include "util.h"
+
+// Roadside grass generated in the vertex shader, one instanced draw for both
+// verges. Each instance is a cell of a grid anchored to road distance, and a
+// hash of the cell's world position picks its blade's jitter, height, width,
+// facing, lean, tint and wind phase. A patch therefore looks the same every
+// time it scrolls past, with no per-blade data on either side. Cells thin out
+// with distance from the eye and from the road edge. Blades sway under a
+// gust wave plus their own flutter.
+//
+// The only per frame input is a table of road centre and half width samples
+// over the covered stretch, so the verges follow the streamed road's curves.
+class GrassField : public QOpenGLExtraFunctions
+{
+public:
+    GrassField(QOpenGLWidget *_glWidget, std::shared_ptr<ShaderLibrary> _shaderLibrary);
+    ~GrassField();
+
+    QOpenGLWidget *glWidget;
+    std::shared_ptr<ShaderLibrary> shaderLibrary;
+
+    // Must match vgrass.glsl
+    static const int BLADE_SEGMENTS = 4; // A strip of 2 * BLADE_SEGMENTS + 1 vertices
+    static const int COLUMNS = 32;       // Cells out from each road edge
+    static const int ROAD_SAMPLES = 64;
+
+    static const int ROWS = 240;              // Cells along the road
+    static constexpr float CELL_SIZE = 0.08f;
+    static constexpr float BEHIND = 4.0f;     // Covered distance behind the player's row
+    static constexpr float DEFAULT_HALF_WIDTH = 2.7f; // Where no road chunk is live
+
+    Material material;
+
+    GLuint vao = 0; // Empty, blades come from gl_VertexID and gl_InstanceID
+    GLuint shaderProgram = 0; // Owned by shaderLibrary
+
+    unsigned int drawCalls = 0;
+
+    unsigned int numBlades() const { return 2 * ROWS * COLUMNS; }
+
+    void draw(const Camera &camera, const Light &light, RoadStream *roadStream, float travelled);
+
+private:
+    GLint locView = -1;
+    GLint locProjection = -1;
+    GLint locLightPosition = -1;
+    GLint locAmbientProduct = -1;
+    GLint locDiffuseProduct = -1;
+    GLint locEye = -1;
+    GLint locFirstRow = -1;
+    GLint locTravelled = -1;
+    GLint locCellSize = -1;
+    GLint locRoad = -1;
+    GLint locRoadStart = -1;
+    GLint locRoadStep = -1;
+    GLint locTime = -1;
+
+    float roadSamples[ROAD_SAMPLES * 2];
+    QElapsedTimer clock; // Drives the wind
+};
+
+#endif // GRASSFIELD_H
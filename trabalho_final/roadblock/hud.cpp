@@ -0,0 +1,302 @@
+#include "hud.h"
+
+#include <stdio.h>
+#include <string.h>
+
+Hud::Hud(QOpenGLWidget *_glWidget, std::shared_ptr<ShaderLibrary> _shaderLibrary)
+{
+    glWidget = _glWidget;
+    shaderLibrary = _shaderLibrary;
+    makeGLCurrent(glWidget);
+
+    initializeOpenGLFunctions();
+
+    quads = std::make_unique<QVector4D[]>(MAX_GLYPHS * 6);
+    ResourceTracker::set("Hud", "quads", ResourceTracker::CpuArray, MAX_GLYPHS * 6 * sizeof(QVector4D));
+
+    createAtlas();
+    shaderProgram = shaderLibrary->program(":/shaders/vhud.glsl", ":/shaders/fhud.glsl", QStringList());
+    // Locations are looked up once instead of every frame
+    locViewportSize = glGetUniformLocation(shaderProgram, "viewportSize");
+    locGlyphTexture = glGetUniformLocation(shaderProgram, "glyphTexture");
+    locTextColor = glGetUniformLocation(shaderProgram, "textColor");
+
+    createVBOs();
+}
+
+Hud::~Hud()
+{
+    destroyVBOs();
+
+    GL_CHECK(glDeleteTextures(1, &textureID));
+    ResourceTracker::releaseOwner("Hud");
+}
+
+void Hud::createAtlas()
+{
+    QFont font = QFontDatabase::systemFont(QFontDatabase::FixedFont);
+    font.setPointSize(14);
+    font.setBold(true);
+    QFontMetrics metrics(font);
+
+    cellWidth = metrics.maxWidth() + 2;
+    cellHeight = metrics.height() + 2;
+    atlasWidth = ATLAS_COLUMNS * cellWidth;
+    atlasHeight = ((NUM_GLYPHS + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS) * cellHeight;
+
+    // Glyphs are painted white over transparent, only coverage is kept
+    QImage image(atlasWidth, atlasHeight, QImage::Format_ARGB32);
+    image.fill(Qt::transparent);
+
+    QPainter painter(&image);
+    painter.setFont(font);
+    painter.setPen(Qt::white);
+    for (int i = 0; i < NUM_GLYPHS; ++i)
+    {
+        int x = (i % ATLAS_COLUMNS) * cellWidth + 1;
+        int y = (i / ATLAS_COLUMNS) * cellHeight + 1;
+        painter.drawText(x, y + metrics.ascent(), QString(QChar(FIRST_GLYPH + i)));
+    }
+    painter.end();
+
+    std::unique_ptr<unsigned char[]> coverage = std::make_unique<unsigned char[]>(atlasWidth * atlasHeight);
+    for (int y = 0; y < atlasHeight; ++y)
+    {
+        const QRgb *row = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+        for (int x = 0; x < atlasWidth; ++x)
+            coverage[y * atlasWidth + x] = qAlpha(row[x]);
+    }
+
+    if (textureID)
+    {
+        GL_CHECK(glDeleteTextures(1, &textureID));
+    }
+
+    GL_CHECK(glGenTextures(1, &textureID));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, textureID));
+    GL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+    GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, atlasWidth, atlasHeight, 0, GL_RED, GL_UNSIGNED_BYTE, coverage.get()));
+    GL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+    ResourceTracker::set("Hud", "glyphAtlas", ResourceTracker::Texture, atlasWidth * atlasHeight);
+
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+}
+
+void Hud::createVBOs()
+{
+    destroyVBOs();
+
+    GL_CHECK(glGenVertexArrays(1, &vao));
+    GL_CHECK(glBindVertexArray(vao));
+
+    GL_CHECK(glGenBuffers(1, &vboQuads));
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vboQuads));
+    GL_CHECK(glBufferData(GL_ARRAY_BUFFER, MAX_GLYPHS * 6 * sizeof(QVector4D), nullptr, GL_DYNAMIC_DRAW));
+    ResourceTracker::set("Hud", "vboQuads", ResourceTracker::Buffer, MAX_GLYPHS * 6 * sizeof(QVector4D));
+    GL_CHECK(glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, nullptr));
+    GL_CHECK(glEnableVertexAttribArray(0));
+
+    GL_CHECK(glBindVertexArray(0));
+}
+
+void Hud::destroyVBOs()
+{
+    GL_CHECK(glDeleteBuffers(1, &vboQuads));
+    GL_CHECK(glDeleteVertexArrays(1, &vao));
+
+    vboQuads = 0;
+    vao = 0;
+}
+
+void Hud::resize(int width, int height)
+{
+    viewportWidth = std::max(width, 1);
+    viewportHeight = std::max(height, 1);
+    dirty = true;
+}
+
+void Hud::setScore(int _distance, int _fuel, int _lose)
+{
+    if (_distance == distance && _fuel == fuel && _lose == lose)
+        return;
+
+    distance = _distance;
+    fuel = _fuel;
+    lose = _lose;
+    dirty = true;
+}
+
+void Hud::setStats(float frameTimeMs, int _drawCalls, float submitTimeMs, bool _batched)
+{
+    int _frameTimeUs = static_cast<int>(frameTimeMs * 1000.0f);
+    int _fps = frameTimeMs > 0.0f ? static_cast<int>(1000.0f / frameTimeMs + 0.5f) : 0;
+    int _submitTimeUs = static_cast<int>(submitTimeMs * 1000.0f);
+
+    if (_frameTimeUs == frameTimeUs && _fps == fps && _drawCalls == drawCalls
+            && _submitTimeUs == submitTimeUs && _batched == batched)
+        return;
+
+    frameTimeUs = _frameTimeUs;
+    fps = _fps;
+    drawCalls = _drawCalls;
+    submitTimeUs = _submitTimeUs;
+    batched = _batched;
+    if (showStats)
+        dirty = true;
+}
+
+void Hud::setMemory(qint64 cpuBytes, qint64 gpuBytes)
+{
+    int _cpuKb = static_cast<int>(cpuBytes / 1024);
+    int _gpuKb = static_cast<int>(gpuBytes / 1024);
+
+    if (_cpuKb == cpuKb && _gpuKb == gpuKb)
+        return;
+
+    cpuKb = _cpuKb;
+    gpuKb = _gpuKb;
+    if (showStats)
+        dirty = true;
+}
+
+void Hud::setResolution(float scale, float sceneTimeMs)
+{
+    int _scalePercent = static_cast<int>(scale * 100.0f + 0.5f);
+    int _sceneTimeUs = static_cast<int>(sceneTimeMs * 1000.0f);
+
+    if (_scalePercent == scalePercent && _sceneTimeUs == sceneTimeUs)
+        return;
+
+    scalePercent = _scalePercent;
+    sceneTimeUs = _sceneTimeUs;
+    if (showStats)
+        dirty = true;
+}
+
+void Hud::setLatency(float p50Ms, float p95Ms, bool _lowLatency)
+{
+    int _latencyP50Us = p50Ms < 0.0f ? -1 : static_cast<int>(p50Ms * 1000.0f);
+    int _latencyP95Us = p95Ms < 0.0f ? -1 : static_cast<int>(p95Ms * 1000.0f);
+
+    if (_latencyP50Us == latencyP50Us && _latencyP95Us == latencyP95Us && _lowLatency == lowLatency)
+        return;
+
+    latencyP50Us = _latencyP50Us;
+    latencyP95Us = _latencyP95Us;
+    lowLatency = _lowLatency;
+    if (showStats)
+        dirty = true;
+}
+
+void Hud::toggleStats()
+{
+    showStats = !showStats;
+    dirty = true;
+}
+
+void Hud::appendText(const char *text, float x, float y)
+{
+    float du = static_cast<float>(cellWidth) / atlasWidth;
+    float dv = static_cast<float>(cellHeight) / atlasHeight;
+
+    for (const char *c = text; *c && numGlyphs < MAX_GLYPHS; ++c, x += cellWidth)
+    {
+        int glyph = *c - FIRST_GLYPH;
+        if (glyph <= 0 || glyph >= NUM_GLYPHS)
+            continue; // Spaces and unknown characters only advance the pen
+
+        float u = (glyph % ATLAS_COLUMNS) * du;
+        float v = (glyph / ATLAS_COLUMNS) * dv;
+        float x1 = x + cellWidth;
+        float y1 = y + cellHeight;
+
+        QVector4D *quad = &quads[numGlyphs * 6];
+        quad[0] = QVector4D(x, y, u, v);
+        quad[1] = QVector4D(x, y1, u, v + dv);
+        quad[2] = QVector4D(x1, y1, u + du, v + dv);
+        quad[3] = QVector4D(x1, y1, u + du, v + dv);
+        quad[4] = QVector4D(x1, y, u + du, v);
+        quad[5] = QVector4D(x, y, u, v);
+        numGlyphs++;
+    }
+}
+
+void Hud::rebuildQuads()
+{
+    char text[128];
+    numGlyphs = 0;
+
+    if (lose)
+    {
+        snprintf(text, sizeof(text), "You Lose! Distance: %d", distance);
+        float x = (viewportWidth - static_cast<float>(strlen(text) * cellWidth)) * 0.5f;
+        appendText(text, x, (viewportHeight - cellHeight) * 0.5f);
+    }
+    else
+    {
+        snprintf(text, sizeof(text), "Distance: %d   Fuel: %d", distance, fuel);
+        appendText(text, cellWidth, cellHeight * 0.5f);
+    }
+
+    if (showStats)
+    {
+        snprintf(text, sizeof(text), "%d fps  %d.%03d ms  %d draws",
+                 fps, frameTimeUs / 1000, frameTimeUs % 1000, drawCalls);
+        appendText(text, cellWidth, viewportHeight - cellHeight * 5.5f);
+        if (latencyP50Us < 0)
+            snprintf(text, sizeof(text), "input -- ms  (L %s)", lowLatency ? "low-latency" : "default");
+        else
+            snprintf(text, sizeof(text), "input %d.%d ms p50  %d.%d ms p95  (L %s)",
+                     latencyP50Us / 1000, latencyP50Us % 1000 / 100, latencyP95Us / 1000, latencyP95Us % 1000 / 100,
+                     lowLatency ? "low-latency" : "default");
+        appendText(text, cellWidth, viewportHeight - cellHeight * 4.5f);
+        snprintf(text, sizeof(text), "res %d%%  scene %d.%03d ms gpu  (R toggles)",
+                 scalePercent, sceneTimeUs / 1000, sceneTimeUs % 1000);
+        appendText(text, cellWidth, viewportHeight - cellHeight * 3.5f);
+        snprintf(text, sizeof(text), "mem %d KB cpu  %d KB gpu  (F3 lists)", cpuKb, gpuKb);
+        appendText(text, cellWidth, viewportHeight - cellHeight * 2.5f);
+        snprintf(text, sizeof(text), "submit %d us  %s", submitTimeUs, batched ? "multi-draw batch" : "per-model");
+        appendText(text, cellWidth, viewportHeight - cellHeight * 1.5f);
+    }
+
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vboQuads));
+    // Orphan the old storage so the upload never waits on the previous draw
+    GL_CHECK(glBufferData(GL_ARRAY_BUFFER, MAX_GLYPHS * 6 * sizeof(QVector4D), nullptr, GL_DYNAMIC_DRAW));
+    GL_CHECK(glBufferSubData(GL_ARRAY_BUFFER, 0, numGlyphs * 6 * sizeof(QVector4D), quads.get()));
+
+    dirty = false;
+}
+
+void Hud::drawHud()
+{
+    if (!shaderProgram)
+        return;
+
+    if (dirty)
+        rebuildQuads();
+
+    if (!numGlyphs)
+        return;
+
+    GL_CHECK(glDisable(GL_DEPTH_TEST));
+    GL_CHECK(glEnable(GL_BLEND));
+    GL_CHECK(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+
+    GL_CHECK(glUseProgram(shaderProgram));
+    GL_CHECK(glUniform2f(locViewportSize, viewportWidth, viewportHeight));
+    GL_CHECK(glUniform4f(locTextColor, 1.0f, 1.0f, 1.0f, 1.0f));
+    GL_CHECK(glUniform1i(locGlyphTexture, 0));
+
+    GL_CHECK(glActiveTexture(GL_TEXTURE0));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, textureID));
+
+    GL_CHECK(glBindVertexArray(vao));
+    GL_CHECK(glDrawArrays(GL_TRIANGLES, 0, numGlyphs * 6));
+    GL_CHECK(glBindVertexArray(0));
+
+    GL_CHECK(glDisable(GL_BLEND));
+    GL_CHECK(glEnable(GL_DEPTH_TEST));
+}
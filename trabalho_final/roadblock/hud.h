@@ -0,0 +1,91 @@
+#ifndef HUD_H
+#define HUD_H
+
+#include <QtOpenGL>
+#include <QOpenGLWidget>
+#include <QOpenGLExtraFunctions>
+
+#include <memory>
+
+#include "resourcetracker.h"
+#include "shaderlibrary.h"
+#include "util.h"
+
+// In-scene text overlay. Glyphs are baked once into an atlas texture and the
+// text is kept as a batch of quads that is only rebuilt when a displayed value
+// changes, so a frame costs a single draw call.
+class Hud : public QOpenGLExtraFunctions
+{
+public:
+    Hud(QOpenGLWidget *_glWidget, std::shared_ptr<ShaderLibrary> _shaderLibrary);
+    ~Hud();
+
+    QOpenGLWidget *glWidget;
+    std::shared_ptr<ShaderLibrary> shaderLibrary;
+
+    static const int FIRST_GLYPH = 32;
+    static const int NUM_GLYPHS = 95;
+    static const int ATLAS_COLUMNS = 16;
+    static const unsigned int MAX_GLYPHS = 256;
+
+    GLuint vao = 0;
+    GLuint vboQuads = 0;
+    GLuint textureID = 0;
+    GLuint shaderProgram = 0; // Owned by shaderLibrary
+
+    GLint locViewportSize = -1;
+    GLint locGlyphTexture = -1;
+    GLint locTextColor = -1;
+
+    int atlasWidth = 0;
+    int atlasHeight = 0;
+    int cellWidth = 0; // Glyph cell size in pixels
+    int cellHeight = 0;
+
+    int viewportWidth = 1;
+    int viewportHeight = 1;
+
+    std::unique_ptr<QVector4D[]> quads; // x, y, u, v per vertex
+    unsigned int numGlyphs = 0;
+    bool dirty = true;
+
+    // Values currently on screen, the quads are rebuilt only when they change
+    int distance = -1;
+    int fuel = -1;
+    int lose = 0;
+
+    bool showStats = false;
+    int fps = 0;
+    int frameTimeUs = 0;
+    int drawCalls = 0;
+    int submitTimeUs = 0; // CPU time spent issuing the scene draws
+    bool batched = false;
+    int cpuKb = 0; // Totals from ResourceTracker
+    int gpuKb = 0;
+    int scalePercent = 100; // From DynamicResolution
+    int sceneTimeUs = 0;
+    int latencyP50Us = -1; // From InputLatency, -1 before the first sample
+    int latencyP95Us = -1;
+    bool lowLatency = false;
+
+    void createAtlas();
+    void createVBOs();
+
+    void destroyVBOs();
+
+    void resize(int width, int height);
+    void setScore(int _distance, int _fuel, int _lose);
+    void setStats(float frameTimeMs, int _drawCalls, float submitTimeMs, bool _batched);
+    void setMemory(qint64 cpuBytes, qint64 gpuBytes);
+    void setResolution(float scale, float sceneTimeMs);
+    void setLatency(float p50Ms, float p95Ms, bool _lowLatency);
+    void toggleStats();
+
+    void drawHud();
+
+private:
+    void rebuildQuads();
+    void appendText(const char *text, float x, float y);
+};
+
+#endif // HUD_H
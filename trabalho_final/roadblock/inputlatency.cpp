@@ -0,0 +1,95 @@
+#include "inputlatency.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    // Samples come from the GUI thread, the HUD reads them from whichever
+    // thread renders
+    std::mutex samplesMutex;
+    std::vector<float> samples; // Milliseconds, a ring once full
+    int nextSample = 0;
+    int sinceReport = 0;
+    const char *label = "default";
+
+    const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+    float percentile(std::vector<float> &sorted, float fraction)
+    {
+        int index = std::min(static_cast<int>(fraction * sorted.size()), int(sorted.size()) - 1);
+        std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+        return sorted[index];
+    }
+
+    bool computePercentiles(float &p50, float &p95, float &p99)
+    {
+        if (samples.empty())
+            return false;
+
+        std::vector<float> sorted = samples;
+        p50 = percentile(sorted, 0.50f);
+        p95 = percentile(sorted, 0.95f);
+        p99 = percentile(sorted, 0.99f);
+        return true;
+    }
+
+    void logPercentiles()
+    {
+        float p50 = 0, p95 = 0, p99 = 0;
+        if (!computePercentiles(p50, p95, p99))
+            return;
+        float worst = *std::max_element(samples.begin(), samples.end());
+        qDebug("InputLatency: %s, %d samples: p50 %.1f ms, p95 %.1f ms, p99 %.1f ms, max %.1f ms",
+               label, int(samples.size()), p50, p95, p99, worst);
+    }
+}
+
+int64_t InputLatency::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void InputLatency::addSample(int64_t inputTime)
+{
+    float ms = (now() - inputTime) / 1.0e6f;
+
+    std::lock_guard<std::mutex> lock(samplesMutex);
+    if (int(samples.size()) < NUM_SAMPLES)
+        samples.push_back(ms);
+    else
+        samples[nextSample] = ms;
+    nextSample = (nextSample + 1) % NUM_SAMPLES;
+
+    if (++sinceReport >= REPORT_EVERY)
+    {
+        logPercentiles();
+        sinceReport = 0;
+    }
+}
+
+bool InputLatency::percentiles(float &p50, float &p95, float &p99)
+{
+    std::lock_guard<std::mutex> lock(samplesMutex);
+    return computePercentiles(p50, p95, p99);
+}
+
+void InputLatency::report()
+{
+    std::lock_guard<std::mutex> lock(samplesMutex);
+    logPercentiles();
+}
+
+void InputLatency::reset(const char *mode)
+{
+    std::lock_guard<std::mutex> lock(samplesMutex);
+    logPercentiles();
+    samples.clear();
+    nextSample = 0;
+    sinceReport = 0;
+    label = mode;
+}
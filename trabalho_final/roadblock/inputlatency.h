@@ -0,0 +1,38 @@
+#ifndef INPUTLATENCY_H
+#define INPUTLATENCY_H
+
+#include <stdint.h>
+
+// Time from a key event reaching the widget to the swap of the first frame
+// drawn after the game stepped with it. Events are stamped on delivery, the
+// stamp follows the input through the step and the draw, and frameSwapped
+// turns it into a sample. Only the oldest input waiting for a frame is
+// measured. The latest NUM_SAMPLES are kept, and the distribution is logged
+// every REPORT_EVERY samples and when the mode changes.
+namespace InputLatency
+{
+    static const int NUM_SAMPLES = 512;
+    static const int REPORT_EVERY = 128;
+
+    // A key on its way from the event to the thread that applies it
+    struct KeyInput
+    {
+        int key;
+        bool pressed;
+        int64_t time; // now() on delivery; 0 for auto-repeats, which are not measured
+    };
+
+    int64_t now(); // Nanoseconds on a steady clock
+
+    // Called when the frame showing the input stamped inputTime was swapped
+    void addSample(int64_t inputTime);
+
+    // Milliseconds over the kept samples; false while there are none
+    bool percentiles(float &p50, float &p95, float &p99);
+
+    // Logs what was measured so far, then starts over under a new label
+    void report();
+    void reset(const char *mode);
+}
+
+#endif // INPUTLATENCY_H
@@ -0,0 +1,388 @@
+#include "jobsystem.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMatrix4x4>
+#include <QString>
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+#include "model.h"
+#include "profiler.h"
+#include "scenebatch.h"
+
+namespace
+{
+    // Set on the pool's own threads so submit and wait know their deque
+    thread_local const JobSystem *currentSystem = nullptr;
+    thread_local int currentIndex = 0;
+
+    int64_t clockNow()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+JobSystem::JobSystem(int _numWorkers)
+    : queued(0), stopping(false), timingHook(nullptr)
+{
+    numWorkers = _numWorkers >= 0 ? _numWorkers : std::max(1u, std::thread::hardware_concurrency()) - 1;
+    queues = std::make_unique<Queue[]>(numWorkers + 1);
+
+    for (int i = 1; i <= numWorkers; ++i)
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+    qDebug("JobSystem: %d workers", numWorkers);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+int JobSystem::currentQueue() const
+{
+    return currentSystem == this ? currentIndex : 0;
+}
+
+void JobSystem::submit(const char *name, std::function<void()> task, std::atomic<int> &counter)
+{
+    counter.fetch_add(1);
+
+    Queue &queue = queues[currentQueue()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(Job{name, std::move(task), &counter});
+    }
+    queued.fetch_add(1);
+
+    if (numWorkers)
+    {
+        // Taking the lock orders this with a worker about to sleep, so the wake up is not lost
+        { std::lock_guard<std::mutex> lock(sleepMutex); }
+        wakeUp.notify_one();
+    }
+}
+
+void JobSystem::wait(std::atomic<int> &counter)
+{
+    int queue = currentQueue();
+    while (counter.load() > 0)
+    {
+        // The rest may be running elsewhere, or on their way to a deque from a running job
+        if (!tryRun(queue))
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::parallelFor(const char *name, int count, int grain, const std::function<void(int, int)> &body)
+{
+    grain = std::max(grain, 1);
+    if (count <= grain)
+    {
+        PROFILE_ZONE(name);
+        if (count > 0)
+            body(0, count);
+        return;
+    }
+
+    std::atomic<int> remaining(0);
+    for (int begin = 0; begin < count; begin += grain)
+    {
+        int end = std::min(begin + grain, count);
+        submit(name, [&body, begin, end] { body(begin, end); }, remaining);
+    }
+    wait(remaining);
+}
+
+bool JobSystem::take(int queue, bool fromBack, Job &job)
+{
+    Queue &source = queues[queue];
+    std::lock_guard<std::mutex> lock(source.mutex);
+    if (source.jobs.empty())
+        return false;
+
+    if (fromBack)
+    {
+        job = std::move(source.jobs.back());
+        source.jobs.pop_back();
+    }
+    else
+    {
+        job = std::move(source.jobs.front());
+        source.jobs.pop_front();
+    }
+    queued.fetch_sub(1);
+    return true;
+}
+
+bool JobSystem::tryRun(int queue)
+{
+    if (!queued.load())
+        return false;
+
+    // Newest of our own first, then the oldest of everyone else's
+    Job job;
+    bool found = take(queue, true, job);
+    for (int i = 1; !found && i <= numWorkers; ++i)
+        found = take((queue + i) % (numWorkers + 1), false, job);
+    if (!found)
+        return false;
+
+    execute(job, queue);
+    return true;
+}
+
+void JobSystem::execute(Job &job, int queue)
+{
+    TimingHook hook = timingHook.load();
+    int64_t start = hook ? clockNow() : 0;
+    {
+        PROFILE_ZONE(job.name);
+        job.task();
+    }
+    if (hook)
+        hook(job.name, queue, start, clockNow());
+
+    // Last: the waiter may return and drop the counter as soon as it reads zero
+    job.counter->fetch_sub(1);
+}
+
+void JobSystem::workerLoop(int queue)
+{
+    PROFILE_THREAD("Job worker");
+    currentSystem = this;
+    currentIndex = queue;
+
+    while (!stopping)
+    {
+        if (tryRun(queue))
+            continue;
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeUp.wait(lock, [this] { return queued.load() > 0 || stopping; });
+    }
+}
+
+JobGraph::Node JobGraph::add(const char *name, std::function<void()> task)
+{
+    Entry entry;
+    entry.name = name;
+    entry.task = std::move(task);
+    entries.push_back(std::move(entry));
+    return Node(entries.size() - 1);
+}
+
+void JobGraph::precede(Node before, Node after)
+{
+    if (before < 0 || after >= int(entries.size()) || before >= after)
+    {
+        qDebug("JobGraph: node %d cannot wait on node %d", after, before);
+        return;
+    }
+    entries[before].successors.push_back(after);
+    entries[after].dependencies++;
+}
+
+void JobGraph::run(JobSystem &jobs)
+{
+    if (numPending != int(entries.size()))
+    {
+        numPending = int(entries.size());
+        pending = std::make_unique<std::atomic<int>[]>(numPending);
+    }
+    for (int node = 0; node < numPending; ++node)
+        pending[node] = entries[node].dependencies;
+
+    std::atomic<int> remaining(0);
+    for (int node = 0; node < numPending; ++node)
+        if (!entries[node].dependencies)
+            start(jobs, node, remaining);
+    jobs.wait(remaining);
+}
+
+void JobGraph::start(JobSystem &jobs, Node node, std::atomic<int> &remaining)
+{
+    // Successors are submitted before this job counts as done, so remaining
+    // cannot reach zero while any node is still to come
+    jobs.submit(entries[node].name, [this, &jobs, node, &remaining] {
+        entries[node].task();
+        for (Node next : entries[node].successors)
+            if (pending[next].fetch_sub(1) == 1)
+                start(jobs, next, remaining);
+    }, remaining);
+}
+
+namespace
+{
+    struct BenchmarkEntity
+    {
+        float posX, posY, posZ, scale;
+        QVector3D rotation;
+    };
+
+    // Totals gathered through the timing hook
+    std::atomic<int64_t> hookJobs(0);
+    std::atomic<int64_t> hookNanoseconds(0);
+
+    void countJob(const char *, int, int64_t start, int64_t end)
+    {
+        hookJobs.fetch_add(1);
+        hookNanoseconds.fetch_add(end - start);
+    }
+
+    // One frame of the game's per-entity work, at a scale the game does not reach yet
+    struct BenchmarkFrame
+    {
+        std::vector<BenchmarkEntity> entities;
+        std::vector<Matrix4> transforms;
+        std::vector<char> visible;
+        std::vector<BatchDraw> packets;
+        QMatrix4x4 viewProjection;
+        std::atomic<int> hits;
+        std::atomic<int> drawn;
+        JobGraph graph;
+
+        static const int GRAIN = 256;
+
+        BenchmarkFrame(int count, JobSystem &jobs) : hits(0), drawn(0)
+        {
+            std::mt19937 random(1234);
+            std::uniform_real_distribution<float> spreadX(-6.0f, 6.0f);
+            std::uniform_real_distribution<float> spreadY(-4.0f, 40.0f);
+            std::uniform_real_distribution<float> angle(0.0f, 360.0f);
+
+            entities.resize(count);
+            for (BenchmarkEntity &entity : entities)
+                entity = {spreadX(random), spreadY(random), 0.4f, 0.2f, QVector3D(0.0f, 0.0f, angle(random))};
+            transforms.resize(count);
+            visible.resize(count);
+            packets.resize(count);
+
+            QMatrix4x4 view, projection;
+            view.lookAt(QVector3D(0.0f, -5.0f, 2.5f), QVector3D(0.0f, 2.0f, 0.0f), QVector3D(0.0f, 0.0f, 1.0f));
+            projection.perspective(60.0f, 16.0f / 9.0f, 0.1f, 30.0f);
+            viewProjection = projection * view;
+
+            // Culling and collisions only need the transforms; packets only the visible ones
+            JobGraph::Node transform = graph.add("transforms", [this, &jobs] {
+                jobs.parallelFor("transforms", int(entities.size()), GRAIN, [this](int begin, int end) {
+                    for (int i = begin; i < end; ++i)
+                    {
+                        const BenchmarkEntity &e = entities[i];
+                        transforms[i] = Model::transform(e.posX, e.posY, e.posZ, e.scale, e.rotation);
+                    }
+                });
+            });
+            JobGraph::Node cull = graph.add("culling", [this, &jobs] {
+                jobs.parallelFor("culling", int(entities.size()), GRAIN, [this](int begin, int end) {
+                    for (int i = begin; i < end; ++i)
+                    {
+                        const Matrix4 &m = transforms[i];
+                        QVector4D clip = viewProjection * QVector4D(m(0, 3), m(1, 3), m(2, 3), 1.0f);
+                        float limit = clip.w() * 1.1f;
+                        visible[i] = clip.w() > 0.0f && fabs(clip.x()) <= limit && fabs(clip.y()) <= limit;
+                    }
+                });
+            });
+            JobGraph::Node collide = graph.add("collisions", [this, &jobs] {
+                jobs.parallelFor("collisions", int(entities.size()), GRAIN, [this](int begin, int end) {
+                    int batchHits = 0;
+                    for (int i = begin; i < end; ++i)
+                    {
+                        const Matrix4 &m = transforms[i];
+                        QVector3D position(m(0, 3), m(1, 3), m(2, 3));
+                        batchHits += (position - QVector3D(0.0f, -2.5f, 0.23f)).lengthSquared() < 0.16f;
+                    }
+                    hits.fetch_add(batchHits);
+                });
+            });
+            JobGraph::Node pack = graph.add("draw packets", [this, &jobs] {
+                jobs.parallelFor("draw packets", int(entities.size()), GRAIN, [this](int begin, int end) {
+                    int batchDrawn = 0;
+                    for (int i = begin; i < end; ++i)
+                    {
+                        if (!visible[i])
+                            continue;
+                        BatchDraw &packet = packets[i];
+                        float normalMatrix[9];
+                        transforms[i].normalMatrix(normalMatrix);
+                        memcpy(packet.model, transforms[i].data(), sizeof(packet.model));
+                        memset(packet.normalMatrix, 0, sizeof(packet.normalMatrix));
+                        for (int column = 0; column < 3; ++column)
+                            for (int row = 0; row < 3; ++row)
+                                packet.normalMatrix[column * 4 + row] = normalMatrix[column * 3 + row];
+                        packet.material = 0;
+                        batchDrawn++;
+                    }
+                    drawn.fetch_add(batchDrawn);
+                });
+            });
+            graph.precede(transform, cull);
+            graph.precede(transform, collide);
+            graph.precede(cull, pack);
+        }
+
+        double run(JobSystem &jobs, int frames)
+        {
+            QElapsedTimer timer;
+            timer.start();
+            for (int frame = 0; frame < frames; ++frame)
+            {
+                hits = 0;
+                drawn = 0;
+                graph.run(jobs);
+            }
+            return timer.nsecsElapsed() / 1.0e6 / frames;
+        }
+    };
+}
+
+int runJobsBenchmark()
+{
+    const int FRAMES = 20;
+    const int counts[] = {1000, 10000, 100000, 1000000};
+
+    JobSystem serial(0);
+    JobSystem parallel;
+    parallel.setTimingHook(countJob);
+
+    printf("%10s %8s %8s %12s %12s %8s %12s\n", "entities", "visible", "hits", "1 thread ms",
+           QString("%1 threads ms").arg(parallel.numThreads()).toLatin1().constData(), "speedup", "us per job");
+    for (int count : counts)
+    {
+        BenchmarkFrame serialFrame(count, serial);
+        BenchmarkFrame parallelFrame(count, parallel);
+
+        // One untimed frame each, to fault in the arrays and wake the workers
+        serialFrame.run(serial, 1);
+        parallelFrame.run(parallel, 1);
+        hookJobs = 0;
+        hookNanoseconds = 0;
+
+        double serialMs = serialFrame.run(serial, FRAMES);
+        double parallelMs = parallelFrame.run(parallel, FRAMES);
+        if (serialFrame.hits != parallelFrame.hits || serialFrame.drawn != parallelFrame.drawn)
+        {
+            printf("results differ at %d entities\n", count);
+            return 1;
+        }
+
+        printf("%10d %8d %8d %12.2f %12.2f %7.2fx %12.1f\n", count, parallelFrame.drawn.load(),
+               parallelFrame.hits.load(), serialMs, parallelMs, serialMs / parallelMs,
+               hookJobs ? hookNanoseconds / 1.0e3 / hookJobs : 0.0);
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pool of worker threads for splitting frame work into batches. Every worker
+// has its own deque: jobs it submits go on the back and it takes from the
+// back, so nested work stays hot in its cache, while idle workers steal the
+// oldest job from the front of someone else's. Jobs submitted from outside
+// the pool go to a shared deque that anyone can take from.
+//
+// Nothing blocks waiting for jobs: wait() runs queued jobs on the calling
+// thread until its counter drops to zero, so the thread that splits the
+// work does its share and nested parallelFor calls cannot deadlock.
+//
+// Each job is a PROFILE_ZONE under its name, and a timing hook, when set,
+// gets the start and end of every job.
+class JobSystem
+{
+public:
+    // name is the job's name as given to submit; start and end are nanoseconds
+    // on a steady clock; worker is 0 for threads outside the pool
+    typedef void (*TimingHook)(const char *name, int worker, int64_t start, int64_t end);
+
+    // -1 picks one worker less than the hardware threads, the caller being the last one
+    explicit JobSystem(int _numWorkers = -1);
+    ~JobSystem();
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    int numThreads() const { return numWorkers + 1; }
+
+    // The counter goes up now and down once the task has run. name must be a
+    // string literal, only the pointer is kept.
+    void submit(const char *name, std::function<void()> task, std::atomic<int> &counter);
+    void wait(std::atomic<int> &counter);
+
+    // body(begin, end) over [0, count) in batches of at most grain items.
+    // Returns when all are done; a single batch runs inline.
+    void parallelFor(const char *name, int count, int grain, const std::function<void(int, int)> &body);
+
+    void setTimingHook(TimingHook hook) { timingHook = hook; }
+
+private:
+    struct Job
+    {
+        const char *name;
+        std::function<void()> task;
+        std::atomic<int> *counter;
+    };
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    int numWorkers;
+    std::unique_ptr<Queue[]> queues; // 0 is shared, 1..numWorkers belong to the workers
+    std::vector<std::thread> workers;
+
+    std::atomic<int> queued; // Jobs in any queue, so idle workers know when to look
+    std::atomic<bool> stopping;
+    std::atomic<TimingHook> timingHook;
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+
+    int currentQueue() const;
+    bool tryRun(int queue);
+    bool take(int queue, bool fromBack, Job &job);
+    void execute(Job &job, int queue);
+    void workerLoop(int queue);
+};
+
+// Jobs with dependencies, built once and run as often as needed. A node can
+// only depend on nodes added before it, so a graph never has a cycle. run()
+// starts the nodes with nothing to wait for, each finished node starts the
+// successors it was the last dependency of, and it returns once every node
+// has run. Nodes may call parallelFor themselves.
+class JobGraph
+{
+public:
+    typedef int Node;
+
+    Node add(const char *name, std::function<void()> task);
+    void precede(Node before, Node after);
+
+    void run(JobSystem &jobs);
+
+private:
+    struct Entry
+    {
+        const char *name;
+        std::function<void()> task;
+        std::vector<Node> successors;
+        int dependencies = 0;
+    };
+
+    std::vector<Entry> entries;
+    std::unique_ptr<std::atomic<int>[]> pending; // Dependencies left per node during run()
+    int numPending = 0;
+
+    void start(JobSystem &jobs, Node node, std::atomic<int> &remaining);
+};
+
+// roadblock3D --jobs-benchmark: transforms, culling, collisions and draw
+// packets for growing entity counts, one thread against the job system
+int runJobsBenchmark();
+
+#endif // JOBSYSTEM_H
@@ -2,8 +2,24 @@
 #include <QApplication>
 #include <QSurfaceFormat>
 
+#include <string.h>
+
+#include "bvh.h"
+#include "jobsystem.h"
+#include "profiler.h"
+
 int main(int argc, char *argv[])
 {
+    if (argc > 1 && strcmp(argv[1], "--bvh-benchmark") == 0)
+        return runBvhBenchmark();
+    if (argc > 1 && strcmp(argv[1], "--jobs-benchmark") == 0)
+        return runJobsBenchmark();
+
+    // --trace <file> writes the profiler timeline, startup included, on exit
+    for (int i = 1; i + 1 < argc; i++)
+        if (strcmp(argv[i], "--trace") == 0)
+            Profiler::setTraceFile(argv[i + 1]);
+
     QSurfaceFormat format;
 
 #ifdef Q_OS_LINUX
@@ -21,5 +37,7 @@ int main(int argc, char *argv[])
     MainWindow w;
     w.show();
 
-    return a.exec();
+    int result = a.exec();
+    Profiler::dumpOnExit();
+    return result;
 }
@@ -14,6 +14,8 @@ public:
     QVector4D specular = QVector4D(0.2, 0.2, 0.2, 1.0);
 
     float shininess = 15.0;
+
+    QVector4D color = QVector4D(1.0, 1.0, 1.0, 1.0); // Base colour the lighting is multiplied by
 };
 
 #endif // MATERIAL_H
@@ -1,9 +1,10 @@
 #include "model.h"
 
-Model::Model(QOpenGLWidget *_glWidget)
+Model::Model(QOpenGLWidget *_glWidget, std::shared_ptr<ShaderLibrary> _shaderLibrary)
 {
     glWidget = _glWidget;
-    glWidget->makeCurrent();
+    shaderLibrary = _shaderLibrary;
+    makeGLCurrent(glWidget);
 
     initializeOpenGLFunctions();
 }
@@ -11,106 +12,7 @@ Model::Model(QOpenGLWidget *_glWidget)
 Model::~Model()
 {
     destroyVBOs();
-    destroyShaders();
-}
-
-void Model::createShaders(QString vertexShaderFile, QString fragmentShaderFile)
-{
-
-    destroyShaders();
-
-    QFile vs(vertexShaderFile);
-    QFile fs(fragmentShaderFile);
-
-    vs.open(QFile::ReadOnly | QFile::Text);
-    fs.open(QFile::ReadOnly | QFile::Text);
-
-    QTextStream streamVs(&vs), streamFs(&fs);
-
-    QString qtStringVs = streamVs.readAll();
-    QString qtStringFs = streamFs.readAll();
-
-    std::string stdStringVs = qtStringVs.toStdString();
-    std::string stdStringFs = qtStringFs.toStdString();
-
-    // Create an empty vertex shader handle
-    GLuint vertexShader = 0;
-    vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    // Send the vertex shader source code to GL
-    const GLchar *source = stdStringVs.c_str();
-    glShaderSource(vertexShader, 1, &source, 0);
-    // Compile the vertex shader
-    glCompileShader(vertexShader);
-    GLint isCompiled = 0;
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &isCompiled);
-    if (isCompiled == GL_FALSE)
-    {
-        GLint maxLength = 0;
-        glGetShaderiv(vertexShader, GL_INFO_LOG_LENGTH, &maxLength);
-        // The maxLength includes the NULL character
-        std::vector<GLchar> infoLog(maxLength);
-        glGetShaderInfoLog(vertexShader, maxLength, &maxLength, &infoLog[0]);
-        qDebug("%s", &infoLog[0]);
-
-        glDeleteShader(vertexShader);
-        return;
-    }
-
-    // Create an empty fragment shader handle
-    GLuint fragmentShader = 0;
-    fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    // Send the fragment shader source to GL
-    // Note that std::string's .c_str is NULL character terminated.
-    source = stdStringFs.c_str();
-    glShaderSource(fragmentShader, 1, &source, 0);
-    // Compile the fragment shader
-    glCompileShader(fragmentShader);
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &isCompiled);
-    if (isCompiled == GL_FALSE)
-    {
-        GLint maxLength = 0;
-        glGetShaderiv(fragmentShader, GL_INFO_LOG_LENGTH, &maxLength);
-        std::vector<GLchar> infoLog(maxLength);
-        glGetShaderInfoLog(fragmentShader, maxLength, &maxLength, &infoLog[0]);
-        qDebug("%s", &infoLog[0]);
-
-        glDeleteShader(fragmentShader);
-        glDeleteShader(vertexShader);
-        return;
-    }
-
-    shaderProgram = glCreateProgram();
-    // Attach our shader to our program
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    // Link our program
-    glLinkProgram(shaderProgram);
-    // Note the different functions here: glGetProgram* instead of glGetShader*.
-    GLint isLinked = 0;
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, (int *)&isLinked);
-    if (isLinked == GL_FALSE)
-    {
-        GLint maxLength = 0;
-        glGetProgramiv(shaderProgram, GL_INFO_LOG_LENGTH, &maxLength);
-        // The maxLength includes the NULL character
-        std::vector<GLchar> infoLog(maxLength);
-        glGetProgramInfoLog(shaderProgram, maxLength, &maxLength, &infoLog[0]);
-        qDebug("%s", &infoLog[0]);
-        glDeleteProgram(shaderProgram);
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
-        return;
-    }
-
-    glDetachShader(shaderProgram, vertexShader);
-    glDetachShader(shaderProgram, fragmentShader);
-
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-
-    vs.close();
-    fs.close();
-    GL_CHECK(glFlush());
+    ResourceTracker::releaseOwner(name);
 }
 
 void Model::createNormals()
@@ -133,6 +35,7 @@ void Model::createNormals()
     {
         normals[i].normalize();
     }
+    ResourceTracker::set(name, "normals", ResourceTracker::CpuArray, numVertices * sizeof(QVector3D));
 }
 
 void Model::destroyVBOs()
@@ -141,38 +44,58 @@ void Model::destroyVBOs()
     GL_CHECK(glDeleteBuffers(1, &vboIndices));
     GL_CHECK(glDeleteBuffers(1, &vboNormals));
     GL_CHECK(glDeleteBuffers(1, &vboTexCoords));
+    GL_CHECK(glDeleteBuffers(1, &vboColors));
 
     GL_CHECK(glDeleteVertexArrays(1, &vao));
+    destroyProxy();
 
     vboVertices = 0;
     vboIndices = 0;
     vboNormals = 0;
     vboTexCoords = 0;
+    vboColors = 0;
     vao = 0;
-    GL_CHECK(glFlush());
-}
-
-void Model::destroyShaders()
-{
-    GL_CHECK(glDeleteProgram(shaderProgram));
+    for (const char *resource : {"vboVertices", "vboIndices", "vboNormals", "vboTexCoords", "vboColors"})
+        ResourceTracker::release(name, resource);
     GL_CHECK(glFlush());
 }
 
 void Model::readOFFFile(const QString &fileName)
 {
+    PROFILE_ZONE("Model::readOFFFile");
+    name = QFileInfo(fileName).baseName();
     QFile s(fileName);
 
-    s.open(QFile::ReadOnly | QFile::Text);
-
-    QTextStream stream(&s);
-
-    QStringList line = stream.readLine().split(' ');
-    line = stream.readLine().split(' ');
-    numVertices = line[0].toFloat();
-    numFaces = line[1].toFloat();
+    OffHeader header;
+    if (!s.open(QFile::ReadOnly) || !OffFormat::readHeader(s, header))
+    {
+        qDebug("Model: cannot read %s", qPrintable(fileName));
+        return;
+    }
+    numVertices = header.numVertices;
+    numFaces = 0;
 
     vertices = std::make_unique<QVector4D[]>(numVertices);
-    indices = std::make_unique<unsigned int[]>(numFaces * 3);
+    // Positions are stored as vec4 with w always 1
+    ResourceTracker::set(name, "vertices", ResourceTracker::CpuArray,
+                         numVertices * sizeof(QVector4D), numVertices * sizeof(float));
+
+    // Attributes shipped in the file replace createNormals and createTexCoords
+    if (header.normals)
+    {
+        normals = std::make_unique<QVector3D[]>(numVertices);
+        ResourceTracker::set(name, "normals", ResourceTracker::CpuArray, numVertices * sizeof(QVector3D));
+    }
+    if (header.texCoords)
+    {
+        texCoords = std::make_unique<QVector2D[]>(numVertices);
+        ResourceTracker::set(name, "texCoords", ResourceTracker::CpuArray, numVertices * sizeof(QVector2D));
+    }
+    if (header.colors)
+    {
+        colors = std::make_unique<QVector4D[]>(numVertices);
+        ResourceTracker::set(name, "colors", ResourceTracker::CpuArray, numVertices * sizeof(QVector4D));
+    }
 
     if (numVertices > 0)
     {
@@ -180,14 +103,14 @@ void Model::readOFFFile(const QString &fileName)
         float maxLim = std::numeric_limits<float>::max();
         QVector4D max(minLim, minLim, minLim, 1.0);
         QVector4D min(maxLim, maxLim, maxLim, 1.0);
+        QByteArray line;
+        OffVertex vertex;
         for (unsigned int i = 0; i < numVertices; ++i)
         {
-            float x, y, z;
-
-            line = stream.readLine().split(' ');
-            x = line[0].toFloat();
-            y = line[1].toFloat();
-            z = line[2].toFloat();
+            OffFormat::parseVertex(OffFormat::readLine(s, line) ? line.constData() : "", header, vertex);
+            float x = vertex.position[0];
+            float y = vertex.position[1];
+            float z = vertex.position[2];
 
             max.setX(std::max(max.x(), x));
             max.setY(std::max(max.y(), y));
@@ -196,65 +119,280 @@ void Model::readOFFFile(const QString &fileName)
             min.setY(std::min(min.y(), y));
             min.setZ(std::min(min.z(), z));
             vertices[i] = QVector4D(x, y, z, 1.0);
+
+            if (header.normals)
+                normals[i] = QVector3D(vertex.normal[0], vertex.normal[1], vertex.normal[2]);
+            if (header.texCoords)
+                texCoords[i] = QVector2D(vertex.texCoord[0], vertex.texCoord[1]);
+            if (header.colors)
+                colors[i] = QVector4D(vertex.color[0], vertex.color[1], vertex.color[2], vertex.color[3]);
         }
 
         this->midPoint = QVector3D((min + max) * 0.5);
         this->invDiag  = 2.0 / (max - min).length();
 
-        for (unsigned int i = 0; i < numFaces; ++i)
+        // Polygons are triangulated as they are read; a face colour is spread
+        // to its corners when the vertices carry none
+        std::vector<unsigned int> triangles;
+        triangles.reserve(header.numFaces * 3);
+        std::vector<unsigned int> polygon;
+        std::unique_ptr<float[]> faceColorWeights;
+        float color[4];
+        bool hasColor = false;
+        for (unsigned int i = 0; i < header.numFaces; ++i)
         {
-            unsigned int a, b, c;
-            line = stream.readLine().split(' ');
+            if (!OffFormat::readLine(s, line) ||
+                !OffFormat::parseFace(line.constData(), numVertices, polygon, color, hasColor))
+                continue;
+            OffFormat::triangulate(polygon, vertices.get(), triangles);
+
+            if (hasColor && !header.colors)
+            {
+                if (!faceColorWeights)
+                {
+                    colors = std::make_unique<QVector4D[]>(numVertices);
+                    faceColorWeights = std::make_unique<float[]>(numVertices);
+                }
+                for (unsigned int corner : polygon)
+                {
+                    colors[corner] += QVector4D(color[0], color[1], color[2], color[3]);
+                    faceColorWeights[corner] += 1.0f;
+                }
+            }
+        }
 
-            a = line[1].toInt();
-            b = line[2].toInt();
-            c = line[3].toInt();
+        s.close();
 
-            indices[i * 3 + 0] = a;
-            indices[i * 3 + 1] = b;
-            indices[i * 3 + 2] = c;
+        if (faceColorWeights)
+        {
+            for (unsigned int i = 0; i < numVertices; ++i)
+                colors[i] = faceColorWeights[i] > 0.0f ? colors[i] / faceColorWeights[i] : QVector4D(1, 1, 1, 1);
+            ResourceTracker::set(name, "colors", ResourceTracker::CpuArray, numVertices * sizeof(QVector4D));
         }
+        vertexColors = colors != nullptr;
 
-        s.close();
+        numFaces = static_cast<unsigned int>(triangles.size() / 3);
+        indices = std::make_unique<unsigned int[]>(triangles.size());
+        std::copy(triangles.begin(), triangles.end(), indices.get());
+        ResourceTracker::set(name, "indices", ResourceTracker::CpuArray, numFaces * 3 * sizeof(unsigned int));
 
         //qDebug("Vertices: %d, Faces: %d", numVertices, numFaces);
-        createNormals();
-        createTexCoords();
+        bvh.build(vertices.get(), indices.get(), numFaces);
+        ResourceTracker::set(name, "bvh", ResourceTracker::CpuArray,
+                             bvh.nodes.size() * sizeof(BvhNode) + bvh.triangles.size() * sizeof(float));
+        if (!normals)
+            createNormals();
+        if (!texCoords)
+            createTexCoords();
+
+        selectShader();
+        createVBOs();
+    }
+}
 
-        // point de right shader for model
-        QString fshader, modelName;
-        modelName = fileName;
-        fshader = modelName.replace(":/models/", ":/shaders/f").replace(".off", ".glsl");
-        createShaders(":/shaders/vphong.glsl", fshader);
+bool Model::readOFFFileProgressive(const QString &fileName)
+{
+    PROFILE_ZONE("Model::readOFFFileProgressive");
+    name = QFileInfo(fileName).baseName();
 
-        createVBOs();
+    stream = std::make_unique<OffStream>(name);
+    if (!stream->open(fileName))
+    {
+        stream.reset();
+        return false;
+    }
+
+    const OffHeader &header = stream->header;
+    numVertices = header.numVertices;
+    numFaces = header.numFaces; // Grows when polygons triangulate into more
+    verticesLoaded = 0;
+    facesLoaded = 0;
+    proxyPoints = 0;
+    progressive = true;
+    flatNormals = !header.normals;
+
+    float minLim = std::numeric_limits<float>::lowest();
+    float maxLim = std::numeric_limits<float>::max();
+    boundsMin = QVector3D(maxLim, maxLim, maxLim);
+    boundsMax = QVector3D(minLim, minLim, minLim);
+    midPoint = QVector3D(0, 0, 0);
+    invDiag = 1.0;
+
+    makeGLCurrent(glWidget);
+    destroyVBOs();
+
+    GL_CHECK(glGenVertexArrays(1, &vao));
+    GL_CHECK(glBindVertexArray(vao));
+
+    // Both buffers get their final size now and are filled by updateStream.
+    // Positions are three floats, the attribute's w defaults to 1.
+    GL_CHECK(glGenBuffers(1, &vboVertices));
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vboVertices));
+    GL_CHECK(glBufferData(GL_ARRAY_BUFFER, numVertices * 3 * sizeof(float), nullptr, GL_STATIC_DRAW));
+    GL_CHECK(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr));
+    GL_CHECK(glEnableVertexAttribArray(0));
+    ResourceTracker::set(name, "vboVertices", ResourceTracker::Buffer, numVertices * 3 * sizeof(float));
+
+    if (header.normals)
+    {
+        GL_CHECK(glGenBuffers(1, &vboNormals));
+        GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vboNormals));
+        GL_CHECK(glBufferData(GL_ARRAY_BUFFER, numVertices * sizeof(QVector3D), nullptr, GL_STATIC_DRAW));
+        GL_CHECK(glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, nullptr));
+        GL_CHECK(glEnableVertexAttribArray(1));
+        ResourceTracker::set(name, "vboNormals", ResourceTracker::Buffer, numVertices * sizeof(QVector3D));
+    }
+
+    GL_CHECK(glGenBuffers(1, &vboIndices));
+    GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vboIndices));
+    GL_CHECK(glBufferData(GL_ELEMENT_ARRAY_BUFFER, numFaces * 3 * sizeof(unsigned int), nullptr, GL_STATIC_DRAW));
+    ResourceTracker::set(name, "vboIndices", ResourceTracker::Buffer, numFaces * 3 * sizeof(unsigned int));
+
+    GL_CHECK(glBindVertexArray(0));
+
+    selectShader();
+    stream->start();
+
+    qDebug("Model: streaming %s, %u vertices, %u faces", qPrintable(fileName), numVertices, numFaces);
+    return true;
+}
+
+void Model::updateStream()
+{
+    if (!stream)
+        return;
+
+    PROFILE_ZONE("Model::updateStream");
+
+    // Uploads go through the copy target so the element array binding of
+    // whichever vertex array is bound stays untouched
+    OffChunk chunk;
+    for (int i = 0; i < MAX_CHUNKS_PER_FRAME && stream->takeChunk(chunk); ++i)
+    {
+        if (chunk.kind == OffChunk::Proxy)
+        {
+            createProxy(chunk);
+        }
+        else if (chunk.kind == OffChunk::Vertices)
+        {
+            GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, vboVertices));
+            GL_CHECK(glBufferSubData(GL_COPY_WRITE_BUFFER, chunk.first * 3 * sizeof(float),
+                                     chunk.count * 3 * sizeof(float), chunk.positions.data()));
+            if (vboNormals && !chunk.normals.empty())
+            {
+                GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, vboNormals));
+                GL_CHECK(glBufferSubData(GL_COPY_WRITE_BUFFER, chunk.first * 3 * sizeof(float),
+                                         chunk.count * 3 * sizeof(float), chunk.normals.data()));
+            }
+            verticesLoaded = chunk.first + chunk.count;
+
+            // The proxy places the model until the real bounds are complete,
+            // so it does not move while the vertices come in
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                boundsMin[axis] = std::min(boundsMin[axis], chunk.min[axis]);
+                boundsMax[axis] = std::max(boundsMax[axis], chunk.max[axis]);
+            }
+            if (!proxyPoints || verticesLoaded == numVertices)
+            {
+                midPoint = (boundsMin + boundsMax) * 0.5f;
+                float diag = (boundsMax - boundsMin).length();
+                invDiag = diag > 0.0f ? 2.0 / diag : 1.0;
+            }
+        }
+        else
+        {
+            const unsigned int chunkTriangles = static_cast<unsigned int>(chunk.indices.size() / 3);
+            if (facesLoaded + chunkTriangles > numFaces)
+                growIndexBuffer(std::max(numFaces * 2, facesLoaded + chunkTriangles));
+            GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, vboIndices));
+            GL_CHECK(glBufferSubData(GL_COPY_WRITE_BUFFER, facesLoaded * 3 * sizeof(unsigned int),
+                                     chunk.indices.size() * sizeof(unsigned int), chunk.indices.data()));
+            facesLoaded += chunkTriangles;
+        }
+    }
+    GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+
+    if (stream->isFinished())
+    {
+        destroyProxy();
+        stream.reset();
+        qDebug("Model: %s loaded", qPrintable(name));
     }
 }
 
-void Model::drawModel(float posX, float posY, float posZ, float scale, QVector3D rotation)
+void Model::growIndexBuffer(unsigned int capacity)
 {
+    // Polygonal faces gave more triangles than the header counted faces
+    GLuint bigger = 0;
+    GL_CHECK(glGenBuffers(1, &bigger));
+    GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, bigger));
+    GL_CHECK(glBufferData(GL_COPY_WRITE_BUFFER, capacity * 3 * sizeof(unsigned int), nullptr, GL_STATIC_DRAW));
+    GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, vboIndices));
+    GL_CHECK(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                                 facesLoaded * 3 * sizeof(unsigned int)));
+    GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+    GL_CHECK(glDeleteBuffers(1, &vboIndices));
+    vboIndices = bigger;
 
-    glBindVertexArray(vao);
-    glUseProgram(shaderProgram);
+    GL_CHECK(glBindVertexArray(vao));
+    GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vboIndices));
+    GL_CHECK(glBindVertexArray(0));
 
-    modelMatrix.setToIdentity();
+    numFaces = capacity;
+    ResourceTracker::set(name, "vboIndices", ResourceTracker::Buffer, numFaces * 3 * sizeof(unsigned int));
+}
 
-    // Model rotation
-    modelMatrix.translate(0.0, 0.0, 0.0);
-    QVector3D quat;
-    quat = QVector3D(0, 0, 0);
-    for(int i=0; i<3; i++){
-        if(rotation[i])
-            quat[i] = rotation[i]/rotation[i] * sin(rotation[i]/2);
+void Model::createProxy(const OffChunk &chunk)
+{
+    destroyProxy();
+
+    // Positions first, then normals when the file has them
+    const GLsizeiptr positionBytes = chunk.positions.size() * sizeof(float);
+    const GLsizeiptr normalBytes = chunk.normals.size() * sizeof(float);
+
+    GL_CHECK(glGenVertexArrays(1, &proxyVao));
+    GL_CHECK(glBindVertexArray(proxyVao));
+    GL_CHECK(glGenBuffers(1, &vboProxy));
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vboProxy));
+    GL_CHECK(glBufferData(GL_ARRAY_BUFFER, positionBytes + normalBytes, nullptr, GL_STATIC_DRAW));
+    GL_CHECK(glBufferSubData(GL_ARRAY_BUFFER, 0, positionBytes, chunk.positions.data()));
+    GL_CHECK(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr));
+    GL_CHECK(glEnableVertexAttribArray(0));
+    if (normalBytes)
+    {
+        GL_CHECK(glBufferSubData(GL_ARRAY_BUFFER, positionBytes, normalBytes, chunk.normals.data()));
+        GL_CHECK(glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<void *>(positionBytes)));
+        GL_CHECK(glEnableVertexAttribArray(1));
     }
-    QQuaternion quaternion;
-    quaternion.setVector(quat);
-    modelMatrix.rotate(quaternion.normalized());
+    GL_CHECK(glBindVertexArray(0));
+    proxyPoints = chunk.count;
+    ResourceTracker::set(name, "vboProxy", ResourceTracker::Buffer, positionBytes + normalBytes);
+
+    QVector3D min(chunk.min[0], chunk.min[1], chunk.min[2]);
+    QVector3D max(chunk.max[0], chunk.max[1], chunk.max[2]);
+    midPoint = (min + max) * 0.5f;
+    float diag = (max - min).length();
+    invDiag = diag > 0.0f ? 2.0 / diag : 1.0;
+}
 
-    // Translation of model
-    modelMatrix.translate(posX, posY, posZ);
-    // Scale of model
-    modelMatrix.scale(scale, scale, scale);
+void Model::destroyProxy()
+{
+    GL_CHECK(glDeleteBuffers(1, &vboProxy));
+    GL_CHECK(glDeleteVertexArrays(1, &proxyVao));
+    vboProxy = 0;
+    proxyVao = 0;
+    ResourceTracker::release(name, "vboProxy");
+}
+
+void Model::drawModel(float posX, float posY, float posZ, float scale, QVector3D rotation)
+{
+    PROFILE_ZONE("Model::drawModel");
+
+    glBindVertexArray(vao);
+    glUseProgram(shaderProgram);
+
+    modelMatrix = transform(posX, posY, posZ, scale, rotation);
 
     GLuint locModel = 0;
     GLuint locNormalMatrix = 0;
@@ -264,12 +402,13 @@ void Model::drawModel(float posX, float posY, float posZ, float scale, QVector3D
     locNormalMatrix = glGetUniformLocation(shaderProgram, "normalMatrix");
     locShininess = glGetUniformLocation(shaderProgram, "shininess");
 
+    float normalMatrix[9];
+    modelMatrix.normalMatrix(normalMatrix);
+
     glUniformMatrix4fv(locModel, 1, GL_FALSE, modelMatrix.data());
-    glUniformMatrix3fv(locNormalMatrix, 1, GL_FALSE, modelMatrix.normalMatrix().data());
+    glUniformMatrix3fv(locNormalMatrix, 1, GL_FALSE, normalMatrix);
     glUniform1f(locShininess, static_cast<GLfloat>(material.shininess));
 
-    glDrawElements(GL_TRIANGLES, numFaces * 3, GL_UNSIGNED_INT, 0);
-
     if (textureID)
     {
         GLuint locColorTexture = 0;
@@ -279,12 +418,44 @@ void Model::drawModel(float posX, float posY, float posZ, float scale, QVector3D
         GL_CHECK(glActiveTexture(GL_TEXTURE0));
         GL_CHECK(glBindTexture(GL_TEXTURE_2D, textureID));
     }
+
+    if (!progressive)
+        glDrawElements(GL_TRIANGLES, numFaces * 3, GL_UNSIGNED_INT, 0);
+    else if (facesLoaded)
+        glDrawElements(GL_TRIANGLES, facesLoaded * 3, GL_UNSIGNED_INT, 0);
+    else if (proxyVao)
+    {
+        // Sample of the whole mesh until the first faces are in
+        glBindVertexArray(proxyVao);
+        glDrawArrays(GL_POINTS, 0, proxyPoints);
+    }
+    else
+        glDrawArrays(GL_POINTS, 0, verticesLoaded);
+    drawCalls++;
     GL_CHECK(glFlush());
 }
 
+Matrix4 Model::transform(float posX, float posY, float posZ, float scale, QVector3D rotation)
+{
+    // Model rotation
+    QVector3D quat;
+    quat = QVector3D(0, 0, 0);
+    for(int i=0; i<3; i++){
+        if(rotation[i])
+            quat[i] = rotation[i]/rotation[i] * sin(rotation[i]/2);
+    }
+    QQuaternion quaternion;
+    quaternion.setVector(quat);
+    quaternion.normalize();
+
+    // Rotation, then translation, then scale of model, as QMatrix4x4 composes them
+    return Matrix4::rotation(quaternion.x(), quaternion.y(), quaternion.z(), quaternion.scalar()) *
+           Matrix4::translation(posX, posY, posZ) * Matrix4::scaling(scale, scale, scale);
+}
+
 void Model::createVBOs()
 {
-    glWidget->makeCurrent();
+    makeGLCurrent(glWidget);
 
     destroyVBOs();
 
@@ -297,6 +468,9 @@ void Model::createVBOs()
     GL_CHECK(glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, nullptr));
     GL_CHECK(glEnableVertexAttribArray(0));
     vertices.reset();
+    ResourceTracker::set(name, "vboVertices", ResourceTracker::Buffer,
+                         numVertices * sizeof(QVector4D), numVertices * sizeof(float));
+    ResourceTracker::release(name, "vertices");
 
     GL_CHECK(glGenBuffers(1, &vboNormals));
     GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vboNormals));
@@ -304,6 +478,8 @@ void Model::createVBOs()
     GL_CHECK(glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, nullptr));
     GL_CHECK(glEnableVertexAttribArray(1));
     normals.reset();
+    ResourceTracker::set(name, "vboNormals", ResourceTracker::Buffer, numVertices * sizeof(QVector3D));
+    ResourceTracker::release(name, "normals");
 
     GL_CHECK(glGenBuffers(1, &vboTexCoords));
     GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vboTexCoords));
@@ -312,11 +488,29 @@ void Model::createVBOs()
     GL_CHECK(glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, nullptr));
     GL_CHECK(glEnableVertexAttribArray(2));
     texCoords.reset();
+    // Only the TEXTURED shader variant reads them
+    ResourceTracker::set(name, "vboTexCoords", ResourceTracker::Buffer, numVertices * sizeof(QVector2D),
+                         textureID ? 0 : numVertices * sizeof(QVector2D));
+    ResourceTracker::release(name, "texCoords");
+
+    if (colors)
+    {
+        GL_CHECK(glGenBuffers(1, &vboColors));
+        GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vboColors));
+        GL_CHECK(glBufferData(GL_ARRAY_BUFFER, numVertices * sizeof(QVector4D), colors.get(), GL_STATIC_DRAW));
+        GL_CHECK(glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 0, nullptr));
+        GL_CHECK(glEnableVertexAttribArray(3));
+        colors.reset();
+        ResourceTracker::set(name, "vboColors", ResourceTracker::Buffer, numVertices * sizeof(QVector4D));
+        ResourceTracker::release(name, "colors");
+    }
 
     GL_CHECK(glGenBuffers(1, &vboIndices));
     GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vboIndices));
     GL_CHECK(glBufferData(GL_ELEMENT_ARRAY_BUFFER, numFaces * 3 * sizeof(unsigned int), indices.get(), GL_STATIC_DRAW));
     indices.reset();
+    ResourceTracker::set(name, "vboIndices", ResourceTracker::Buffer, numFaces * 3 * sizeof(unsigned int));
+    ResourceTracker::release(name, "indices");
 
     GL_CHECK(glFlush());
 
@@ -342,6 +536,7 @@ void Model::createTexCoords()
         auto t = 1.0f - (vertices[i].z() - minz) / (maxz - minz);
         texCoords[i] = QVector2D(s, t);
     }
+    ResourceTracker::set(name, "texCoords", ResourceTracker::CpuArray, numVertices * sizeof(QVector2D));
 }
 
 void Model::loadTexture(const QString imagepath)
@@ -364,6 +559,29 @@ void Model::loadTexture(const QString imagepath)
     GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
     GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
     GL_CHECK(glGenerateMipmap(GL_TEXTURE_2D));
+    // The mipmap chain adds a third
+    ResourceTracker::set(name, "texture", ResourceTracker::Texture, qint64(image.width()) * image.height() * 4 * 4 / 3);
+    if (vboTexCoords)
+        ResourceTracker::set(name, "vboTexCoords", ResourceTracker::Buffer, numVertices * sizeof(QVector2D));
+
+    // Textured models need the TEXTURED variant
+    selectShader();
 
     GL_CHECK(glFlush());
 }
+
+void Model::selectShader()
+{
+    // Every model shares the material shader; only the features it uses are compiled in
+    QStringList defines;
+    if (textureID)
+        defines << "TEXTURED";
+    if (flatNormals)
+        defines << "FLAT_NORMALS";
+    if (vertexColors)
+        defines << "VERTEX_COLORS";
+    if (material.specular.toVector3D().lengthSquared() > 0.0f)
+        defines << "SPECULAR";
+
+    shaderProgram = shaderLibrary->program(":/shaders/vphong.glsl", ":/shaders/fmaterial.glsl", defines);
+}
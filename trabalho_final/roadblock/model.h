@@ -12,24 +12,34 @@
 #include <iostream>
 #include <memory>
 
+#include "bvh.h"
 #include "material.h"
+#include "offformat.h"
+#include "offstream.h"
+#include "shaderlibrary.h"
+#include "profiler.h"
+#include "resourcetracker.h"
 #include "util.h"
 
 class Model : public QOpenGLExtraFunctions
 {
 public:
-    Model(QOpenGLWidget *_glWidget);
+    Model(QOpenGLWidget *_glWidget, std::shared_ptr<ShaderLibrary> _shaderLibrary);
     ~Model();
 
     QOpenGLWidget *glWidget;
+    std::shared_ptr<ShaderLibrary> shaderLibrary;
+
+    QString name; // File base name, the owner shown by ResourceTracker
 
     std::unique_ptr<QVector4D[]> vertices;
     std::unique_ptr<unsigned int[]> indices;
     std::unique_ptr<QVector3D[]> normals;
     std::unique_ptr<QVector2D []> texCoords;
+    std::unique_ptr<QVector4D[]> colors; // From COFF vertices or averaged face colours
 
     unsigned int numVertices;
-    unsigned int numFaces;
+    unsigned int numFaces; // Triangles, once polygons are split
 
     GLuint vao = 0;
 
@@ -37,26 +47,58 @@ public:
     GLuint vboIndices = 0;
     GLuint vboNormals = 0;
     GLuint vboTexCoords = 0;
+    GLuint vboColors = 0;
     GLuint textureID = 0;
 
-    GLuint shaderProgram;
+    GLuint shaderProgram = 0; // Owned by shaderLibrary
 
-    QMatrix4x4 modelMatrix;
+    Matrix4 modelMatrix;
     QVector3D midPoint;
     double invDiag;
 
     Material material;
+    bool vertexColors = false; // Colours from the file multiply material.color
+
+    MeshBvh bvh; // Model space triangles for collision, built while the mesh is on the CPU
+
+    unsigned int drawCalls = 0; // Draw calls issued since the last frame stats reset
+
+    // Progressive loading: the buffers are sized from the header and filled
+    // chunk by chunk. Until the first faces arrive the stream's proxy sample
+    // of the whole mesh is drawn as points, placed by its bounds until every
+    // vertex is in; afterwards the loaded faces, lit with flat normals unless
+    // the file has its own. Files of one chunk have no proxy and draw the
+    // vertices loaded so far.
+    std::unique_ptr<OffStream> stream;
+    bool progressive = false;
+    unsigned int verticesLoaded = 0;
+    unsigned int facesLoaded = 0; // Triangles
+    bool flatNormals = false; // No normal buffer, the shader derives face normals
+    QVector3D boundsMin;
+    QVector3D boundsMax;
+    GLuint proxyVao = 0;
+    GLuint vboProxy = 0;
+    unsigned int proxyPoints = 0;
+
+    static const int MAX_CHUNKS_PER_FRAME = 4;
 
     void createVBOs();
-    void createShaders(QString vertexShaderFile, QString fragmentShaderFile);
+    void selectShader();
     void createNormals();
 
     void destroyVBOs();
-    void destroyShaders();
 
     void readOFFFile(const QString &fileName);
 
+    bool readOFFFileProgressive(const QString &fileName);
+    void updateStream();
+    void growIndexBuffer(unsigned int capacity);
+    void createProxy(const OffChunk &chunk);
+    void destroyProxy();
+    bool isLoading() const { return stream != nullptr; }
+
     void drawModel(float posX, float posY, float posZ, float scale, QVector3D rotation);
+    static Matrix4 transform(float posX, float posY, float posZ, float scale, QVector3D rotation);
 
     void createTexCoords();
     void loadTexture(const QString imagepath);
@@ -0,0 +1,267 @@
+#include "offformat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdlib.h>
+
+namespace
+{
+const int MAX_TOKENS = 16;
+
+// Up to MAX_TOKENS numbers from p; returns how many were read
+int parseFloats(const char *p, float *values)
+{
+    int count = 0;
+    while (count < MAX_TOKENS)
+    {
+        char *end = nullptr;
+        float value = strtof(p, &end);
+        if (end == p)
+            break;
+        values[count++] = value;
+        p = end;
+    }
+    return count;
+}
+
+void fan(const std::vector<unsigned int> &polygon, std::vector<unsigned int> &triangles)
+{
+    for (size_t i = 1; i + 1 < polygon.size(); ++i)
+    {
+        triangles.push_back(polygon[0]);
+        triangles.push_back(polygon[i]);
+        triangles.push_back(polygon[i + 1]);
+    }
+}
+
+float cross2(const float *a, const float *b, const float *c)
+{
+    return (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+}
+
+bool insideTriangle(const float *p, const float *a, const float *b, const float *c)
+{
+    return cross2(a, b, p) >= 0.0f && cross2(b, c, p) >= 0.0f && cross2(c, a, p) >= 0.0f;
+}
+}
+
+bool OffFormat::readLine(QFile &file, QByteArray &line)
+{
+    while (!file.atEnd())
+    {
+        line = file.readLine().trimmed();
+        if (!line.isEmpty() && !line.startsWith('#'))
+            return true;
+    }
+    return false;
+}
+
+bool OffFormat::readHeader(QFile &file, OffHeader &header)
+{
+    QByteArray line;
+    if (!readLine(file, line))
+        return false;
+
+    int offset = 0;
+    if (line.startsWith("ST"))
+    {
+        header.texCoords = true;
+        offset += 2;
+    }
+    if (line.mid(offset).startsWith('C'))
+    {
+        header.colors = true;
+        offset++;
+    }
+    if (line.mid(offset).startsWith('N'))
+    {
+        header.normals = true;
+        offset++;
+    }
+    if (!line.mid(offset).startsWith("OFF"))
+        return false;
+
+    // The counts may follow the keyword on the same line
+    line = line.mid(offset + 3).trimmed();
+    if (line.isEmpty() && !readLine(file, line))
+        return false;
+
+    char *end = nullptr;
+    header.numVertices = static_cast<unsigned int>(strtoul(line.constData(), &end, 10));
+    header.numFaces = static_cast<unsigned int>(strtoul(end, nullptr, 10));
+    return true;
+}
+
+void OffFormat::parseVertex(const char *line, const OffHeader &header, OffVertex &vertex)
+{
+    float values[MAX_TOKENS] = {};
+    int count = parseFloats(line, values);
+    const float *p = values;
+
+    for (int i = 0; i < 3; ++i)
+        vertex.position[i] = *p++;
+
+    if (header.normals)
+    {
+        for (int i = 0; i < 3; ++i)
+            vertex.normal[i] = *p++;
+    }
+
+    if (header.colors)
+    {
+        // Three or four components, whatever is left before the texcoords
+        int components = count - int(p - values) - (header.texCoords ? 2 : 0);
+        bool bytes = false;
+        for (int i = 0; i < 4; ++i)
+        {
+            vertex.color[i] = i < components ? p[i] : 1.0f;
+            bytes = bytes || vertex.color[i] > 1.0f;
+        }
+        if (bytes)
+        {
+            for (int i = 0; i < 4; ++i)
+                vertex.color[i] = i < components ? vertex.color[i] / 255.0f : 1.0f;
+        }
+        p += std::max(components, 0);
+    }
+
+    if (header.texCoords)
+    {
+        vertex.texCoord[0] = p[0];
+        vertex.texCoord[1] = p[1];
+    }
+}
+
+bool OffFormat::parseFace(const char *line, unsigned int numVertices, std::vector<unsigned int> &polygon,
+                          float color[4], bool &hasColor)
+{
+    char *end = nullptr;
+    long corners = strtol(line, &end, 10);
+    if (end == line || corners < 3)
+        return false;
+
+    polygon.clear();
+    const char *p = end;
+    for (long i = 0; i < corners; ++i)
+    {
+        unsigned long index = strtoul(p, &end, 10);
+        if (end == p || index >= numVertices)
+            return false;
+        polygon.push_back(static_cast<unsigned int>(index));
+        p = end;
+    }
+
+    // A single value is a colour map entry, which is not supported
+    float values[MAX_TOKENS];
+    int components = parseFloats(p, values);
+    hasColor = components >= 3;
+    if (hasColor)
+    {
+        bool bytes = values[0] > 1.0f || values[1] > 1.0f || values[2] > 1.0f;
+        for (int i = 0; i < 4; ++i)
+        {
+            float value = i < components ? values[i] : (bytes ? 255.0f : 1.0f);
+            color[i] = bytes ? value / 255.0f : value;
+        }
+    }
+    return true;
+}
+
+void OffFormat::triangulate(const std::vector<unsigned int> &polygon, const QVector4D *vertices,
+                            std::vector<unsigned int> &triangles)
+{
+    const size_t n = polygon.size();
+    if (n < 3)
+        return;
+    if (n == 3 || !vertices)
+    {
+        fan(polygon, triangles);
+        return;
+    }
+
+    // Newell normal; its largest axis is dropped to work in 2D
+    float normal[3] = {0, 0, 0};
+    for (size_t i = 0; i < n; ++i)
+    {
+        const QVector4D &a = vertices[polygon[i]];
+        const QVector4D &b = vertices[polygon[(i + 1) % n]];
+        normal[0] += (a.y() - b.y()) * (a.z() + b.z());
+        normal[1] += (a.z() - b.z()) * (a.x() + b.x());
+        normal[2] += (a.x() - b.x()) * (a.y() + b.y());
+    }
+    int axis = 0;
+    for (int i = 1; i < 3; ++i)
+        if (std::fabs(normal[i]) > std::fabs(normal[axis]))
+            axis = i;
+    const int u = (axis + 1) % 3;
+    const int v = (axis + 2) % 3;
+    // Mirror so the polygon winds counterclockwise in 2D
+    const float flip = normal[axis] < 0.0f ? -1.0f : 1.0f;
+
+    std::vector<float> points(n * 2);
+    for (size_t i = 0; i < n; ++i)
+    {
+        points[i * 2 + 0] = vertices[polygon[i]][u] * flip;
+        points[i * 2 + 1] = vertices[polygon[i]][v];
+    }
+
+    bool convex = true;
+    for (size_t i = 0; i < n && convex; ++i)
+        convex = cross2(&points[i * 2], &points[((i + 1) % n) * 2], &points[((i + 2) % n) * 2]) >= 0.0f;
+    if (convex)
+    {
+        fan(polygon, triangles);
+        return;
+    }
+
+    std::vector<size_t> remaining(n);
+    for (size_t i = 0; i < n; ++i)
+        remaining[i] = i;
+
+    while (remaining.size() > 3)
+    {
+        const size_t count = remaining.size();
+        bool clipped = false;
+        for (size_t i = 0; i < count && !clipped; ++i)
+        {
+            size_t prev = remaining[(i + count - 1) % count];
+            size_t cur = remaining[i];
+            size_t next = remaining[(i + 1) % count];
+            const float *a = &points[prev * 2];
+            const float *b = &points[cur * 2];
+            const float *c = &points[next * 2];
+            if (cross2(a, b, c) <= 0.0f)
+                continue; // Reflex corner
+
+            bool ear = true;
+            for (size_t j = 0; j < count && ear; ++j)
+            {
+                size_t other = remaining[j];
+                if (other != prev && other != cur && other != next)
+                    ear = !insideTriangle(&points[other * 2], a, b, c);
+            }
+            if (!ear)
+                continue;
+
+            triangles.push_back(polygon[prev]);
+            triangles.push_back(polygon[cur]);
+            triangles.push_back(polygon[next]);
+            remaining.erase(remaining.begin() + i);
+            clipped = true;
+        }
+
+        if (!clipped)
+        {
+            // Self intersecting or degenerate: fan what is left
+            std::vector<unsigned int> rest;
+            for (size_t index : remaining)
+                rest.push_back(polygon[index]);
+            fan(rest, triangles);
+            return;
+        }
+    }
+
+    triangles.push_back(polygon[remaining[0]]);
+    triangles.push_back(polygon[remaining[1]]);
+    triangles.push_back(polygon[remaining[2]]);
+}
@@ -0,0 +1,52 @@
+#ifndef OFFFORMAT_H
+#define OFFFORMAT_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QVector4D>
+
+#include <vector>
+
+// Optional per vertex attributes announced by the [ST][C][N]OFF keyword
+struct OffHeader
+{
+    bool normals = false;
+    bool colors = false;
+    bool texCoords = false;
+    unsigned int numVertices = 0;
+    unsigned int numFaces = 0; // Polygons, before triangulation
+};
+
+struct OffVertex
+{
+    float position[3];
+    float normal[3];
+    float color[4];
+    float texCoord[2];
+};
+
+// Parsing shared by Model::readOFFFile and OffStream
+namespace OffFormat
+{
+// Next line holding data, comments and blank lines skipped
+bool readLine(QFile &file, QByteArray &line);
+
+// OFF, NOFF, COFF, STOFF and their combinations such as CNOFF or STCNOFF
+bool readHeader(QFile &file, OffHeader &header);
+
+// x y z [nx ny nz] [r g b [a]] [s t]; 0-255 colours are brought to 0-1
+void parseVertex(const char *line, const OffHeader &header, OffVertex &vertex);
+
+// n i0 ... in-1 [r g b [a]]. False when the face has fewer than three
+// corners or an index is out of range.
+bool parseFace(const char *line, unsigned int numVertices, std::vector<unsigned int> &polygon,
+               float color[4], bool &hasColor);
+
+// Appends the n - 2 triangles of polygon to triangles, keeping its winding.
+// Convex polygons are fanned; concave ones are ear clipped in the plane of
+// their Newell normal. Without vertices every polygon is fanned.
+void triangulate(const std::vector<unsigned int> &polygon, const QVector4D *vertices,
+                 std::vector<unsigned int> &triangles);
+}
+
+#endif // OFFFORMAT_H
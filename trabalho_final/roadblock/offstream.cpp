@@ -0,0 +1,238 @@
+#include "offstream.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdlib.h>
+
+// std::min takes these by reference, so they need a definition
+const unsigned int OffStream::CHUNK_SIZE;
+const unsigned int OffStream::PROXY_POINTS;
+
+OffStream::OffStream(const QString &_owner)
+{
+    owner = _owner;
+}
+
+OffStream::~OffStream()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    canRead.notify_all();
+    if (worker.joinable())
+        worker.join();
+    ResourceTracker::release(owner, "streamQueue");
+}
+
+bool OffStream::open(const QString &_fileName)
+{
+    fileName = _fileName;
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly))
+    {
+        qDebug("OffStream: cannot open %s", qPrintable(fileName));
+        return false;
+    }
+
+    if (!OffFormat::readHeader(file, header))
+    {
+        qDebug("OffStream: %s is not an OFF file", qPrintable(fileName));
+        return false;
+    }
+    dataOffset = file.pos();
+    return true;
+}
+
+void OffStream::start()
+{
+    worker = std::thread(&OffStream::readChunks, this);
+}
+
+bool OffStream::takeChunk(OffChunk &chunk)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending.empty())
+            return false;
+        chunk = std::move(pending.front());
+        pending.pop_front();
+        pendingBytes -= chunkBytes(chunk);
+        ResourceTracker::set(owner, "streamQueue", ResourceTracker::CpuArray, pendingBytes);
+    }
+    canRead.notify_one();
+    return true;
+}
+
+bool OffStream::isFinished()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return done && pending.empty();
+}
+
+namespace
+{
+    // n i0 ... in-1 with integer corners, which a sample landing past the vertex block reads
+    bool looksLikeFace(const char *line)
+    {
+        char *end;
+        long corners = strtol(line, &end, 10);
+        if (end == line || (*end && *end != ' ' && *end != '\t') || corners < 3)
+            return false;
+        for (long i = 0; i < corners; ++i)
+        {
+            const char *start = end;
+            strtol(start, &end, 10);
+            if (end == start || (*end && *end != ' ' && *end != '\t'))
+                return false;
+        }
+        return true;
+    }
+}
+
+qint64 OffStream::chunkBytes(const OffChunk &chunk)
+{
+    return (chunk.positions.size() + chunk.normals.size()) * sizeof(float) + chunk.indices.size() * sizeof(unsigned int);
+}
+
+bool OffStream::push(OffChunk &chunk)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    canRead.wait(lock, [this] { return stopping || int(pending.size()) < MAX_PENDING; });
+    if (stopping)
+        return false;
+    pendingBytes += chunkBytes(chunk);
+    ResourceTracker::set(owner, "streamQueue", ResourceTracker::CpuArray, pendingBytes);
+    pending.push_back(std::move(chunk));
+    return true;
+}
+
+void OffStream::readChunks()
+{
+    PROFILE_THREAD("OffStream");
+
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly) || !file.seek(dataOffset))
+    {
+        qDebug("OffStream: cannot read %s", qPrintable(fileName));
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+        return;
+    }
+
+    if (header.numVertices > CHUNK_SIZE)
+    {
+        if (!readProxy(file))
+            return;
+        file.seek(dataOffset);
+    }
+
+    QByteArray line;
+    OffVertex vertex;
+    unsigned int nextVertex = 0;
+    while (nextVertex < header.numVertices)
+    {
+        PROFILE_ZONE("OffStream::vertices");
+        OffChunk chunk;
+        chunk.kind = OffChunk::Vertices;
+        chunk.first = nextVertex;
+        chunk.count = std::min(CHUNK_SIZE, header.numVertices - nextVertex);
+        chunk.positions.resize(chunk.count * 3);
+        if (header.normals)
+            chunk.normals.resize(chunk.count * 3);
+        std::fill(chunk.min, chunk.min + 3, std::numeric_limits<float>::max());
+        std::fill(chunk.max, chunk.max + 3, std::numeric_limits<float>::lowest());
+
+        for (unsigned int i = 0; i < chunk.count; ++i)
+        {
+            // A truncated file leaves the remaining vertices at the origin
+            OffFormat::parseVertex(OffFormat::readLine(file, line) ? line.constData() : "", header, vertex);
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                float value = vertex.position[axis];
+                chunk.positions[i * 3 + axis] = value;
+                chunk.min[axis] = std::min(chunk.min[axis], value);
+                chunk.max[axis] = std::max(chunk.max[axis], value);
+                if (header.normals)
+                    chunk.normals[i * 3 + axis] = vertex.normal[axis];
+            }
+        }
+        nextVertex += chunk.count;
+        if (!push(chunk))
+            return;
+    }
+
+    std::vector<unsigned int> polygon;
+    float color[4];
+    bool hasColor;
+    unsigned int nextFace = 0;
+    while (nextFace < header.numFaces)
+    {
+        PROFILE_ZONE("OffStream::faces");
+        OffChunk chunk;
+        chunk.kind = OffChunk::Faces;
+        chunk.first = nextFace;
+        chunk.count = std::min(CHUNK_SIZE, header.numFaces - nextFace);
+        chunk.indices.reserve(chunk.count * 3);
+
+        for (unsigned int i = 0; i < chunk.count; ++i)
+        {
+            // Malformed faces are dropped
+            if (OffFormat::readLine(file, line) &&
+                OffFormat::parseFace(line.constData(), header.numVertices, polygon, color, hasColor))
+                OffFormat::triangulate(polygon, nullptr, chunk.indices);
+        }
+        nextFace += chunk.count;
+        if (!push(chunk))
+            return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    done = true;
+}
+
+bool OffStream::readProxy(QFile &file)
+{
+    PROFILE_ZONE("OffStream::proxy");
+    OffChunk chunk;
+    chunk.kind = OffChunk::Proxy;
+    std::fill(chunk.min, chunk.min + 3, std::numeric_limits<float>::max());
+    std::fill(chunk.max, chunk.max + 3, std::numeric_limits<float>::lowest());
+
+    // The length of the first lines gives where the vertex block ends
+    const unsigned int HEAD_LINES = 64;
+    QByteArray line;
+    unsigned int headLines = 0;
+    while (headLines < HEAD_LINES && OffFormat::readLine(file, line))
+        headLines++;
+    if (!headLines)
+        return true;
+    qint64 blockBytes = (file.pos() - dataOffset) * header.numVertices / headLines;
+
+    OffVertex vertex;
+    unsigned int samples = std::min(PROXY_POINTS, header.numVertices);
+    chunk.positions.reserve(samples * 3);
+    if (header.normals)
+        chunk.normals.reserve(samples * 3);
+    for (unsigned int i = 0; i < samples; ++i)
+    {
+        // Lands mid line, the next whole one is the sample
+        qint64 offset = dataOffset + blockBytes * i / samples;
+        if (!file.seek(offset) || (i && file.readLine().isEmpty()) || !OffFormat::readLine(file, line) ||
+                looksLikeFace(line.constData()))
+            continue;
+
+        OffFormat::parseVertex(line.constData(), header, vertex);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float value = vertex.position[axis];
+            chunk.positions.push_back(value);
+            chunk.min[axis] = std::min(chunk.min[axis], value);
+            chunk.max[axis] = std::max(chunk.max[axis], value);
+            if (header.normals)
+                chunk.normals.push_back(vertex.normal[axis]);
+        }
+    }
+    chunk.count = static_cast<unsigned int>(chunk.positions.size() / 3);
+    return !chunk.count || push(chunk);
+}
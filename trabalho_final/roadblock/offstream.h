@@ -0,0 +1,85 @@
+#ifndef OFFSTREAM_H
+#define OFFSTREAM_H
+
+#include <QFile>
+#include <QString>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "offformat.h"
+#include "profiler.h"
+#include "resourcetracker.h"
+
+// Consecutive run of vertices or faces read from an OFF file, or the proxy:
+// a sample of positions spread over the whole vertex block
+struct OffChunk
+{
+    enum Kind { Proxy, Vertices, Faces };
+
+    Kind kind = Vertices;
+    unsigned int first = 0; // Index of the first vertex or face
+    unsigned int count = 0;
+
+    std::vector<float> positions;      // x y z per vertex
+    std::vector<float> normals;        // Only when the file has them
+    std::vector<unsigned int> indices; // Triangles of the faces, three per triangle
+    float min[3];                      // Bounds of the positions in this chunk
+    float max[3];
+};
+
+// Reads an OFF file on a worker thread in chunks of at most CHUNK_SIZE
+// vertices or faces. At most MAX_PENDING chunks wait to be taken, so the
+// memory held is bounded by the chunk size whatever the size of the file.
+// The header is parsed by open() on the calling thread, which lets the
+// caller size its buffers before the first chunk arrives. Polygons are
+// fanned, since the vertices needed to clip ears are not kept.
+//
+// A file of more than one vertex chunk starts with a Proxy chunk of up to
+// PROXY_POINTS positions, read by seeking to evenly spaced offsets of the
+// vertex block, so a rough outline of the whole mesh and its bounds are
+// known long before the vertex pass reaches the end.
+class OffStream
+{
+public:
+    OffStream(const QString &_owner);
+    ~OffStream();
+
+    static const unsigned int CHUNK_SIZE = 16384;
+    static const int MAX_PENDING = 8;
+    static const unsigned int PROXY_POINTS = 2048;
+
+    OffHeader header;
+
+    bool open(const QString &_fileName);
+    void start();
+
+    // Never blocks; false when no chunk is ready yet
+    bool takeChunk(OffChunk &chunk);
+
+    // Every chunk has been read and taken
+    bool isFinished();
+
+private:
+    QString owner; // ResourceTracker owner of the queue
+    QString fileName;
+    qint64 dataOffset = 0; // First byte after the header
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable canRead;
+    std::deque<OffChunk> pending;
+    qint64 pendingBytes = 0;
+    bool stopping = false;
+    bool done = false;
+
+    void readChunks();
+    bool readProxy(QFile &file);
+    bool push(OffChunk &chunk);
+    static qint64 chunkBytes(const OffChunk &chunk);
+};
+
+#endif // OFFSTREAM_H
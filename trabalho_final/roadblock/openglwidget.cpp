@@ -20,15 +20,37 @@ OpenGLWidget::OpenGLWidget(QWidget *parent) : QOpenGLWidget(parent)
     gasTankPosX = 0.0f;
     gasTankRotation = QVector3D(0, 0, 0);
 
+    travelled = 0;
+
     lose = 0;
     score = 0;
     finalScore = 0;
 
+    frameTimeAccum = 0;
+    submitTimeAccum = 0;
+    framesAccum = 0;
+
+    jobSystem = std::make_shared<JobSystem>();
+
+    connect(this, SIGNAL(frameSwapped()), this, SLOT(recordLatency()));
 }
 
 OpenGLWidget::~OpenGLWidget()
 {
+    // The thread releases the scene with its own context current before it ends
+    if (renderThread)
+        renderThread->stop();
 
+    // What this context kept for presenting the thread's frames
+    if (presentVao)
+    {
+        makeCurrent();
+        GL_CHECK(context()->extraFunctions()->glDeleteVertexArrays(1, &presentVao));
+        presentVao = 0;
+        presentShaders.reset();
+        doneCurrent();
+    }
+    InputLatency::report();
 }
 
 
@@ -48,6 +70,7 @@ void OpenGLWidget::applyLightParams(std::shared_ptr<Model> model)
     GLuint locDiffuseProduct = glGetUniformLocation(shaderProgramID, "diffuseProduct");
     GLuint locSpecularProduct = glGetUniformLocation(shaderProgramID, "specularProduct");
     GLuint locShininess = glGetUniformLocation(shaderProgramID, "shininess");
+    GLuint locBaseColor = glGetUniformLocation(shaderProgramID, "baseColor");
 
     glUniformMatrix4fv(locProjection, 1, GL_FALSE, camera.projectionMatrix.data());
     glUniformMatrix4fv(locView, 1, GL_FALSE, camera.viewMatrix.data());
@@ -57,10 +80,41 @@ void OpenGLWidget::applyLightParams(std::shared_ptr<Model> model)
     glUniform4fv(locDiffuseProduct, 1, &(diffuseProduct[0]));
     glUniform4fv(locSpecularProduct, 1, &(specularProduct[0]));
     glUniform1f(locShininess, playerModel->material.shininess);
+    glUniform4fv(locBaseColor, 1, &(model->material.color[0]));
 }
 
 void OpenGLWidget::initializeGL()
 {
+    PROFILE_THREAD("GUI");
+    PROFILE_ZONE("OpenGLWidget::initializeGL");
+
+    lowLatency = QCoreApplication::arguments().contains("--low-latency");
+    InputLatency::reset(lowLatency ? "low-latency" : "default");
+
+    if (!QCoreApplication::arguments().contains("--render-thread"))
+    {
+        initializeScene();
+        connect(&timer, SIGNAL(timeout()), this, SLOT(tick()));
+        timer.start(0);
+        return;
+    }
+
+    // The scene is built on the render thread; this context only shows its frames
+    QOpenGLExtraFunctions *f = context()->extraFunctions();
+    presentShaders = std::make_shared<ShaderLibrary>(this, "Present");
+    presentProgram = presentShaders->program(":/shaders/vupscale.glsl", ":/shaders/fupscale.glsl", QStringList());
+    GL_CHECK(f->glGenVertexArrays(1, &presentVao));
+
+    // Paced to the screen the window is on, not necessarily the primary one
+    QWindow *handle = window()->windowHandle();
+    QScreen *screen = handle ? handle->screen() : QGuiApplication::primaryScreen();
+    renderThread = std::make_unique<RenderThread>(this, context(), screen->refreshRate());
+    renderThread->start();
+}
+
+void OpenGLWidget::initializeScene()
+{
+    PROFILE_ZONE("OpenGLWidget::initializeScene");
     initializeOpenGLFunctions();
 
     qDebug("OpenGL version: %s", glGetString(GL_VERSION));
@@ -68,32 +122,51 @@ void OpenGLWidget::initializeGL()
 
     glEnable(GL_DEPTH_TEST);
 
-    playerModel = std::make_shared<Model>(this);
+    // One material shader for every model, colours come from the materials
+    shaderLibrary = std::make_shared<ShaderLibrary>(this);
+
+    playerModel = std::make_shared<Model>(this, shaderLibrary);
+    playerModel->material.color = QVector4D(0.09f, 0.45f, 0.80f, 1.0f);
     playerModel->readOFFFile(":/models/car.off");
 
-    targetModel = std::make_shared<Model>(this);
+    targetModel = std::make_shared<Model>(this, shaderLibrary);
+    targetModel->material.color = QVector4D(0.82f, 0.82f, 0.77f, 1.0f);
     targetModel->readOFFFile(":/models/barriere.off");
 
-    roadModel = std::make_shared<Model>(this);
+    roadModel = std::make_shared<Model>(this, shaderLibrary);
+    roadModel->material.color = QVector4D(0.21f, 0.21f, 0.21f, 1.0f);
     roadModel->readOFFFile(":/models/road.off");
 
-    roadstripModel = std::make_shared<Model>(this);
+    roadstripModel = std::make_shared<Model>(this, shaderLibrary);
+    roadstripModel->material.color = QVector4D(1.0f, 1.0f, 1.0f, 1.0f);
     roadstripModel->readOFFFile(":/models/roadstrip.off");
 
-    grassModel = std::make_shared<Model>(this);
-    grassModel->readOFFFile(":/models/grass.off");
-
-    gasTankModel = std::make_shared<Model>(this);
+    gasTankModel = std::make_shared<Model>(this, shaderLibrary);
+    gasTankModel->material.color = QVector4D(0.69f, 0.24f, 0.06f, 1.0f);
     gasTankModel->readOFFFile(":/models/gastank.off");
 
-    connect(&timer, SIGNAL(timeout()), this, SLOT(animate()));
-    timer.start(0);
+    // Large scanned assets are streamed in while the game already runs
+    const QStringList arguments = QCoreApplication::arguments();
+    int sceneryArgument = arguments.indexOf("--scenery");
+    if (sceneryArgument >= 0 && sceneryArgument + 1 < arguments.size())
+    {
+        sceneryModel = std::make_shared<Model>(this, shaderLibrary);
+        sceneryModel->material.color = QVector4D(0.55f, 0.51f, 0.46f, 1.0f);
+        if (!sceneryModel->readOFFFileProgressive(arguments[sceneryArgument + 1]))
+            sceneryModel = nullptr;
+    }
 
-    roadPosY = std::make_unique<float[]>(2);
+    sceneBatch = std::make_shared<SceneBatch>(this, shaderLibrary, jobSystem);
+    sceneBatch->addModel(playerModel);
+    sceneBatch->addModel(targetModel);
+    sceneBatch->addModel(gasTankModel);
+    sceneBatch->build();
 
-    roadPosY[0] = 0.0f;
-    roadPosY[1] = 4.0f;
-    roadPosY[2] = 8.0f;
+    hud = std::make_shared<Hud>(this, shaderLibrary);
+    frameCapture = std::make_shared<FrameCapture>(this);
+    dynamicResolution = std::make_shared<DynamicResolution>(this, shaderLibrary);
+    roadStream = std::make_shared<RoadStream>(this);
+    grassField = std::make_shared<GrassField>(this, shaderLibrary);
 
     srand((unsigned int)time.currentTime().msec());
 
@@ -107,120 +180,440 @@ void OpenGLWidget::initializeGL()
         targetsPosX[i] = 0.0f + 1.0f*r;
     }
 
-    roadstripsPosY = std::make_unique<float[]>(NUM_STRIPS);
-    roadstripsPosY[0] = 0.0f;
-    roadstripsPosY[1] = 2.0f;
-    roadstripsPosY[2] = -2.0f;
-    roadstripsPosY[3] = 4.0f;
-    roadstripsPosY[4] = -4.0f;
-    roadstripsPosY[5] = 6.0f;
-    roadstripsPosY[6] = -6.0f;
-    roadstripsPosY[7] = 8.0f;
-
-    grassPosY = std::make_unique<float[]>(NUM_GRASS);
-    grassPosY[0] = 0.0f;
-    grassPosY[1] = 0.5f;
-    grassPosY[2] = 4.0f;
-    grassPosY[3] = 4.5f;
-
     time.start();
+    frameTimer.start();
+}
+
+void OpenGLWidget::releaseScene()
+{
+    frameCapture = nullptr;
+    dynamicResolution = nullptr;
+    sceneBatch = nullptr;
+    roadStream = nullptr;
+    hud = nullptr;
+    sceneryModel = nullptr;
+    playerModel = nullptr;
+    targetModel = nullptr;
+    roadModel = nullptr;
+    roadstripModel = nullptr;
+    grassField = nullptr;
+    gasTankModel = nullptr;
+    shaderLibrary = nullptr;
+
+    for (GLsync &fence : queuedFrames)
+    {
+        if (fence)
+            glDeleteSync(fence);
+        fence = 0;
+    }
 }
 
 void OpenGLWidget::resizeGL(int width, int height)
 {
-    glViewport(0, 0, width, height);
-    camera.resizeViewport(width, height);
+    if (renderThread)
+        renderThread->resize(width * devicePixelRatio(), height * devicePixelRatio());
+    else
+        resizeScene(width, height, devicePixelRatio());
 
     update();
 }
 
+void OpenGLWidget::resizeScene(int width, int height, qreal pixelRatio)
+{
+    glViewport(0, 0, width, height);
+    camera.resizeViewport(width, height);
+    frameWidth = static_cast<int>(width * pixelRatio);
+    frameHeight = static_cast<int>(height * pixelRatio);
+    if (hud)
+        hud->resize(width, height);
+    if (dynamicResolution)
+        dynamicResolution->resize(width, height);
+    // A recording keeps one frame size
+    if (frameCapture && frameCapture->isRecording())
+        frameCapture->stop();
+}
+
 void OpenGLWidget::paintGL()
 {
+    PROFILE_ZONE("OpenGLWidget::paintGL");
+    if (renderThread)
+    {
+        presentFrame();
+        return;
+    }
+
+    if (lowLatency)
+    {
+        // Wait for the GPU first so the input below is as fresh as it can be
+        waitForQueuedFrames();
+        for (const InputLatency::KeyInput &input : pendingKeys)
+            applyKey(input);
+        pendingKeys.clear();
+        if (!lose)
+            animate();
+    }
+    renderScene();
+    presentedInput = renderedInput;
+}
+
+void OpenGLWidget::presentFrame()
+{
+    QOpenGLExtraFunctions *f = context()->extraFunctions();
+
+    RenderThread::Slot *frame = renderThread->acquireFrame();
+    if (!frame)
+    {
+        // The render thread is still loading the scene
+        GL_CHECK(f->glClearColor(0.3, 0.33, 0.33, 1));
+        GL_CHECK(f->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+        return;
+    }
+
+    if (frame->rendered)
+    {
+        // Queued on the GPU; the GUI thread does not wait for the frame
+        f->glWaitSync(frame->rendered, 0, GL_TIMEOUT_IGNORED);
+        f->glDeleteSync(frame->rendered);
+        frame->rendered = 0;
+    }
+
+    // Only the first presentation of a frame is measured
+    if (frame->inputTime)
+    {
+        presentedInput = frame->inputTime;
+        frame->inputTime = 0;
+    }
+
+    GL_CHECK(f->glDisable(GL_DEPTH_TEST));
+    GL_CHECK(f->glUseProgram(presentProgram));
+    GL_CHECK(f->glUniform1i(f->glGetUniformLocation(presentProgram, "sceneTexture"), 0));
+    GL_CHECK(f->glUniform2f(f->glGetUniformLocation(presentProgram, "sceneExtent"), 1.0f, 1.0f));
+    GL_CHECK(f->glActiveTexture(GL_TEXTURE0));
+    GL_CHECK(f->glBindTexture(GL_TEXTURE_2D, frame->colorTexture));
+    GL_CHECK(f->glBindVertexArray(presentVao));
+    GL_CHECK(f->glDrawArrays(GL_TRIANGLES, 0, 3));
+    GL_CHECK(f->glBindVertexArray(0));
+    GL_CHECK(f->glEnable(GL_DEPTH_TEST));
+
+    // The render thread waits on this before drawing into the slot again
+    if (frame->presented)
+        f->glDeleteSync(frame->presented);
+    frame->presented = f->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    GL_CHECK(f->glFlush());
+}
+
+void OpenGLWidget::renderScene()
+{
+    PROFILE_ZONE("OpenGLWidget::renderScene");
+    renderedInput = steppedInput;
+    steppedInput = 0;
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glClearColor(0.3, 0.33, 0.33, 1);
 
+    // Swap in chunks the generator finished since the last frame
+    if (roadStream)
+        roadStream->update(travelled);
+
+    // The scene may be drawn smaller and stretched; the HUD stays at full size
+    if (dynamicResolution)
+        dynamicResolution->begin();
+
+    QElapsedTimer submitTimer;
+    submitTimer.start();
+
+    // Static models are either drawn one call each or queued into the batch
+    auto submit = [this](const std::shared_ptr<Model> &model, float posX, float posY, float posZ, float scale, QVector3D rotation) {
+        if (batched)
+            sceneBatch->drawModel(*model, posX, posY, posZ, scale, rotation);
+        else
+            model->drawModel(posX, posY, posZ, scale, rotation);
+    };
+
     if (playerModel)
     {
-        applyLightParams(playerModel);
-        playerModel->drawModel(playerPosX, playerPosY, 0.23f, playerSize, QVector3D(0,0,0));
+        if (!batched)
+            applyLightParams(playerModel);
+        submit(playerModel, playerPosX, playerPosY, 0.23f, playerSize, QVector3D(0,0,0));
     }
 
     if (targetModel)
     {
-        applyLightParams(targetModel);
+        if (!batched)
+            applyLightParams(targetModel);
         for (int i = 0; i < NUM_TARGETS; i++)
-            targetModel->drawModel(targetsPosX[i], targetsPosY[i], 0.45f, targetSize, QVector3D(0,0,0));
+            submit(targetModel, targetsPosX[i], targetsPosY[i], 0.45f, targetSize, QVector3D(0,0,0));
     }
 
-    if (roadModel)
+    if (roadStream && roadModel && roadstripModel)
     {
+        // The streamed road reuses the road and strip materials and shaders
         applyLightParams(roadModel);
-        for (int i = 0; i < 3; i++)
-            roadModel->drawModel(-0.4, roadPosY[i], 0.0, 2.0f, QVector3D(0,0,0));
+        roadStream->drawSurface(roadModel->shaderProgram, travelled);
+        applyLightParams(roadstripModel);
+        roadStream->drawStrips(roadstripModel->shaderProgram, travelled);
     }
 
-    if (roadstripModel)
+    // Grass follows the road edges as the track curves
+    if (grassField)
+        grassField->draw(camera, light, roadStream.get(), travelled);
+
+
+    if (gasTankModel)
     {
-        applyLightParams(roadstripModel);
-        for (int i = 0; i < NUM_STRIPS; i++)
-            roadstripModel->drawModel(0.0, roadstripsPosY[i], 0.06f, 0.15f, QVector3D(0, 0, 0));
+        if (!batched)
+            applyLightParams(gasTankModel);
+        submit(gasTankModel, gasTankPosX, gasTankPosY, 0.4f, gasTankSize, gasTankRotation);
+    }
+
+    if (sceneryModel)
+    {
+        // A few more chunks each frame; the placement is refit to the bounds read so far
+        sceneryModel->updateStream();
+        applyLightParams(sceneryModel);
+        float scale = scenerySize * sceneryModel->invDiag * 0.5f;
+        QVector3D position = QVector3D(4.5f, 10.0f, 1.0f) - sceneryModel->midPoint * scale;
+        sceneryModel->drawModel(position.x(), position.y(), position.z(), scale, QVector3D(0, 0, 0));
     }
 
-    if (grassModel)
+    if (batched)
+        sceneBatch->draw(camera, light);
+
+    submitTimeAccum += submitTimer.nsecsElapsed() / 1.0e6f;
+
+    if (dynamicResolution)
+        dynamicResolution->end();
+
+    if (hud)
     {
-        applyLightParams(grassModel);
-        for(int i = 0; i < NUM_GRASS; i++){
-            if(i % 2 == 0) {
-                grassModel->drawModel(-3.1f, grassPosY[i], 0.06f, 0.3f, QVector3D(0, 0, 0));
-            } else {
-                grassModel->drawModel(3.1f, grassPosY[i], 0.06f, 0.3f, QVector3D(0, 0, 0));
+        // Stats are averaged over half a second so the text does not change every frame
+        frameTimeAccum += frameTimer.nsecsElapsed() / 1.0e6f;
+        frameTimer.restart();
+        framesAccum++;
+        if (frameTimeAccum > 500.0f)
+        {
+            int drawCalls = 0;
+            for (auto model : {playerModel, targetModel, roadModel, roadstripModel, gasTankModel})
+            {
+                drawCalls += model->drawCalls;
+                model->drawCalls = 0;
             }
+            if (sceneryModel)
+            {
+                drawCalls += sceneryModel->drawCalls;
+                sceneryModel->drawCalls = 0;
+            }
+            if (roadStream)
+            {
+                drawCalls += roadStream->drawCalls;
+                roadStream->drawCalls = 0;
+            }
+            if (grassField)
+            {
+                drawCalls += grassField->drawCalls;
+                grassField->drawCalls = 0;
+            }
+            if (sceneBatch)
+            {
+                drawCalls += sceneBatch->drawCalls;
+                sceneBatch->drawCalls = 0;
+            }
+            hud->setStats(frameTimeAccum / framesAccum, drawCalls / framesAccum,
+                          submitTimeAccum / framesAccum, batched);
+            hud->setMemory(ResourceTracker::cpuBytes(), ResourceTracker::gpuBytes());
+            if (dynamicResolution)
+                hud->setResolution(dynamicResolution->scale, dynamicResolution->gpuTimeMs);
+            float p50 = -1.0f, p95 = -1.0f, p99 = -1.0f;
+            InputLatency::percentiles(p50, p95, p99);
+            hud->setLatency(p50, p95, lowLatency);
+            frameTimeAccum = 0;
+            submitTimeAccum = 0;
+            framesAccum = 0;
         }
+        hud->drawHud();
     }
 
+    if (frameCapture)
+        frameCapture->captureFrame();
 
-    if (gasTankModel)
+    if (lowLatency)
     {
-        applyLightParams(gasTankModel);
-        gasTankModel->drawModel(gasTankPosX, gasTankPosY, 0.4f, gasTankSize, gasTankRotation);
+        // Waited on by waitForQueuedFrames MAX_QUEUED_FRAMES frames from now
+        GLsync &fence = queuedFrames[nextQueuedFrame];
+        if (fence)
+            glDeleteSync(fence);
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        nextQueuedFrame = (nextQueuedFrame + 1) % MAX_QUEUED_FRAMES;
     }
 
-    if (lose) {
-        disconnect(&timer, SIGNAL(timeout()), this, SLOT(animate()));
+    if (lose && !renderThread) {
+        disconnect(&timer, SIGNAL(timeout()), this, SLOT(tick()));
     }
 
 }
 
 void OpenGLWidget::keyPressEvent(QKeyEvent *event)
 {
-    if (event->key() == Qt::Key_Left)
+    if (event->key() == Qt::Key_Escape)
+    {
+        QApplication::quit();
+        return;
+    }
+
+    InputLatency::KeyInput input = { event->key(), true, event->isAutoRepeat() ? 0 : InputLatency::now() };
+    // With a render thread the game state is only touched there
+    if (renderThread)
+        renderThread->postKey(input);
+    else if (lowLatency)
+        pendingKeys.push_back(input);
+    else
+        applyKey(input);
+}
+
+void OpenGLWidget::keyReleaseEvent(QKeyEvent *event)
+{
+    InputLatency::KeyInput input = { event->key(), false, event->isAutoRepeat() ? 0 : InputLatency::now() };
+    if (renderThread)
+        renderThread->postKey(input);
+    else if (lowLatency)
+        pendingKeys.push_back(input);
+    else
+        applyKey(input);
+}
+
+void OpenGLWidget::applyKey(const InputLatency::KeyInput &input)
+{
+    if (input.time && !appliedInput)
+        appliedInput = input.time;
+
+    if (input.pressed)
+        handleKeyPress(input.key);
+    else
+        handleKeyRelease(input.key);
+}
+
+void OpenGLWidget::waitForQueuedFrames()
+{
+    GLsync &fence = queuedFrames[nextQueuedFrame];
+    if (!lowLatency || !fence)
+        return;
+
+    PROFILE_ZONE("OpenGLWidget::waitForQueuedFrames");
+    if (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000) == GL_TIMEOUT_EXPIRED)
+        qDebug("OpenGLWidget: GPU still busy with a queued frame after 100 ms");
+    glDeleteSync(fence);
+    fence = 0;
+}
+
+int64_t OpenGLWidget::takeRenderedInput()
+{
+    int64_t input = renderedInput;
+    renderedInput = 0;
+    return input;
+}
+
+void OpenGLWidget::recordLatency()
+{
+    if (presentedInput)
+        InputLatency::addSample(presentedInput);
+    presentedInput = 0;
+}
+
+void OpenGLWidget::tick()
+{
+    // Low-latency mode steps the game in paintGL, right after reading input
+    if (lowLatency)
+        update();
+    else
+        animate();
+}
+
+void OpenGLWidget::requestFrame()
+{
+    // The render thread draws continuously
+    if (!renderThread)
+        update();
+}
+
+void OpenGLWidget::handleKeyPress(int key)
+{
+    if (key == Qt::Key_Left)
     {
         playerPosXOffset = -2.0f*0.48;;
     }
 
-    if (event->key() == Qt::Key_Right)
+    if (key == Qt::Key_Right)
     {
         playerPosXOffset = 2.0f*0.48;;
     }
 
-    if (event->key() == Qt::Key_Escape)
+    if (key == Qt::Key_F1)
     {
-        QApplication::quit();
+        if (hud)
+            hud->toggleStats();
+        requestFrame();
+    }
+
+    if (key == Qt::Key_F3)
+        ResourceTracker::dump();
+
+    if (key == Qt::Key_M)
+    {
+        // Compare submission cost of the two paths on the HUD stats line
+        if (sceneBatch && sceneBatch->isSupported())
+            batched = !batched;
+        else
+            qDebug("Batched submission needs OpenGL 4.3");
+        requestFrame();
+    }
+
+    if (key == Qt::Key_R)
+    {
+        if (dynamicResolution)
+            dynamicResolution->setEnabled(!dynamicResolution->enabled);
+        requestFrame();
+    }
+
+    if (key == Qt::Key_L)
+    {
+        // Each mode gets its own distribution in the log
+        lowLatency = !lowLatency;
+        InputLatency::reset(lowLatency ? "low-latency" : "default");
+        requestFrame();
+    }
+
+    if (key == Qt::Key_F9)
+        toggleRecording(FrameCapture::Y4m);
+
+    if (key == Qt::Key_F10)
+        toggleRecording(FrameCapture::Png);
+
+    if (key == Qt::Key_F12)
+    {
+        // Timeline of everything recorded so far, for chrome://tracing
+        Profiler::dumpChromeTrace(QString("roadblock-trace-%1.json")
+                                  .arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss")));
     }
 
 }
 
-void OpenGLWidget::keyReleaseEvent(QKeyEvent *event)
+void OpenGLWidget::handleKeyRelease(int key)
 {
-    if (event->key() == Qt::Key_Left)
+    if (key == Qt::Key_Left)
         playerPosXOffset = 0;
 
-    if (event->key() == Qt::Key_Right)
+    if (key == Qt::Key_Right)
         playerPosXOffset = 0;
 }
 
 void OpenGLWidget::animate()
 {
+    PROFILE_ZONE("OpenGLWidget::animate");
+    // Input handled since the last step is on screen from the next frame drawn
+    if (!steppedInput)
+        steppedInput = appliedInput;
+    appliedInput = 0;
+
     float elapsedTime = time.restart() / 300.0f;
     elapsedTime += elapsedTime * score/500;
     // Change player X position
@@ -228,35 +621,10 @@ void OpenGLWidget::animate()
 
     // Check bounds
     // player
-    if (playerPosX < -2.0f)
-        playerPosX = -2.0f;
-    if (playerPosX > 2.0f)
-        playerPosX = 2.0f;
+    clampToRoad(playerPosY, 0.3f, playerPosX);
 
     // road
-    for (int i = 0; i < 3; i++) {
-        if (roadPosY[i] < -2.5f){
-            roadPosY[i] = 4.0f;
-        } else {
-            roadPosY[i] += targetPosYOffset * elapsedTime;
-        }
-    }
-    // roadstrips
-    for (int i = 0; i < 8; i++) {
-        if (roadstripsPosY[i] < -4.0f){
-            roadstripsPosY[i] = 8.0f;
-        } else {
-            roadstripsPosY[i] += targetPosYOffset * elapsedTime;
-        }
-    }
-    // grass
-    for (int i = 0; i < NUM_GRASS; i++) {
-        if (grassPosY[i] < -3.0f) {
-            grassPosY[i] = 7.8f;
-        } else {
-            grassPosY[i] += targetPosYOffset * elapsedTime;
-        }
-    }
+    travelled -= targetPosYOffset * elapsedTime;
 
     // gastank throw logic
     if (gasTankPosY < -4.0f) {
@@ -275,17 +643,19 @@ void OpenGLWidget::animate()
     } else {
         gasTankPosY += targetPosYOffset * elapsedTime * 1.1f;
     }
-    if (gasTankPosX < -2.0f)
-        gasTankPosX = -2.0f;
-    if (gasTankPosX > 2.0f)
-        gasTankPosX = 2.0f;
+    clampToRoad(gasTankPosY, 0.3f, gasTankPosX);
 
 
     //targets
     srand((unsigned int) time.currentTime().msec());
     for (int i = 0; i < NUM_TARGETS; i++)
     {
-        if (targetsPosY[i] < -8.0f) {
+        float obstacleX, obstacleDistance;
+        if (targetsPosY[i] < -8.0f && roadStream && roadStream->nextObstacle(travelled + 8.0f, obstacleX, obstacleDistance)) {
+            // Place the barrier where the generated layout wants it
+            targetsPosX[i] = obstacleX;
+            targetsPosY[i] = obstacleDistance - travelled;
+        } else if (targetsPosY[i] < -8.0f) {
             double r = ((double) rand()/(RAND_MAX)) + 1;
             targetsPosY[i] = 8.0f + 4.0f*r;
             if (i) r *= -1;
@@ -301,18 +671,23 @@ void OpenGLWidget::animate()
     }
 
     // check player contact
-    //gastank
-    float distance;
-    distance = calculateDistance(playerPosX, playerPosY, gasTankPosX, gasTankPosY);
-    if (distance < 0.3f) {
-        gasTankPosY = -3.0f;
-        gasAvailable += 25;
-        totalTime = 0;
-    }
-    // barrier
-    for (int i = 0; i < NUM_TARGETS; i++) {
-        distance = calculateDistance(playerPosX, playerPosY, targetsPosX[i], targetsPosY[i]);
-        if (distance < 0.4f)
+    {
+        PROFILE_ZONE("OpenGLWidget::collisions");
+        //gastank
+        if (hitsPlayer(gasTankModel, gasTankPosX, gasTankPosY, 0.4f, gasTankSize, gasTankRotation, 0.3f)) {
+            gasTankPosY = -3.0f;
+            gasAvailable += 25;
+            totalTime = 0;
+        }
+        // barrier, split into jobs once there are enough of them for the BVH tests to pay off
+        std::atomic<bool> hitBarrier(false);
+        jobSystem->parallelFor("OpenGLWidget::barrierCollisions", NUM_TARGETS, COLLISION_GRAIN, [&](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                if (hitsPlayer(targetModel, targetsPosX[i], targetsPosY[i], 0.45f, targetSize, QVector3D(0,0,0), 0.4f))
+                    hitBarrier = true;
+            }
+        });
+        if (hitBarrier)
             lose = 1;
     }
 
@@ -328,14 +703,17 @@ void OpenGLWidget::animate()
 
     score += 0.1;
     int scoreLabel = score;
+    // The HUD only rebuilds its text when one of these values changes
+    if (hud)
+        hud->setScore(scoreLabel, gasAvailable, lose);
     if (lose) {
         finalScore = scoreLabel;
         emit updateScoreLabel(QString("You Lose! Distance: %1").arg(finalScore));
+        requestFrame();
     } else {
-        emit updateScoreLabel(QString("Distance:%1 \t Fuel:%2").arg(scoreLabel).arg(gasAvailable));
         if (NUM_TARGETS < 30)
             NUM_TARGETS = score/300;
-        update();
+        requestFrame();
     }
 }
 
@@ -343,3 +721,43 @@ float OpenGLWidget::calculateDistance(float x1, float y1, float x2, float y2)
 {
     return sqrt(pow(x1-x2, 2) + pow(y1-y2, 2));
 }
+
+void OpenGLWidget::toggleRecording(FrameCapture::Format format)
+{
+    if (!frameCapture)
+        return;
+
+    if (frameCapture->isRecording())
+    {
+        frameCapture->stop();
+        return;
+    }
+
+    QString name = QString("roadblock-%1").arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss"));
+    if (format == FrameCapture::Y4m)
+        name += ".y4m";
+    frameCapture->start(name, format, frameWidth, frameHeight);
+}
+
+bool OpenGLWidget::hitsPlayer(const std::shared_ptr<Model> &model, float posX, float posY, float posZ, float scale,
+                              QVector3D rotation, float fallbackRadius)
+{
+    // Meshes drawn where paintGL draws them, tested triangle against triangle
+    if (playerModel && model && !playerModel->bvh.isEmpty() && !model->bvh.isEmpty())
+        return MeshBvh::overlaps(playerModel->bvh, Model::transform(playerPosX, playerPosY, 0.23f, playerSize, QVector3D(0,0,0)),
+                                 model->bvh, Model::transform(posX, posY, posZ, scale, rotation));
+
+    return calculateDistance(playerPosX, playerPosY, posX, posY) < fallbackRadius;
+}
+
+void OpenGLWidget::clampToRoad(float posY, float margin, float &posX)
+{
+    float centre = 0.0f, halfWidth = 2.0f + margin;
+    if (roadStream)
+        roadStream->roadAt(travelled + posY, centre, halfWidth);
+
+    if (posX < centre - halfWidth + margin)
+        posX = centre - halfWidth + margin;
+    if (posX > centre + halfWidth - margin)
+        posX = centre + halfWidth - margin;
+}
@@ -6,26 +6,74 @@
 #include <QOpenGLExtraFunctions>
 #include <QDebug>
 
+#include <deque>
 #include <memory>
 #include <model.h>
 
 #include "camera.h"
+#include "dynamicresolution.h"
 #include "light.h"
+#include "framecapture.h"
+#include "grassfield.h"
+#include "hud.h"
+#include "inputlatency.h"
+#include "profiler.h"
+#include "renderthread.h"
+#include "roadstream.h"
+#include "scenebatch.h"
 
 class OpenGLWidget : public QOpenGLWidget, protected QOpenGLExtraFunctions
 {
     Q_OBJECT
 
     int NUM_TARGETS = 3;
-    int NUM_STRIPS = 8;
-    int NUM_GRASS = 4;
+    static const int COLLISION_GRAIN = 8; // Barriers per job in the collision checks
+
+    std::shared_ptr<ShaderLibrary> shaderLibrary = nullptr;
 
     std::shared_ptr<Model> playerModel = nullptr;
     std::shared_ptr<Model> targetModel = nullptr;
     std::shared_ptr<Model> roadModel = nullptr;
     std::shared_ptr<Model> roadstripModel = nullptr;
-    std::shared_ptr<Model> grassModel = nullptr;
     std::shared_ptr<Model> gasTankModel = nullptr;
+    std::shared_ptr<Model> sceneryModel = nullptr; // --scenery <file.off>, loaded progressively
+
+    float scenerySize = 4.0f; // Bounding box diagonal the scenery is scaled to
+
+    std::shared_ptr<Hud> hud = nullptr;
+    std::shared_ptr<RoadStream> roadStream = nullptr;
+    std::shared_ptr<GrassField> grassField = nullptr;
+    std::shared_ptr<JobSystem> jobSystem = nullptr; // Shared by whichever thread steps and draws
+    std::shared_ptr<SceneBatch> sceneBatch = nullptr;
+    bool batched = false; // Static models go through sceneBatch (key M)
+    std::shared_ptr<FrameCapture> frameCapture = nullptr;
+    std::shared_ptr<DynamicResolution> dynamicResolution = nullptr;
+
+    // --render-thread: the scene above is created, stepped and drawn by
+    // renderThread, and paintGL only shows its newest frame
+    std::unique_ptr<RenderThread> renderThread;
+    std::shared_ptr<ShaderLibrary> presentShaders = nullptr;
+    GLuint presentProgram = 0;
+    GLuint presentVao = 0;
+
+    int frameWidth = 1; // Pixels, for recordings
+    int frameHeight = 1;
+
+    // Low-latency mode (key L, --low-latency): the game is stepped right
+    // before drawing with the input read after waiting for the GPU to finish
+    // all but MAX_QUEUED_FRAMES - 1 earlier frames, so input is not read
+    // early and then left waiting behind queued frames
+    static const int MAX_QUEUED_FRAMES = 1;
+    bool lowLatency = false;
+    GLsync queuedFrames[MAX_QUEUED_FRAMES] = {};
+    int nextQueuedFrame = 0;
+    std::deque<InputLatency::KeyInput> pendingKeys; // Without a render thread, read in paintGL
+
+    // InputLatency stamp of the oldest input not yet on screen, by stage
+    int64_t appliedInput = 0;   // Handled, the game has not stepped since
+    int64_t steppedInput = 0;   // Stepped, not drawn yet
+    int64_t renderedInput = 0;  // In the frame just drawn
+    int64_t presentedInput = 0; // GUI thread, in the frame being swapped
 
     float playerPosXOffset; // Player displacement along Y axis
     float playerPosYOffset;
@@ -33,10 +81,7 @@ class OpenGLWidget : public QOpenGLWidget, protected QOpenGLExtraFunctions
     float playerPosY;
     float playerSize;
 
-    std::unique_ptr<float[]> roadPosY;
-    std::unique_ptr<float[]> roadstripsPosY;
-
-    std::unique_ptr<float[]> grassPosY;
+    float travelled; // Distance driven along the streamed road
 
     float targetPosYOffset = -0.7;
     float targetSize;
@@ -58,6 +103,11 @@ class OpenGLWidget : public QOpenGLWidget, protected QOpenGLExtraFunctions
     int finalScore;
     int lose;
 
+    QElapsedTimer frameTimer; // Frame statistics shown by the HUD
+    float frameTimeAccum;
+    float submitTimeAccum;
+    int framesAccum;
+
 public:
     explicit OpenGLWidget(QWidget *parent = nullptr);
     ~OpenGLWidget();
@@ -65,6 +115,23 @@ public:
     void applyLightParams(std::shared_ptr<Model> model);
 
     float calculateDistance(float x1, float y1, float x2, float y2);
+    void clampToRoad(float posY, float margin, float &posX);
+    void toggleRecording(FrameCapture::Format format);
+
+    // Called from paintGL and friends, or from the render thread with its context current
+    void initializeScene();
+    void resizeScene(int width, int height, qreal pixelRatio);
+    void renderScene();
+    void releaseScene();
+    void handleKeyPress(int key);
+    void handleKeyRelease(int key);
+    void applyKey(const InputLatency::KeyInput &input);
+    void waitForQueuedFrames();
+    int64_t takeRenderedInput();
+    bool isGameOver() const { return lose; }
+    void requestFrame();
+    bool hitsPlayer(const std::shared_ptr<Model> &model, float posX, float posY, float posZ, float scale,
+                    QVector3D rotation, float fallbackRadius);
 
     Camera camera;
     Light light;
@@ -74,12 +141,16 @@ protected:
     void resizeGL(int width, int height);
     void paintGL();
 
+    void presentFrame();
+
     void keyPressEvent(QKeyEvent *event);
     void keyReleaseEvent(QKeyEvent *event);
 signals:
     void updateScoreLabel(QString);
 public slots:
     void animate();
+    void tick();
+    void recordLatency();
 };
 
 #endif // OPENGLWIDGET_H
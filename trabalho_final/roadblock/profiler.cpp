@@ -0,0 +1,172 @@
+#include "profiler.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QTextStream>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef ROADBLOCK_PROFILE
+
+namespace
+{
+    // One per recording thread. Only the owner writes events; head counts every
+    // event ever written so a reader can tell which slots are still valid.
+    struct ThreadBuffer
+    {
+        int id = 0;
+        const char *name = nullptr;
+        std::unique_ptr<Profiler::Event[]> events;
+        std::atomic<uint64_t> head;
+    };
+
+    // Buffers outlive their threads so the road generator still shows up in a
+    // dump taken after it exited. The lock is only taken to register a thread
+    // and to dump, never while recording.
+    std::mutex buffersMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+    const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+    QString traceFile;
+
+    ThreadBuffer *threadBuffer()
+    {
+        thread_local ThreadBuffer *buffer = nullptr;
+        if (!buffer)
+        {
+            std::unique_ptr<ThreadBuffer> created = std::make_unique<ThreadBuffer>();
+            created->events = std::make_unique<Profiler::Event[]>(Profiler::RING_SIZE);
+            created->head.store(0, std::memory_order_relaxed);
+
+            std::lock_guard<std::mutex> lock(buffersMutex);
+            created->id = int(buffers.size()) + 1;
+            buffer = created.get();
+            buffers.push_back(std::move(created));
+        }
+        return buffer;
+    }
+}
+
+int64_t Profiler::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Profiler::record(const char *name, int64_t start, int64_t end)
+{
+    ThreadBuffer *buffer = threadBuffer();
+    uint64_t head = buffer->head.load(std::memory_order_relaxed);
+
+    Event &event = buffer->events[head & (RING_SIZE - 1)];
+    event.name = name;
+    event.start = start;
+    event.end = end;
+
+    // Publishes the event to a concurrent dump
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::setThreadName(const char *name)
+{
+    threadBuffer()->name = name;
+}
+
+bool Profiler::dumpChromeTrace(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::WriteOnly | QFile::Text | QFile::Truncate))
+    {
+        qDebug() << "Profiler: cannot write" << fileName;
+        return false;
+    }
+
+    QTextStream stream(&file);
+    stream << "{\"traceEvents\":[\n";
+
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    bool first = true;
+    int numEvents = 0;
+    std::vector<Event> copy;
+    for (const std::unique_ptr<ThreadBuffer> &buffer : buffers)
+    {
+        if (buffer->name)
+        {
+            stream << (first ? "" : ",\n")
+                   << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id
+                   << ",\"args\":{\"name\":\"" << buffer->name << "\"}}";
+            first = false;
+        }
+
+        // Copy the live window, then drop whatever the owner overwrote meanwhile
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t begin = head > uint64_t(RING_SIZE) ? head - RING_SIZE : 0;
+        copy.clear();
+        for (uint64_t i = begin; i < head; ++i)
+            copy.push_back(buffer->events[i & (RING_SIZE - 1)]);
+
+        // The owner may already be writing slot newHead, which is also the oldest copied one
+        uint64_t newHead = buffer->head.load(std::memory_order_acquire);
+        uint64_t valid = newHead >= uint64_t(RING_SIZE) ? newHead - RING_SIZE + 1 : 0;
+        size_t skip = valid > begin ? size_t(valid - begin) : 0;
+
+        for (size_t i = skip; i < copy.size(); ++i)
+        {
+            const Event &event = copy[i];
+            stream << (first ? "" : ",\n")
+                   << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id
+                   << ",\"ts\":" << QString::number(event.start / 1000.0, 'f', 3)
+                   << ",\"dur\":" << QString::number((event.end - event.start) / 1000.0, 'f', 3) << "}";
+            first = false;
+            numEvents++;
+        }
+    }
+
+    stream << "\n]}\n";
+    qDebug("Profiler: %d events from %d threads written to %s",
+           numEvents, int(buffers.size()), qPrintable(fileName));
+    return true;
+}
+
+#else
+
+int64_t Profiler::now()
+{
+    return 0;
+}
+
+void Profiler::record(const char *, int64_t, int64_t)
+{
+}
+
+void Profiler::setThreadName(const char *)
+{
+}
+
+bool Profiler::dumpChromeTrace(const QString &)
+{
+    qDebug("Profiler: built without ROADBLOCK_PROFILE, rebuild with qmake CONFIG+=profile");
+    return false;
+}
+
+namespace
+{
+    QString traceFile;
+}
+
+#endif
+
+void Profiler::setTraceFile(const QString &fileName)
+{
+    traceFile = fileName;
+}
+
+void Profiler::dumpOnExit()
+{
+    if (!traceFile.isEmpty())
+        dumpChromeTrace(traceFile);
+}
@@ -0,0 +1,64 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <QString>
+
+#include <stdint.h>
+
+// CPU timeline instrumentation. PROFILE_ZONE("name") times the rest of the
+// enclosing scope and appends it to a ring buffer owned by the calling
+// thread, so recording takes no lock and never allocates. dumpChromeTrace
+// writes every buffer as trace-event JSON that chrome://tracing or Perfetto
+// can open.
+//
+// Zones are only compiled in when ROADBLOCK_PROFILE is defined (qmake
+// CONFIG+=profile); otherwise the macros expand to nothing and the dump
+// functions just report that profiling is disabled.
+namespace Profiler
+{
+    // Events kept per thread; older ones are overwritten
+    static const int RING_SIZE = 1 << 16;
+
+    struct Event
+    {
+        const char *name; // Must be a string literal, only the pointer is stored
+        int64_t start;    // Nanoseconds since the profiler epoch
+        int64_t end;
+    };
+
+    int64_t now();
+    void record(const char *name, int64_t start, int64_t end);
+    void setThreadName(const char *name);
+
+    bool dumpChromeTrace(const QString &fileName);
+
+    // File written by dumpOnExit, set from --trace <file>
+    void setTraceFile(const QString &fileName);
+    void dumpOnExit();
+
+#ifdef ROADBLOCK_PROFILE
+    class Zone
+    {
+    public:
+        Zone(const char *_name) : name(_name), start(now()) {}
+        ~Zone() { record(name, start, now()); }
+
+        Zone(const Zone &) = delete;
+        Zone &operator=(const Zone &) = delete;
+
+    private:
+        const char *name;
+        int64_t start;
+    };
+#endif
+}
+
+#ifdef ROADBLOCK_PROFILE
+#define PROFILE_ZONE(name) Profiler::Zone profileZone(name)
+#define PROFILE_THREAD(name) Profiler::setThreadName(name)
+#else
+#define PROFILE_ZONE(name) do {} while (0)
+#define PROFILE_THREAD(name) do {} while (0)
+#endif
+
+#endif // PROFILER_H
@@ -0,0 +1,203 @@
+#include "renderthread.h"
+
+#include <algorithm>
+
+#include "openglwidget.h"
+
+RenderThread::RenderThread(OpenGLWidget *_widget, QOpenGLContext *shareContext, qreal refreshRate)
+    : latest(2), stopping(false)
+{
+    widget = _widget;
+    frameInterval = static_cast<qint64>(1.0e9 / (refreshRate > 0.0 ? refreshRate : 60.0));
+
+    // Both are made here on the GUI thread; the surface has to stay here too
+    context = new QOpenGLContext();
+    context->setFormat(shareContext->format());
+    context->setShareContext(shareContext);
+    if (!context->create())
+        qDebug("RenderThread: cannot create a shared context");
+    context->moveToThread(this);
+
+    surface = new QOffscreenSurface();
+    surface->setFormat(context->format());
+    surface->create();
+}
+
+RenderThread::~RenderThread()
+{
+    stop();
+    delete context; // Only left when the thread never ran
+    delete surface;
+}
+
+void RenderThread::stop()
+{
+    stopping = true;
+    wait();
+}
+
+void RenderThread::resize(int _width, int _height)
+{
+    std::lock_guard<std::mutex> lock(inputMutex);
+    pendingWidth = _width;
+    pendingHeight = _height;
+    resized = true;
+}
+
+void RenderThread::postKey(const InputLatency::KeyInput &input)
+{
+    std::lock_guard<std::mutex> lock(inputMutex);
+    keys.push_back(input);
+}
+
+RenderThread::Slot *RenderThread::acquireFrame()
+{
+    // Hand the held slot back and take the newest one in the same exchange
+    if (latest.load() & FRESH)
+    {
+        front = latest.exchange(front) & ~FRESH;
+        presentedAny = true;
+    }
+    return presentedAny ? &slots[front] : nullptr;
+}
+
+void RenderThread::applyInput()
+{
+    std::deque<InputLatency::KeyInput> pending;
+    bool resize = false;
+    {
+        std::lock_guard<std::mutex> lock(inputMutex);
+        pending.swap(keys);
+        resize = resized;
+        resized = false;
+        if (resize)
+        {
+            width = std::max(pendingWidth, 1);
+            height = std::max(pendingHeight, 1);
+        }
+    }
+
+    if (resize)
+        widget->resizeScene(width, height, 1.0);
+    for (const InputLatency::KeyInput &input : pending)
+        widget->applyKey(input);
+}
+
+void RenderThread::createSlot(Slot &slot)
+{
+    destroySlot(slot);
+    slot.width = width;
+    slot.height = height;
+
+    GL_CHECK(glGenTextures(1, &slot.colorTexture));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, slot.colorTexture));
+    GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, 0));
+
+    GL_CHECK(glGenRenderbuffers(1, &slot.depthBuffer));
+    GL_CHECK(glBindRenderbuffer(GL_RENDERBUFFER, slot.depthBuffer));
+    GL_CHECK(glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height));
+    GL_CHECK(glBindRenderbuffer(GL_RENDERBUFFER, 0));
+
+    GL_CHECK(glGenFramebuffers(1, &slot.fbo));
+    GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, slot.fbo));
+    GL_CHECK(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, slot.colorTexture, 0));
+    GL_CHECK(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, slot.depthBuffer));
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        qDebug("RenderThread: frame buffer incomplete");
+
+    const QString resource = QString("slot%1").arg(&slot - slots);
+    ResourceTracker::set("RenderThread", resource + " color", ResourceTracker::Texture, qint64(width) * height * 4);
+    ResourceTracker::set("RenderThread", resource + " depth", ResourceTracker::Renderbuffer, qint64(width) * height * 4);
+}
+
+void RenderThread::destroySlot(Slot &slot)
+{
+    if (slot.rendered)
+        glDeleteSync(slot.rendered);
+    if (slot.presented)
+        glDeleteSync(slot.presented);
+    GL_CHECK(glDeleteFramebuffers(1, &slot.fbo));
+    GL_CHECK(glDeleteTextures(1, &slot.colorTexture));
+    GL_CHECK(glDeleteRenderbuffers(1, &slot.depthBuffer));
+    slot = Slot();
+}
+
+void RenderThread::run()
+{
+    PROFILE_THREAD("Render");
+
+    context->makeCurrent(surface);
+    initializeOpenGLFunctions();
+    qDebug("RenderThread: rendering at %.1f Hz", 1.0e9 / frameInterval);
+
+    widget->initializeScene();
+
+    QElapsedTimer clock;
+    clock.start();
+    qint64 nextFrame = clock.nsecsElapsed();
+
+    while (!stopping)
+    {
+        // Paced on this thread's clock, whatever the GUI thread is doing. The
+        // wait comes before input is read so a frame starts with the freshest.
+        qint64 now = clock.nsecsElapsed();
+        if (nextFrame > now)
+            QThread::usleep(static_cast<unsigned long>((nextFrame - now) / 1000));
+        else
+            nextFrame = now; // Late: start again from here instead of catching up
+        nextFrame += frameInterval;
+
+        PROFILE_ZONE("RenderThread::frame");
+        widget->waitForQueuedFrames();
+        applyInput();
+
+        Slot &slot = slots[back];
+        if (slot.presented)
+        {
+            // paintGL may still be sampling it; the GPU waits, not this thread
+            glWaitSync(slot.presented, 0, GL_TIMEOUT_IGNORED);
+            glDeleteSync(slot.presented);
+            slot.presented = 0;
+        }
+        int64_t droppedInput = 0;
+        if (slot.rendered)
+        {
+            // Replaced by a newer frame before paintGL took it; its input shows in this one
+            glDeleteSync(slot.rendered);
+            slot.rendered = 0;
+            droppedInput = slot.inputTime;
+        }
+        if (slot.width != width || slot.height != height)
+            createSlot(slot);
+
+        GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, slot.fbo));
+        GL_CHECK(glViewport(0, 0, width, height));
+
+        if (!widget->isGameOver())
+            widget->animate();
+        widget->renderScene();
+        int64_t renderedInput = widget->takeRenderedInput();
+        slot.inputTime = droppedInput ? droppedInput : renderedInput;
+
+        slot.rendered = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        // The fence has to reach the GPU before the widget's context waits on it
+        GL_CHECK(glFlush());
+        back = latest.exchange(back | FRESH) & ~FRESH;
+        QMetaObject::invokeMethod(widget, "update", Qt::QueuedConnection);
+    }
+
+    // Scene objects hold names from this context and are released with it current
+    widget->releaseScene();
+    for (Slot &slot : slots)
+        destroySlot(slot);
+    ResourceTracker::releaseOwner("RenderThread");
+
+    context->doneCurrent();
+    delete context;
+    context = nullptr;
+}
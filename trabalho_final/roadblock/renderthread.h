@@ -0,0 +1,95 @@
+#ifndef RENDERTHREAD_H
+#define RENDERTHREAD_H
+
+#include <QtOpenGL>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QThread>
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+
+#include "inputlatency.h"
+#include "profiler.h"
+#include "resourcetracker.h"
+#include "util.h"
+
+class OpenGLWidget;
+
+// Alternate backend, roadblock3D --render-thread. The thread owns a context
+// sharing objects with the widget's, steps the game and draws each frame into
+// the back slot of a triple buffer of framebuffers, paced to the display
+// rate on its own clock. A finished frame is published with one atomic
+// exchange; paintGL takes the newest one and draws its colour texture, which
+// both contexts see. A fence placed after the frame is drawn and another
+// after it is presented make each side's GPU wait for the other, so neither
+// thread ever blocks on the handoff.
+//
+// Input and resizes reach the thread through a small locked queue it drains
+// once per frame, right after the pacing wait so the step sees the newest.
+class RenderThread : public QThread, protected QOpenGLExtraFunctions
+{
+public:
+    RenderThread(OpenGLWidget *_widget, QOpenGLContext *shareContext, qreal refreshRate);
+    ~RenderThread();
+
+    static const int NUM_SLOTS = 3;
+
+    struct Slot
+    {
+        GLuint fbo = 0; // Belongs to the render context
+        GLuint colorTexture = 0;
+        GLuint depthBuffer = 0;
+        int width = 0;
+        int height = 0;
+        GLsync rendered = 0;  // Placed by the render thread, waited on by paintGL
+        GLsync presented = 0; // Placed by paintGL, waited on by the render thread
+        int64_t inputTime = 0; // InputLatency stamp of the input it is the first to show
+    };
+
+    // GUI thread
+    void stop();
+    void resize(int width, int height);
+    void postKey(const InputLatency::KeyInput &input);
+
+    // GUI thread, from paintGL. acquireFrame returns the newest finished
+    // frame, or the one already held when nothing newer is ready; nullptr
+    // before the first. The slot stays with paintGL until a newer frame
+    // replaces it.
+    Slot *acquireFrame();
+
+protected:
+    void run() override;
+
+private:
+    static const int FRESH = 4; // Set in latest while its slot has not been taken
+
+    OpenGLWidget *widget;
+    QOpenGLContext *context = nullptr;
+    QOffscreenSurface *surface = nullptr;
+    qint64 frameInterval; // Nanoseconds
+
+    Slot slots[NUM_SLOTS];
+    std::atomic<int> latest; // Slot index, plus FRESH
+    int back = 0;  // Only touched by the render thread
+    int front = 1; // Only touched by paintGL
+    bool presentedAny = false;
+
+    std::atomic<bool> stopping;
+
+    std::mutex inputMutex;
+    std::deque<InputLatency::KeyInput> keys;
+    int pendingWidth = 0;
+    int pendingHeight = 0;
+    bool resized = false;
+    int width = 1;
+    int height = 1;
+
+    void applyInput();
+    void createSlot(Slot &slot);
+    void destroySlot(Slot &slot);
+};
+
+#endif // RENDERTHREAD_H
@@ -0,0 +1,134 @@
+#include "resourcetracker.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <utility>
+
+namespace
+{
+    struct Entry
+    {
+        ResourceTracker::Kind kind;
+        qint64 bytes;
+        qint64 wastedBytes;
+    };
+
+    // Ordered by owner so a dump groups them without sorting
+    std::mutex entriesMutex;
+    std::map<std::pair<QString, QString>, Entry> entries;
+    qint64 totalCpu = 0;
+    qint64 totalGpu = 0;
+    qint64 peakCpu = 0;
+    qint64 peakGpu = 0;
+
+    const char *kindName(ResourceTracker::Kind kind)
+    {
+        switch (kind)
+        {
+        case ResourceTracker::CpuArray: return "cpu array";
+        case ResourceTracker::Buffer: return "buffer";
+        case ResourceTracker::Texture: return "texture";
+        case ResourceTracker::Renderbuffer: return "renderbuffer";
+        case ResourceTracker::Program: return "program";
+        }
+        return "";
+    }
+
+    void account(const Entry &entry, qint64 sign)
+    {
+        if (entry.kind == ResourceTracker::CpuArray)
+            totalCpu += sign * entry.bytes;
+        else
+            totalGpu += sign * entry.bytes;
+        peakCpu = std::max(peakCpu, totalCpu);
+        peakGpu = std::max(peakGpu, totalGpu);
+    }
+}
+
+void ResourceTracker::set(const QString &owner, const QString &resource, Kind kind, qint64 bytes, qint64 wastedBytes)
+{
+    std::lock_guard<std::mutex> lock(entriesMutex);
+    Entry &entry = entries[std::make_pair(owner, resource)];
+    if (entry.bytes)
+        account(entry, -1);
+    entry.kind = kind;
+    entry.bytes = bytes;
+    entry.wastedBytes = wastedBytes;
+    account(entry, 1);
+}
+
+void ResourceTracker::release(const QString &owner, const QString &resource)
+{
+    std::lock_guard<std::mutex> lock(entriesMutex);
+    auto found = entries.find(std::make_pair(owner, resource));
+    if (found == entries.end())
+        return;
+    account(found->second, -1);
+    entries.erase(found);
+}
+
+void ResourceTracker::releaseOwner(const QString &owner)
+{
+    std::lock_guard<std::mutex> lock(entriesMutex);
+    auto it = entries.lower_bound(std::make_pair(owner, QString()));
+    while (it != entries.end() && it->first.first == owner)
+    {
+        account(it->second, -1);
+        it = entries.erase(it);
+    }
+}
+
+qint64 ResourceTracker::cpuBytes()
+{
+    std::lock_guard<std::mutex> lock(entriesMutex);
+    return totalCpu;
+}
+
+qint64 ResourceTracker::gpuBytes()
+{
+    std::lock_guard<std::mutex> lock(entriesMutex);
+    return totalGpu;
+}
+
+void ResourceTracker::dump()
+{
+    std::lock_guard<std::mutex> lock(entriesMutex);
+
+    auto kb = [](qint64 bytes) { return bytes / 1024.0; };
+    auto line = [&](const char *label, const char *kind, qint64 cpu, qint64 gpu, qint64 wasted) {
+        qDebug("%-24s %-12s %10.1f %10.1f %10.1f", label, kind, kb(cpu), kb(gpu), kb(wasted));
+    };
+
+    qDebug("%-24s %-12s %10s %10s %10s", "resource", "kind", "CPU KB", "GPU KB", "unused KB");
+
+    qint64 wastedTotal = 0;
+    auto it = entries.begin();
+    while (it != entries.end())
+    {
+        const QString owner = it->first.first;
+        auto end = it;
+        qint64 ownerCpu = 0, ownerGpu = 0, ownerWasted = 0;
+        for (; end != entries.end() && end->first.first == owner; ++end)
+        {
+            (end->second.kind == CpuArray ? ownerCpu : ownerGpu) += end->second.bytes;
+            ownerWasted += end->second.wastedBytes;
+        }
+        QByteArray label = owner.toLatin1();
+        line(label.constData(), "", ownerCpu, ownerGpu, ownerWasted);
+        wastedTotal += ownerWasted;
+
+        for (; it != end; ++it)
+        {
+            const Entry &entry = it->second;
+            bool cpu = entry.kind == CpuArray;
+            label = ("  " + it->first.second).toLatin1();
+            line(label.constData(), kindName(entry.kind), cpu ? entry.bytes : 0, cpu ? 0 : entry.bytes, entry.wastedBytes);
+        }
+    }
+
+    line("total", "", totalCpu, totalGpu, wastedTotal);
+    line("peak", "", peakCpu, peakGpu, 0);
+}
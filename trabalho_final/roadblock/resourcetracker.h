@@ -0,0 +1,26 @@
+#ifndef RESOURCETRACKER_H
+#define RESOURCETRACKER_H
+
+#include <QString>
+
+// Bytes held by every named resource, grouped by owner ("car", "Hud", ...).
+// Owners call set() when they allocate or resize something and release()
+// when they free it; GPU sizes are what was requested from GL, so driver
+// padding and the default framebuffer are not included. wastedBytes marks
+// storage nothing reads, like the w of positions that is always 1.
+namespace ResourceTracker
+{
+    enum Kind { CpuArray, Buffer, Texture, Renderbuffer, Program };
+
+    void set(const QString &owner, const QString &resource, Kind kind, qint64 bytes, qint64 wastedBytes = 0);
+    void release(const QString &owner, const QString &resource);
+    void releaseOwner(const QString &owner);
+
+    qint64 cpuBytes();
+    qint64 gpuBytes();
+
+    // Table of every resource with per owner and overall totals (F3)
+    void dump();
+}
+
+#endif // RESOURCETRACKER_H
@@ -23,6 +23,13 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# qmake CONFIG+=profile compiles in the PROFILE_ZONE timers (F12 / --trace)
+profile: DEFINES += ROADBLOCK_PROFILE
+
+# Matrix4 lives with its QMatrix4x4 benchmark in lab01/Ex02 (Ex02 --benchmark)
+MATRIX4_DIR = ../../lab01/Ex02
+INCLUDEPATH += $$MATRIX4_DIR
+
 
 SOURCES += \
         main.cpp \
@@ -31,7 +38,23 @@ SOURCES += \
     model.cpp \
     camera.cpp \
     light.cpp \
-    material.cpp
+    material.cpp \
+    hud.cpp \
+    roadstream.cpp \
+    profiler.cpp \
+    scenebatch.cpp \
+    bvh.cpp \
+    shaderlibrary.cpp \
+    framecapture.cpp \
+    resourcetracker.cpp \
+    offstream.cpp \
+    offformat.cpp \
+    dynamicresolution.cpp \
+    renderthread.cpp \
+    inputlatency.cpp \
+    jobsystem.cpp \
+    grassfield.cpp \
+    $$MATRIX4_DIR/matrix4.cpp
 
 HEADERS += \
         mainwindow.h \
@@ -40,7 +63,23 @@ HEADERS += \
     camera.h \
     light.h \
     material.h \
-    util.h
+    util.h \
+    hud.h \
+    roadstream.h \
+    profiler.h \
+    scenebatch.h \
+    bvh.h \
+    shaderlibrary.h \
+    framecapture.h \
+    resourcetracker.h \
+    offstream.h \
+    offformat.h \
+    dynamicresolution.h \
+    renderthread.h \
+    inputlatency.h \
+    jobsystem.h \
+    grassfield.h \
+    $$MATRIX4_DIR/matrix4.h
 
 FORMS += \
         mainwindow.ui
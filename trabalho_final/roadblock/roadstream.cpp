@@ -0,0 +1,368 @@
+#include "roadstream.h"
+
+#include <string.h>
+
+constexpr float RoadStream::CHUNK_LENGTH;
+constexpr float RoadStream::LANE_WIDTH;
+constexpr float RoadStream::VISIBLE_BEHIND;
+
+RoadStream::RoadStream(QOpenGLWidget *_glWidget)
+    : random(static_cast<unsigned int>(QTime::currentTime().msec()))
+{
+    glWidget = _glWidget;
+    makeGLCurrent(glWidget);
+
+    initializeOpenGLFunctions();
+
+    createVBOs();
+
+    // Fill the visible road before the worker starts so the first frame has a track
+    for (int i = 0; i < NUM_SLOTS; ++i)
+    {
+        std::unique_ptr<RoadChunk> chunk = std::make_unique<RoadChunk>();
+        {
+            PROFILE_ZONE("RoadStream::generateChunk");
+            generateChunk(*chunk);
+        }
+        // A slot that could not be mapped is filled by update() instead
+        if (!uploadChunk(i, *chunk))
+            pending.push_back(*chunk);
+    }
+
+    worker = std::thread(&RoadStream::generateChunks, this);
+}
+
+RoadStream::~RoadStream()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    canGenerate.notify_all();
+    worker.join();
+
+    makeGLCurrent(glWidget);
+    for (int i = 0; i < NUM_SLOTS; ++i)
+    {
+        if (slots[i].fence)
+            glDeleteSync(slots[i].fence);
+    }
+    destroyVBOs();
+}
+
+void RoadStream::createVBOs()
+{
+    destroyVBOs();
+
+    GL_CHECK(glGenVertexArrays(1, &vao));
+    GL_CHECK(glBindVertexArray(vao));
+
+    GL_CHECK(glGenBuffers(1, &vboRing));
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vboRing));
+    GL_CHECK(glBufferData(GL_ARRAY_BUFFER, NUM_SLOTS * RoadChunk::MAX_VERTICES * sizeof(RoadVertex), nullptr, GL_DYNAMIC_DRAW));
+    // Slots are sized for the most dividers and w is always 1
+    ResourceTracker::set("RoadStream", "vboRing", ResourceTracker::Buffer,
+                         NUM_SLOTS * RoadChunk::MAX_VERTICES * sizeof(RoadVertex),
+                         NUM_SLOTS * RoadChunk::MAX_VERTICES * sizeof(float));
+    GL_CHECK(glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(RoadVertex), reinterpret_cast<void *>(offsetof(RoadVertex, position))));
+    GL_CHECK(glEnableVertexAttribArray(0));
+    GL_CHECK(glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(RoadVertex), reinterpret_cast<void *>(offsetof(RoadVertex, normal))));
+    GL_CHECK(glEnableVertexAttribArray(1));
+
+    GL_CHECK(glBindVertexArray(0));
+}
+
+void RoadStream::destroyVBOs()
+{
+    GL_CHECK(glDeleteBuffers(1, &vboRing));
+    GL_CHECK(glDeleteVertexArrays(1, &vao));
+
+    vboRing = 0;
+    vao = 0;
+    ResourceTracker::release("RoadStream", "vboRing");
+}
+
+static void addQuad(RoadVertex *vertices, unsigned int &count, float x0, float x1, float y0, float y1,
+                    float x2, float x3, float z)
+{
+    // (x0, y0) - (x1, y0) - (x3, y1) - (x2, y1), counter-clockwise seen from above
+    const float corners[6][2] = {{x0, y0}, {x1, y0}, {x3, y1}, {x3, y1}, {x2, y1}, {x0, y0}};
+    for (int i = 0; i < 6; ++i)
+    {
+        RoadVertex &v = vertices[count++];
+        v.position[0] = corners[i][0];
+        v.position[1] = corners[i][1];
+        v.position[2] = z;
+        v.position[3] = 1.0f;
+        v.normal[0] = 0.0f;
+        v.normal[1] = 0.0f;
+        v.normal[2] = 1.0f;
+    }
+}
+
+void RoadStream::generateChunk(RoadChunk &chunk)
+{
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const int segments = RoadChunk::SEGMENTS;
+    const float ds = CHUNK_LENGTH / segments;
+
+    chunk.index = nextIndex++;
+    chunk.start = chunk.index * CHUNK_LENGTH - VISIBLE_BEHIND;
+
+    // The first chunks stay straight and empty so the game starts calmly
+    bool calm = chunk.index < 3;
+
+    if (!calm && unit(random) < 0.5f)
+        targetCurvature = (unit(random) * 2.0f - 1.0f) * 0.05f;
+    if (!calm && unit(random) < 0.25f)
+        lanes = lanes == 2 ? 3 : 2;
+
+    // Row 0 repeats the last row of the previous chunk, so chunks join seamlessly
+    for (int k = 0; k <= segments; ++k)
+    {
+        if (k > 0)
+        {
+            curvature += (targetCurvature - curvature) * 0.1f;
+            heading += (curvature - centreX * 0.02f) * ds; // Pull back towards the middle
+            heading = std::max(-0.25f, std::min(heading, 0.25f));
+            centreX += heading * ds;
+            if (std::fabs(centreX) > 1.2f)
+            {
+                centreX = centreX > 0 ? 1.2f : -1.2f;
+                heading = 0;
+            }
+            roadHalfWidth += (lanes * LANE_WIDTH * 0.5f - roadHalfWidth) * 0.05f;
+        }
+        chunk.centre[k] = centreX;
+        chunk.halfWidth[k] = roadHalfWidth;
+    }
+
+    // Road surface, slightly above z = 0 like the road.off tiles
+    chunk.numSurfaceVertices = 0;
+    for (int k = 0; k < segments; ++k)
+    {
+        addQuad(chunk.vertices, chunk.numSurfaceVertices,
+                chunk.centre[k] - chunk.halfWidth[k], chunk.centre[k] + chunk.halfWidth[k], k * ds,
+                (k + 1) * ds,
+                chunk.centre[k + 1] - chunk.halfWidth[k + 1], chunk.centre[k + 1] + chunk.halfWidth[k + 1],
+                0.063f);
+    }
+
+    // Dashed lane dividers, the dash pattern uses the global segment index
+    chunk.numStripVertices = 0;
+    RoadVertex *strips = chunk.vertices + chunk.numSurfaceVertices;
+    for (int j = 1; j < lanes; ++j)
+    {
+        for (int k = 0; k < segments; ++k)
+        {
+            if (((chunk.index * segments + k) / 2) % 2)
+                continue;
+            float x0 = chunk.centre[k] - chunk.halfWidth[k] + j * 2.0f * chunk.halfWidth[k] / lanes;
+            float x1 = chunk.centre[k + 1] - chunk.halfWidth[k + 1] + j * 2.0f * chunk.halfWidth[k + 1] / lanes;
+            addQuad(strips, chunk.numStripVertices, x0 - 0.05f, x0 + 0.05f, k * ds, (k + 1) * ds,
+                    x1 - 0.05f, x1 + 0.05f, 0.066f);
+        }
+    }
+
+    // Obstacle layout: nothing, one block, two staggered blocks or a gate with one open lane
+    chunk.numObstacles = 0;
+    int pattern = calm ? 0 : static_cast<int>(unit(random) * 4.0f);
+    int openLane = static_cast<int>(unit(random) * lanes) % lanes;
+    auto laneX = [&](int k, int lane) {
+        return chunk.centre[k] - chunk.halfWidth[k] + (lane + 0.5f) * 2.0f * chunk.halfWidth[k] / lanes;
+    };
+    switch (pattern)
+    {
+    case 1:
+        chunk.obstacles[chunk.numObstacles++] = QVector2D(laneX(segments / 2, openLane), chunk.start + segments / 2 * ds);
+        break;
+    case 2:
+        chunk.obstacles[chunk.numObstacles++] = QVector2D(laneX(segments / 4, openLane), chunk.start + segments / 4 * ds);
+        chunk.obstacles[chunk.numObstacles++] = QVector2D(laneX(3 * segments / 4, (openLane + 1) % lanes),
+                                                          chunk.start + 3 * segments / 4 * ds);
+        break;
+    case 3:
+        for (int lane = 0; lane < lanes; ++lane)
+        {
+            if (lane != openLane)
+                chunk.obstacles[chunk.numObstacles++] = QVector2D(laneX(segments / 2, lane), chunk.start + segments / 2 * ds);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void RoadStream::generateChunks()
+{
+    PROFILE_THREAD("RoadStream");
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            canGenerate.wait(lock, [this] { return stopping || pending.size() < MAX_PENDING; });
+            if (stopping)
+                return;
+        }
+
+        std::unique_ptr<RoadChunk> chunk = std::make_unique<RoadChunk>();
+        {
+            PROFILE_ZONE("RoadStream::generateChunk");
+            generateChunk(*chunk);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(*chunk);
+    }
+}
+
+bool RoadStream::uploadChunk(int slot, const RoadChunk &chunk)
+{
+    const GLsizeiptr slotSize = RoadChunk::MAX_VERTICES * sizeof(RoadVertex);
+    const GLsizeiptr size = (chunk.numSurfaceVertices + chunk.numStripVertices) * sizeof(RoadVertex);
+
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vboRing));
+    // The slot fence has already signalled, so the range can be written unsynchronized
+    void *data = glMapBufferRange(GL_ARRAY_BUFFER, slot * slotSize, slotSize,
+                                  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!data)
+    {
+        qDebug("RoadStream: could not map slot %d", slot);
+        return false;
+    }
+    memcpy(data, chunk.vertices, size);
+    GL_CHECK(glUnmapBuffer(GL_ARRAY_BUFFER));
+
+    Slot &s = slots[slot];
+    s.live = true;
+    s.index = chunk.index;
+    s.start = chunk.start;
+    memcpy(s.centre, chunk.centre, sizeof(s.centre));
+    memcpy(s.halfWidth, chunk.halfWidth, sizeof(s.halfWidth));
+    s.numSurfaceVertices = chunk.numSurfaceVertices;
+    s.numStripVertices = chunk.numStripVertices;
+
+    for (int i = 0; i < chunk.numObstacles; ++i)
+        obstacles.push_back(chunk.obstacles[i]);
+    return true;
+}
+
+void RoadStream::update(float travelled)
+{
+    // Retire chunks that scrolled out of view, the fence marks their last use
+    for (int i = 0; i < NUM_SLOTS; ++i)
+    {
+        Slot &s = slots[i];
+        if (s.live && s.start + CHUNK_LENGTH < travelled - VISIBLE_BEHIND)
+        {
+            s.live = false;
+            s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+    }
+
+    while (!obstacles.empty() && obstacles.front().y() < travelled - VISIBLE_BEHIND)
+        obstacles.pop_front();
+
+    for (int i = 0; i < NUM_SLOTS; ++i)
+    {
+        Slot &s = slots[i];
+        if (s.live)
+            continue;
+
+        if (s.fence)
+        {
+            // Never wait: a slot still in flight is simply refilled next frame
+            if (glClientWaitSync(s.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+                continue;
+            glDeleteSync(s.fence);
+            s.fence = 0;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (pending.empty())
+            break;
+        RoadChunk &chunk = pending.front();
+        lock.unlock();
+
+        // Only the worker pushes, so the front stays valid while it is copied.
+        // A failed map leaves the chunk queued for the next frame.
+        if (!uploadChunk(i, chunk))
+            break;
+
+        lock.lock();
+        pending.pop_front();
+        lock.unlock();
+        canGenerate.notify_one();
+    }
+}
+
+void RoadStream::drawRange(GLuint program, float travelled, bool strips)
+{
+    GL_CHECK(glBindVertexArray(vao));
+    GL_CHECK(glUseProgram(program));
+
+    GLint locModel = glGetUniformLocation(program, "model");
+    GLint locNormalMatrix = glGetUniformLocation(program, "normalMatrix");
+
+    QMatrix3x3 normalMatrix;
+    GL_CHECK(glUniformMatrix3fv(locNormalMatrix, 1, GL_FALSE, normalMatrix.constData()));
+
+    for (int i = 0; i < NUM_SLOTS; ++i)
+    {
+        const Slot &s = slots[i];
+        unsigned int count = strips ? s.numStripVertices : s.numSurfaceVertices;
+        if (!s.live || !count)
+            continue;
+
+        Matrix4 modelMatrix = Matrix4::translation(0.0f, s.start - travelled, 0.0f);
+        GL_CHECK(glUniformMatrix4fv(locModel, 1, GL_FALSE, modelMatrix.data()));
+
+        GLint first = i * RoadChunk::MAX_VERTICES + (strips ? s.numSurfaceVertices : 0);
+        GL_CHECK(glDrawArrays(GL_TRIANGLES, first, count));
+        drawCalls++;
+    }
+}
+
+void RoadStream::drawSurface(GLuint program, float travelled)
+{
+    drawRange(program, travelled, false);
+}
+
+void RoadStream::drawStrips(GLuint program, float travelled)
+{
+    drawRange(program, travelled, true);
+}
+
+bool RoadStream::roadAt(float distance, float &centre, float &halfWidth)
+{
+    const float ds = CHUNK_LENGTH / RoadChunk::SEGMENTS;
+
+    for (int i = 0; i < NUM_SLOTS; ++i)
+    {
+        const Slot &s = slots[i];
+        if (!s.live || distance < s.start || distance >= s.start + CHUNK_LENGTH)
+            continue;
+
+        float t = (distance - s.start) / ds;
+        int k = std::min(static_cast<int>(t), RoadChunk::SEGMENTS - 1);
+        t -= k;
+        centre = s.centre[k] + (s.centre[k + 1] - s.centre[k]) * t;
+        halfWidth = s.halfWidth[k] + (s.halfWidth[k + 1] - s.halfWidth[k]) * t;
+        return true;
+    }
+    return false;
+}
+
+bool RoadStream::nextObstacle(float minDistance, float &x, float &distance)
+{
+    while (!obstacles.empty() && obstacles.front().y() < minDistance)
+        obstacles.pop_front();
+
+    if (obstacles.empty())
+        return false;
+
+    x = obstacles.front().x();
+    distance = obstacles.front().y();
+    obstacles.pop_front();
+    return true;
+}
@@ -0,0 +1,121 @@
+#ifndef ROADSTREAM_H
+#define ROADSTREAM_H
+
+#include <QtOpenGL>
+#include <QOpenGLWidget>
+#include <QOpenGLExtraFunctions>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#include "matrix4.h"
+#include "profiler.h"
+#include "resourcetracker.h"
+#include "util.h"
+
+struct RoadVertex
+{
+    float position[4];
+    float normal[3];
+};
+
+// Fixed-size piece of track produced by the generator thread. Distances are
+// measured along the road, the player sits at distance travelled + posY.
+struct RoadChunk
+{
+    static const int SEGMENTS = 32;
+    static const int MAX_DIVIDERS = 2;
+    static const int MAX_VERTICES = SEGMENTS * 6 * (1 + MAX_DIVIDERS);
+    static const int MAX_OBSTACLES = 4;
+
+    int index = 0;
+    float start = 0; // Road distance of the first row
+
+    float centre[SEGMENTS + 1];
+    float halfWidth[SEGMENTS + 1];
+
+    RoadVertex vertices[MAX_VERTICES];
+    unsigned int numSurfaceVertices = 0;
+    unsigned int numStripVertices = 0;
+
+    QVector2D obstacles[MAX_OBSTACLES]; // x, road distance
+    int numObstacles = 0;
+};
+
+// Procedural infinite road. Chunks are generated ahead of the camera on a
+// worker thread and copied into a ring of fixed-size slots of one vertex
+// buffer. A slot is only rewritten once the fence placed when it scrolled out
+// of view has signalled, so uploads never wait on the GPU.
+class RoadStream : public QOpenGLExtraFunctions
+{
+public:
+    RoadStream(QOpenGLWidget *_glWidget);
+    ~RoadStream();
+
+    QOpenGLWidget *glWidget;
+
+    static const int NUM_SLOTS = 6;
+    static const int MAX_PENDING = 4;
+    static constexpr float CHUNK_LENGTH = 8.0f;
+    static constexpr float LANE_WIDTH = 1.8f;
+    static constexpr float VISIBLE_BEHIND = 8.0f; // Distance behind the camera still drawn
+
+    GLuint vao = 0;
+    GLuint vboRing = 0;
+
+    struct Slot
+    {
+        bool live = false;
+        int index = -1;
+        float start = 0;
+        float centre[RoadChunk::SEGMENTS + 1];
+        float halfWidth[RoadChunk::SEGMENTS + 1];
+        unsigned int numSurfaceVertices = 0;
+        unsigned int numStripVertices = 0;
+        GLsync fence = 0;
+    };
+    Slot slots[NUM_SLOTS];
+
+    std::deque<QVector2D> obstacles; // Uploaded obstacle layout, ordered by distance
+
+    unsigned int drawCalls = 0;
+
+    void update(float travelled);
+    void drawSurface(GLuint program, float travelled);
+    void drawStrips(GLuint program, float travelled);
+
+    bool roadAt(float distance, float &centre, float &halfWidth);
+    bool nextObstacle(float minDistance, float &x, float &distance);
+
+private:
+    // Generator state, only touched by the worker once it is running
+    std::mt19937 random;
+    int nextIndex = 0;
+    float centreX = 0;
+    float heading = 0;
+    float curvature = 0;
+    float targetCurvature = 0;
+    float roadHalfWidth = LANE_WIDTH;
+    int lanes = 2;
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable canGenerate;
+    std::deque<RoadChunk> pending;
+    bool stopping = false;
+
+    void createVBOs();
+    void destroyVBOs();
+
+    void generateChunk(RoadChunk &chunk);
+    void generateChunks();
+    bool uploadChunk(int slot, const RoadChunk &chunk);
+    void drawRange(GLuint program, float travelled, bool strips);
+};
+
+#endif // ROADSTREAM_H
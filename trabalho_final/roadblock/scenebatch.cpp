@@ -0,0 +1,287 @@
+#include "scenebatch.h"
+
+#include <string.h>
+
+SceneBatch::SceneBatch(QOpenGLWidget *_glWidget, std::shared_ptr<ShaderLibrary> _shaderLibrary,
+                       std::shared_ptr<JobSystem> _jobSystem)
+{
+    glWidget = _glWidget;
+    shaderLibrary = _shaderLibrary;
+    jobSystem = _jobSystem;
+    makeGLCurrent(glWidget);
+
+    initializeOpenGLFunctions();
+
+    placements = std::make_unique<Placement[]>(MAX_DRAWS);
+    draws = std::make_unique<BatchDraw[]>(MAX_DRAWS);
+    commands = std::make_unique<DrawElementsCommand[]>(MAX_DRAWS);
+
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    if (context->format().version() >= qMakePair(4, 3))
+    {
+        functions43 = context->versionFunctions<QOpenGLFunctions_4_3_Core>();
+        if (functions43 && !functions43->initializeOpenGLFunctions())
+            functions43 = nullptr;
+    }
+
+    if (!functions43)
+    {
+        qDebug("SceneBatch: OpenGL 4.3 is not available, batched submission disabled");
+        return;
+    }
+
+    shaderProgram = shaderLibrary->program(":/shaders/vbatch.glsl", ":/shaders/fbatch.glsl", QStringList());
+    locView = glGetUniformLocation(shaderProgram, "view");
+    locProjection = glGetUniformLocation(shaderProgram, "projection");
+    locLightPosition = glGetUniformLocation(shaderProgram, "lightPosition");
+}
+
+SceneBatch::~SceneBatch()
+{
+    destroyVBOs();
+}
+
+void SceneBatch::createVBOs()
+{
+    destroyVBOs();
+
+    GL_CHECK(glGenVertexArrays(1, &vao));
+    GL_CHECK(glBindVertexArray(vao));
+
+    GL_CHECK(glGenBuffers(1, &vboVertices));
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vboVertices));
+    GL_CHECK(glBufferData(GL_ARRAY_BUFFER, numVertices * sizeof(QVector4D), nullptr, GL_STATIC_DRAW));
+    GL_CHECK(glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, nullptr));
+    GL_CHECK(glEnableVertexAttribArray(0));
+
+    GL_CHECK(glGenBuffers(1, &vboNormals));
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vboNormals));
+    GL_CHECK(glBufferData(GL_ARRAY_BUFFER, numVertices * sizeof(QVector3D), nullptr, GL_STATIC_DRAW));
+    GL_CHECK(glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, nullptr));
+    GL_CHECK(glEnableVertexAttribArray(1));
+
+    // gl_DrawID needs 4.6, so the draw index comes from an instanced attribute:
+    // instance i of a command reads element baseInstance + i
+    std::unique_ptr<GLuint[]> drawIndices = std::make_unique<GLuint[]>(MAX_DRAWS);
+    for (int i = 0; i < MAX_DRAWS; ++i)
+        drawIndices[i] = i;
+    GL_CHECK(glGenBuffers(1, &vboDrawIndices));
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vboDrawIndices));
+    GL_CHECK(glBufferData(GL_ARRAY_BUFFER, MAX_DRAWS * sizeof(GLuint), drawIndices.get(), GL_STATIC_DRAW));
+    GL_CHECK(glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, 0, nullptr));
+    GL_CHECK(glVertexAttribDivisor(3, 1));
+    GL_CHECK(glEnableVertexAttribArray(3));
+
+    GL_CHECK(glGenBuffers(1, &eboIndices));
+    GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eboIndices));
+    GL_CHECK(glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * sizeof(unsigned int), nullptr, GL_STATIC_DRAW));
+
+    GL_CHECK(glBindVertexArray(0));
+
+    GL_CHECK(glGenBuffers(1, &ssboDraws));
+    GL_CHECK(glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssboDraws));
+    GL_CHECK(glBufferData(GL_SHADER_STORAGE_BUFFER, MAX_DRAWS * sizeof(BatchDraw), nullptr, GL_DYNAMIC_DRAW));
+
+    GL_CHECK(glGenBuffers(1, &ssboMaterials));
+    GL_CHECK(glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssboMaterials));
+    GL_CHECK(glBufferData(GL_SHADER_STORAGE_BUFFER, MAX_MESHES * sizeof(BatchMaterial), nullptr, GL_DYNAMIC_DRAW));
+    GL_CHECK(glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0));
+
+    GL_CHECK(glGenBuffers(1, &indirectBuffer));
+    GL_CHECK(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer));
+    GL_CHECK(glBufferData(GL_DRAW_INDIRECT_BUFFER, MAX_DRAWS * sizeof(DrawElementsCommand), nullptr, GL_DYNAMIC_DRAW));
+    GL_CHECK(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0));
+
+    ResourceTracker::set("SceneBatch", "vboVertices", ResourceTracker::Buffer,
+                         numVertices * sizeof(QVector4D), numVertices * sizeof(float));
+    ResourceTracker::set("SceneBatch", "vboNormals", ResourceTracker::Buffer, numVertices * sizeof(QVector3D));
+    ResourceTracker::set("SceneBatch", "vboDrawIndices", ResourceTracker::Buffer, MAX_DRAWS * sizeof(GLuint));
+    ResourceTracker::set("SceneBatch", "eboIndices", ResourceTracker::Buffer, numIndices * sizeof(unsigned int));
+    ResourceTracker::set("SceneBatch", "ssboDraws", ResourceTracker::Buffer, MAX_DRAWS * sizeof(BatchDraw));
+    ResourceTracker::set("SceneBatch", "ssboMaterials", ResourceTracker::Buffer, MAX_MESHES * sizeof(BatchMaterial));
+    ResourceTracker::set("SceneBatch", "indirectBuffer", ResourceTracker::Buffer, MAX_DRAWS * sizeof(DrawElementsCommand));
+}
+
+void SceneBatch::destroyVBOs()
+{
+    GL_CHECK(glDeleteBuffers(1, &vboVertices));
+    GL_CHECK(glDeleteBuffers(1, &vboNormals));
+    GL_CHECK(glDeleteBuffers(1, &vboDrawIndices));
+    GL_CHECK(glDeleteBuffers(1, &eboIndices));
+    GL_CHECK(glDeleteBuffers(1, &ssboDraws));
+    GL_CHECK(glDeleteBuffers(1, &ssboMaterials));
+    GL_CHECK(glDeleteBuffers(1, &indirectBuffer));
+    GL_CHECK(glDeleteVertexArrays(1, &vao));
+
+    vboVertices = 0;
+    vboNormals = 0;
+    vboDrawIndices = 0;
+    eboIndices = 0;
+    ssboDraws = 0;
+    ssboMaterials = 0;
+    indirectBuffer = 0;
+    vao = 0;
+    ResourceTracker::releaseOwner("SceneBatch");
+}
+
+void SceneBatch::addModel(const std::shared_ptr<Model> &model)
+{
+    if (meshes.size() == MAX_MESHES)
+        return;
+
+    Mesh mesh;
+    mesh.model = model;
+    mesh.firstIndex = 0;
+    mesh.baseVertex = 0;
+    mesh.count = 0;
+    meshes.push_back(mesh);
+}
+
+bool SceneBatch::build()
+{
+    if (!isSupported())
+        return false;
+
+    numVertices = 0;
+    numIndices = 0;
+    for (Mesh &mesh : meshes)
+    {
+        // A model that failed to load has no buffers to copy from
+        bool loaded = mesh.model->vboVertices != 0;
+        mesh.baseVertex = numVertices;
+        mesh.firstIndex = numIndices;
+        mesh.count = loaded ? mesh.model->numFaces * 3 : 0;
+        numVertices += loaded ? mesh.model->numVertices : 0;
+        numIndices += mesh.count;
+    }
+
+    createVBOs();
+
+    // The models already freed their CPU copies, so the meshes are copied
+    // buffer to buffer. Indices stay relative, baseVertex rebases them.
+    for (const Mesh &mesh : meshes)
+    {
+        if (!mesh.count)
+            continue;
+
+        const Model &model = *mesh.model;
+        GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, model.vboVertices));
+        GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, vboVertices));
+        GL_CHECK(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0,
+                                     mesh.baseVertex * sizeof(QVector4D), model.numVertices * sizeof(QVector4D)));
+
+        GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, model.vboNormals));
+        GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, vboNormals));
+        GL_CHECK(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0,
+                                     mesh.baseVertex * sizeof(QVector3D), model.numVertices * sizeof(QVector3D)));
+
+        GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, model.vboIndices));
+        GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, eboIndices));
+        GL_CHECK(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0,
+                                     mesh.firstIndex * sizeof(unsigned int), mesh.count * sizeof(unsigned int)));
+    }
+    GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+    GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+
+    qDebug("SceneBatch: %d meshes, %u vertices, %u indices in shared buffers",
+           int(meshes.size()), numVertices, numIndices);
+    return true;
+}
+
+void SceneBatch::drawModel(const Model &model, float posX, float posY, float posZ, float scale, QVector3D rotation)
+{
+    if (numDraws == MAX_DRAWS)
+        return;
+
+    int mesh = 0;
+    while (mesh < int(meshes.size()) && meshes[mesh].model.get() != &model)
+        mesh++;
+    if (mesh == int(meshes.size()) || !meshes[mesh].count)
+        return;
+
+    placements[numDraws] = {posX, posY, posZ, scale, rotation};
+    draws[numDraws].material = mesh;
+
+    if (mesh == lastMesh)
+    {
+        commands[numCommands - 1].instanceCount++;
+    }
+    else
+    {
+        DrawElementsCommand &command = commands[numCommands++];
+        command.count = meshes[mesh].count;
+        command.instanceCount = 1;
+        command.firstIndex = meshes[mesh].firstIndex;
+        command.baseVertex = meshes[mesh].baseVertex;
+        command.baseInstance = numDraws;
+        lastMesh = mesh;
+    }
+    numDraws++;
+}
+
+void SceneBatch::draw(const Camera &camera, const Light &light)
+{
+    if (!numDraws)
+        return;
+
+    // Each draw only writes its own entry, so batches need no synchronisation
+    jobSystem->parallelFor("SceneBatch::transforms", int(numDraws), TRANSFORM_GRAIN, [this](int begin, int end) {
+        for (int i = begin; i < end; ++i)
+        {
+            const Placement &placement = placements[i];
+            Matrix4 transform = Model::transform(placement.posX, placement.posY, placement.posZ,
+                                                 placement.scale, placement.rotation);
+            float normalMatrix[9];
+            transform.normalMatrix(normalMatrix);
+
+            BatchDraw &draw = draws[i];
+            memcpy(draw.model, transform.data(), sizeof(draw.model));
+            memset(draw.normalMatrix, 0, sizeof(draw.normalMatrix));
+            for (int column = 0; column < 3; ++column)
+                for (int row = 0; row < 3; ++row)
+                    draw.normalMatrix[column * 4 + row] = normalMatrix[column * 3 + row];
+        }
+    });
+
+    BatchMaterial materials[MAX_MESHES];
+    for (size_t i = 0; i < meshes.size(); ++i)
+    {
+        const Material &material = meshes[i].model->material;
+        materials[i].ambientProduct = light.ambient * material.ambient;
+        materials[i].diffuseProduct = light.diffuse * material.diffuse;
+        materials[i].specularProduct = light.specular * material.specular;
+        materials[i].color = material.color;
+        materials[i].shininess = material.shininess;
+    }
+
+    GL_CHECK(glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssboMaterials));
+    GL_CHECK(glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, meshes.size() * sizeof(BatchMaterial), materials));
+
+    // Orphan the per-frame lists so the upload never waits on the previous frame
+    GL_CHECK(glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssboDraws));
+    GL_CHECK(glBufferData(GL_SHADER_STORAGE_BUFFER, MAX_DRAWS * sizeof(BatchDraw), nullptr, GL_DYNAMIC_DRAW));
+    GL_CHECK(glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, numDraws * sizeof(BatchDraw), draws.get()));
+    GL_CHECK(glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0));
+
+    GL_CHECK(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer));
+    GL_CHECK(glBufferData(GL_DRAW_INDIRECT_BUFFER, MAX_DRAWS * sizeof(DrawElementsCommand), nullptr, GL_DYNAMIC_DRAW));
+    GL_CHECK(glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, numCommands * sizeof(DrawElementsCommand), commands.get()));
+
+    GL_CHECK(glUseProgram(shaderProgram));
+    GL_CHECK(glUniformMatrix4fv(locView, 1, GL_FALSE, camera.viewMatrix.constData()));
+    GL_CHECK(glUniformMatrix4fv(locProjection, 1, GL_FALSE, camera.projectionMatrix.constData()));
+    GL_CHECK(glUniform4f(locLightPosition, light.position.x(), light.position.y(), light.position.z(), light.position.w()));
+
+    GL_CHECK(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ssboDraws));
+    GL_CHECK(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, ssboMaterials));
+
+    GL_CHECK(glBindVertexArray(vao));
+    GL_CHECK(functions43->glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, numCommands, 0));
+    drawCalls++;
+    GL_CHECK(glBindVertexArray(0));
+    GL_CHECK(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0));
+
+    numDraws = 0;
+    numCommands = 0;
+    lastMesh = -1;
+}
@@ -0,0 +1,134 @@
+#ifndef SCENEBATCH_H
+#define SCENEBATCH_H
+
+#include <QtOpenGL>
+#include <QOpenGLWidget>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLFunctions_4_3_Core>
+
+#include <memory>
+#include <vector>
+
+#include "camera.h"
+#include "jobsystem.h"
+#include "light.h"
+#include "model.h"
+#include "resourcetracker.h"
+#include "shaderlibrary.h"
+#include "util.h"
+
+// Per-draw data read by the batch shader, std430 layout
+struct BatchDraw
+{
+    float model[16];
+    float normalMatrix[16]; // mat3 padded to a mat4
+    GLuint material;
+    GLuint pad[3];
+};
+
+struct BatchMaterial
+{
+    QVector4D ambientProduct;
+    QVector4D diffuseProduct;
+    QVector4D specularProduct;
+    QVector4D color;
+    float shininess;
+    float pad[3];
+};
+
+// Layout fixed by glMultiDrawElementsIndirect
+struct DrawElementsCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// Single call submission of the static models. Their meshes are copied on the
+// GPU into one shared vertex and index buffer, each draw queued with drawModel
+// stores its transform and material index in a storage buffer, and draw()
+// issues the whole list with one glMultiDrawElementsIndirect. Consecutive
+// draws of the same model share one instanced command.
+//
+// Needs OpenGL 4.3 (storage buffers, multi draw indirect). The context is
+// requested as 4.1 on Linux, which drivers usually round up to their newest
+// core version; when they do not, isSupported() is false and the game keeps
+// the per-model path.
+class SceneBatch : public QOpenGLExtraFunctions
+{
+public:
+    SceneBatch(QOpenGLWidget *_glWidget, std::shared_ptr<ShaderLibrary> _shaderLibrary,
+               std::shared_ptr<JobSystem> _jobSystem);
+    ~SceneBatch();
+
+    QOpenGLWidget *glWidget;
+    std::shared_ptr<ShaderLibrary> shaderLibrary;
+    std::shared_ptr<JobSystem> jobSystem;
+
+    static const int MAX_MESHES = 16;
+    static const int MAX_DRAWS = 256;
+    static const int TRANSFORM_GRAIN = 64; // Draws per job when building the matrices
+
+    GLuint vao = 0;
+    GLuint vboVertices = 0;
+    GLuint vboNormals = 0;
+    GLuint vboDrawIndices = 0; // 0..MAX_DRAWS-1, read per instance from baseInstance on
+    GLuint eboIndices = 0;
+    GLuint ssboDraws = 0;
+    GLuint ssboMaterials = 0;
+    GLuint indirectBuffer = 0;
+
+    GLuint shaderProgram = 0; // Owned by shaderLibrary
+
+    GLint locView = -1;
+    GLint locProjection = -1;
+    GLint locLightPosition = -1;
+
+    unsigned int drawCalls = 0; // Draw calls issued since the last frame stats reset
+
+    bool isSupported() const { return functions43 != nullptr && shaderProgram != 0; }
+
+    // Meshes must be added before build(), which copies them into the shared buffers
+    void addModel(const std::shared_ptr<Model> &model);
+    bool build();
+
+    // Same arguments as Model::drawModel, only queued; the matrices are built
+    // in draw(), in parallel once there are enough of them
+    void drawModel(const Model &model, float posX, float posY, float posZ, float scale, QVector3D rotation);
+    void draw(const Camera &camera, const Light &light);
+
+    void createVBOs();
+    void destroyVBOs();
+
+private:
+    struct Mesh
+    {
+        std::shared_ptr<Model> model;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint count;
+    };
+
+    QOpenGLFunctions_4_3_Core *functions43 = nullptr;
+
+    std::vector<Mesh> meshes;
+    unsigned int numVertices = 0;
+    unsigned int numIndices = 0;
+
+    struct Placement
+    {
+        float posX, posY, posZ, scale;
+        QVector3D rotation;
+    };
+
+    std::unique_ptr<Placement[]> placements;
+    std::unique_ptr<BatchDraw[]> draws;
+    std::unique_ptr<DrawElementsCommand[]> commands;
+    unsigned int numDraws = 0;
+    unsigned int numCommands = 0;
+    int lastMesh = -1;
+};
+
+#endif // SCENEBATCH_H
@@ -0,0 +1,133 @@
+#include "shaderlibrary.h"
+
+#include <vector>
+
+ShaderLibrary::ShaderLibrary(QOpenGLWidget *_glWidget, const QString &_owner)
+{
+    glWidget = _glWidget;
+    owner = _owner;
+    makeGLCurrent(glWidget);
+
+    initializeOpenGLFunctions();
+}
+
+ShaderLibrary::~ShaderLibrary()
+{
+    destroyShaders();
+}
+
+GLuint ShaderLibrary::program(const QString &vertexShaderFile, const QString &fragmentShaderFile, const QStringList &defines)
+{
+    QStringList sorted = defines;
+    sorted.sort();
+    QString key = vertexShaderFile + "|" + fragmentShaderFile + "|" + sorted.join(",");
+
+    auto found = programs.constFind(key);
+    if (found != programs.constEnd())
+        return found.value();
+
+    GLuint shaderProgram = createShaders(vertexShaderFile, fragmentShaderFile, sorted);
+    if (shaderProgram)
+    {
+        programs.insert(key, shaderProgram);
+
+        // The program binary is the closest thing GL reports to its footprint,
+        // an estimate of the driver's real allocation
+        GLint binaryLength = 0;
+        glGetProgramiv(shaderProgram, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+        ResourceTracker::set(owner, QFileInfo(fragmentShaderFile).baseName() + " " + sorted.join(" "),
+                             ResourceTracker::Program, binaryLength);
+        qDebug("ShaderLibrary: compiled %s [%s], %d programs",
+               qPrintable(fragmentShaderFile), qPrintable(sorted.join(" ")), programs.size());
+    }
+    return shaderProgram;
+}
+
+void ShaderLibrary::destroyShaders()
+{
+    for (GLuint shaderProgram : programs)
+        GL_CHECK(glDeleteProgram(shaderProgram));
+    programs.clear();
+    ResourceTracker::releaseOwner(owner);
+}
+
+std::string ShaderLibrary::readSource(const QString &fileName, const QStringList &defines)
+{
+    QFile file(fileName);
+    file.open(QFile::ReadOnly | QFile::Text);
+    QTextStream stream(&file);
+
+    // #version has to stay the first statement, the variant goes right after it
+    QString version = stream.readLine();
+    QString source = version + "\n";
+    for (const QString &define : defines)
+        source += "#define " + define + "\n";
+    source += stream.readAll();
+
+    return source.toStdString();
+}
+
+GLuint ShaderLibrary::compileShader(GLenum type, const std::string &text)
+{
+    GLuint shader = glCreateShader(type);
+    const GLchar *source = text.c_str();
+    glShaderSource(shader, 1, &source, 0);
+    glCompileShader(shader);
+    GLint isCompiled = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &isCompiled);
+    if (isCompiled == GL_FALSE)
+    {
+        GLint maxLength = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &maxLength);
+        std::vector<GLchar> infoLog(maxLength);
+        glGetShaderInfoLog(shader, maxLength, &maxLength, &infoLog[0]);
+        qDebug("%s", &infoLog[0]);
+
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+GLuint ShaderLibrary::createShaders(const QString &vertexShaderFile, const QString &fragmentShaderFile, const QStringList &defines)
+{
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, readSource(vertexShaderFile, defines));
+    if (!vertexShader)
+        return 0;
+
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, readSource(fragmentShaderFile, defines));
+    if (!fragmentShader)
+    {
+        glDeleteShader(vertexShader);
+        return 0;
+    }
+
+    GLuint shaderProgram = glCreateProgram();
+    glAttachShader(shaderProgram, vertexShader);
+    glAttachShader(shaderProgram, fragmentShader);
+    // Without the hint a driver may report a binary length of 0, see program()
+    glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(shaderProgram);
+    GLint isLinked = 0;
+    glGetProgramiv(shaderProgram, GL_LINK_STATUS, (int *)&isLinked);
+    if (isLinked == GL_FALSE)
+    {
+        GLint maxLength = 0;
+        glGetProgramiv(shaderProgram, GL_INFO_LOG_LENGTH, &maxLength);
+        std::vector<GLchar> infoLog(maxLength);
+        glGetProgramInfoLog(shaderProgram, maxLength, &maxLength, &infoLog[0]);
+        qDebug("%s", &infoLog[0]);
+        glDeleteProgram(shaderProgram);
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        return 0;
+    }
+
+    glDetachShader(shaderProgram, vertexShader);
+    glDetachShader(shaderProgram, fragmentShader);
+
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    return shaderProgram;
+}
@@ -0,0 +1,39 @@
+#ifndef SHADERLIBRARY_H
+#define SHADERLIBRARY_H
+
+#include <QtOpenGL>
+#include <QOpenGLWidget>
+#include <QOpenGLExtraFunctions>
+#include <QHash>
+#include <QStringList>
+
+#include "resourcetracker.h"
+#include "util.h"
+
+// Programs built from one shader source with "#define" variants injected
+// after the #version line. A variant is compiled the first time a model asks
+// for it and shared by every later request, so the scene only carries the
+// permutations it actually uses. The library owns the programs.
+class ShaderLibrary : public QOpenGLExtraFunctions
+{
+public:
+    ShaderLibrary(QOpenGLWidget *_glWidget, const QString &_owner = "ShaderLibrary");
+    ~ShaderLibrary();
+
+    QOpenGLWidget *glWidget;
+    QString owner; // Shown by ResourceTracker
+
+    GLuint program(const QString &vertexShaderFile, const QString &fragmentShaderFile, const QStringList &defines);
+    int numPrograms() const { return programs.size(); }
+
+    void destroyShaders();
+
+private:
+    QHash<QString, GLuint> programs;
+
+    GLuint compileShader(GLenum type, const std::string &text);
+    GLuint createShaders(const QString &vertexShaderFile, const QString &fragmentShaderFile, const QStringList &defines);
+    static std::string readSource(const QString &fileName, const QStringList &defines);
+};
+
+#endif // SHADERLIBRARY_H
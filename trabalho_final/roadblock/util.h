@@ -2,6 +2,8 @@
 #define UTIL_H
 
 #include <QOpenGLExtraFunctions>
+#include <QOpenGLWidget>
+#include <QThread>
 
 inline const char* getOpenGLErrorString(GLenum err)
 {
@@ -20,6 +22,15 @@ inline const char* getOpenGLErrorString(GLenum err)
     }
 }
 
+// Scene objects call this before touching GL. On the GUI thread it binds the
+// widget's context; on the render thread (roadblock3D --render-thread) that
+// thread's own context is already current and the widget's must not be taken.
+inline void makeGLCurrent(QOpenGLWidget *glWidget)
+{
+    if (QThread::currentThread() == glWidget->thread())
+        glWidget->makeCurrent();
+}
+
 #ifdef QT_DEBUG
 inline void checkOpenGLError(const char* stmt, const char* function,
                              const char* file, int line)
@@ -0,0 +1,37 @@
+#version 430
+
+layout (location = 0) in vec4 vPosition;
+layout (location = 1) in vec3 vNormal;
+layout (location = 3) in uint drawIndex;
+
+struct Draw
+{
+    mat4 model;
+    mat4 normalMatrix;
+    uint material;
+};
+
+layout (std430, binding = 0) readonly buffer Draws
+{
+    Draw draws[];
+};
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec4 lightPosition;
+
+out vec3 fN;
+out vec3 fE;
+out vec3 fL;
+flat out uint fMaterial;
+
+void main()
+{
+    Draw draw = draws[drawIndex];
+    vec4 VMvPosition = view * draw.model * vPosition;
+    fN = mat3(view) * mat3(draw.normalMatrix) * vNormal;
+    fL = lightPosition.xyz - VMvPosition.xyz;
+    fE = -VMvPosition.xyz;
+    fMaterial = draw.material;
+    gl_Position = projection * VMvPosition;
+}
@@ -0,0 +1,116 @@
+#version 400
+
+// Roadside grass without vertex attributes (see GrassField). gl_InstanceID
+// picks the blade's cell, alternating sides, then out from the road edge,
+// then along the road; gl_VertexID walks up its tapered triangle strip.
+
+const int BLADE_SEGMENTS = 4;
+const int COLUMNS = 32;
+const int ROAD_SAMPLES = 64;
+
+const float EDGE_MARGIN = 0.15;    // Bare shoulder between the asphalt and the first blades
+const float GROUND = 0.02;
+const float FULL_DENSITY = 6.0;    // Every cell has a blade up to this far from the eye
+const float SPARSE_DENSITY = 18.0; // and MIN_DENSITY of them from here on
+const float MIN_DENSITY = 0.15;
+const vec2 WIND_DIRECTION = vec2(0.8, 0.6);
+const float WIND_STRENGTH = 0.35;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec4 lightPosition;
+uniform vec3 eye;
+
+uniform int firstRow;     // Road distance of row 0 in cells
+uniform float travelled;
+uniform float cellSize;
+uniform vec2 road[ROAD_SAMPLES]; // Centre and half width
+uniform float roadStart;  // y of road[0]
+uniform float roadStep;
+uniform float time;       // Seconds
+
+out vec3 fN;
+out vec3 fE;
+out vec3 fL;
+out vec4 fColor;
+
+uint hash(uint x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// In [0, 1), an independent value per salt
+float random(uint seed, uint salt)
+{
+    return float(hash(seed ^ hash(salt)) >> 8) / 16777216.0;
+}
+
+void main()
+{
+    int side = gl_InstanceID % 2;
+    int column = (gl_InstanceID / 2) % COLUMNS;
+    int worldRow = firstRow + gl_InstanceID / (2 * COLUMNS);
+
+    // Keyed on the cell's place in the world, so a patch looks the same every time it is drawn
+    uint seed = hash(uint(worldRow) * 73856093u ^ uint(column) * 19349663u ^ uint(side) * 83492791u);
+
+    float y = (float(worldRow) + random(seed, 1u)) * cellSize - travelled;
+    float s = clamp((y - roadStart) / roadStep, 0.0, float(ROAD_SAMPLES - 1));
+    int k = min(int(s), ROAD_SAMPLES - 2);
+    vec2 edge = mix(road[k], road[k + 1], s - float(k));
+    float outward = EDGE_MARGIN + (float(column) + random(seed, 2u)) * cellSize;
+    float x = side == 0 ? edge.x - edge.y - outward : edge.x + edge.y + outward;
+
+    // Thinner further from the eye and towards the outer columns
+    float verge = 1.0 - smoothstep(0.5, 1.0, float(column) / float(COLUMNS));
+    float density = mix(MIN_DENSITY, 1.0, 1.0 - smoothstep(FULL_DENSITY, SPARSE_DENSITY, length(vec2(x, y) - eye.xy)));
+    density *= mix(0.4, 1.0, verge);
+    if (random(seed, 3u) >= density)
+    {
+        // Every vertex of the blade in one spot outside the clip volume, nothing is rasterised
+        fN = vec3(0.0, 0.0, 1.0);
+        fE = vec3(0.0);
+        fL = vec3(0.0);
+        fColor = vec4(0.0);
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        return;
+    }
+
+    float height = mix(0.07, 0.2, random(seed, 4u)) * mix(0.7, 1.0, verge);
+    float width = mix(0.01, 0.02, random(seed, 5u));
+    float facing = random(seed, 6u) * 6.2831853;
+    vec2 across = vec2(cos(facing), sin(facing));
+    vec2 lean = vec2(-across.y, across.x) * mix(0.1, 0.6, random(seed, 7u));
+
+    // A gust front rolling over the ground plus a faster flutter of each blade
+    vec2 ground = vec2(x, y + travelled);
+    float gust = 0.5 + 0.5 * sin(time * 1.7 - dot(ground, WIND_DIRECTION) * 1.3);
+    float flutter = 0.15 * sin(time * 6.0 + random(seed, 8u) * 6.2831853);
+    vec2 bend = lean + WIND_DIRECTION * WIND_STRENGTH * (gust + flutter);
+
+    // Pairs of vertices up the blade, the last one alone at the tip
+    float t = float(gl_VertexID / 2) / float(BLADE_SEGMENTS);
+    float offset = gl_VertexID == 2 * BLADE_SEGMENTS ? 0.0 : (gl_VertexID % 2 == 0 ? -1.0 : 1.0);
+
+    // The base stays planted and the bend grows towards the tip
+    vec3 position = vec3(x, y, GROUND);
+    position.xy += across * offset * width * (1.0 - t) + bend * height * t * t;
+    position.z += height * t * (1.0 - 0.25 * dot(bend, bend) * t);
+    vec3 tangent = vec3(bend * height * 2.0 * t, height);
+    vec3 normal = normalize(cross(vec3(across, 0.0), tangent));
+
+    vec3 baseColor = mix(vec3(0.16, 0.3, 0.14), vec3(0.28, 0.44, 0.33), random(seed, 9u));
+    vec3 tipColor = mix(baseColor * 1.5, vec3(0.62, 0.58, 0.3), pow(random(seed, 10u), 4.0));
+    fColor = vec4(mix(baseColor * 0.6, tipColor, t), 1.0);
+
+    vec4 VMvPosition = view * vec4(position, 1.0);
+    fN = mat3(view) * normal;
+    fL = lightPosition.xyz - VMvPosition.xyz;
+    fE = -VMvPosition.xyz;
+    gl_Position = projection * VMvPosition;
+}
@@ -0,0 +1,14 @@
+#version 400
+
+layout (location = 0) in vec4 vGlyph; // xy: pixel position, zw: atlas coordinates
+
+uniform vec2 viewportSize;
+
+out vec2 fTexCoord;
+
+void main()
+{
+    vec2 ndc = vec2(vGlyph.x / viewportSize.x, 1.0 - vGlyph.y / viewportSize.y) * 2.0 - 1.0;
+    fTexCoord = vGlyph.zw;
+    gl_Position = vec4(ndc, 0.0, 1.0);
+}
@@ -2,6 +2,12 @@
 
 layout (location = 0) in vec4 vPosition;
 layout (location = 1) in vec3 vNormal;
+#ifdef TEXTURED
+layout (location = 2) in vec2 vTexCoord;
+#endif
+#ifdef VERTEX_COLORS
+layout (location = 3) in vec4 vColor;
+#endif
 
 uniform mat4 model;
 uniform mat4 view;
@@ -13,6 +19,12 @@ uniform vec4 lightPosition;
 out vec3 fN;
 out vec3 fE;
 out vec3 fL;
+#ifdef TEXTURED
+out vec2 ftexCoord;
+#endif
+#ifdef VERTEX_COLORS
+out vec4 fColor;
+#endif
 
 void main()
 {
@@ -20,5 +32,11 @@ void main()
     fN = mat3(view) * normalMatrix * vNormal;
     fL = lightPosition.xyz - VMvPosition.xyz;
     fE = -VMvPosition.xyz;
+#ifdef TEXTURED
+    ftexCoord = vTexCoord;
+#endif
+#ifdef VERTEX_COLORS
+    fColor = vColor;
+#endif
     gl_Position = projection * VMvPosition;
 }
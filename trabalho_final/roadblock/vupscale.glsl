@@ -0,0 +1,13 @@
+#version 400
+
+// One triangle covering the viewport, no vertex buffer needed
+uniform vec2 sceneExtent; // Part of the texture holding the scene
+
+out vec2 fTexCoord;
+
+void main()
+{
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    fTexCoord = corner * sceneExtent;
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}